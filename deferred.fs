@@ -0,0 +1,142 @@
+#version 330 core
+// Lighting pass del percorso deferred: legge il G-buffer (gbuffer.h) e calcola le stesse luci di progetto.fs
+// (spotlight della camera, luce centrale con shadow map, luci pratiche) in spazio mondo, una volta per pixel
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+// G-buffer: albedo + gloss, normale con codifica ottaedrica, profondita'
+uniform sampler2D gAlbedoGloss;
+uniform sampler2D gNormale;
+uniform sampler2D gProfondita;
+uniform mat4 inversaViewProj;   // da NDC a spazio mondo
+uniform vec2 scala;             // porzione renderizzata / dimensione del G-buffer (risoluzione dinamica)
+
+uniform vec3 lightPos;          // Posizione spotlight (camera)
+uniform vec3 viewPos;
+uniform vec3 spotlightDir;
+uniform vec3 luceDxPos;
+uniform vec3 luceDxDir;
+uniform mat4 luceDxSpaceMatrix;
+uniform float luceDxAngle;
+uniform vec3 luceSxPos;
+uniform vec3 luceSxDir;
+uniform mat4 luceSxSpaceMatrix;
+uniform float luceSxAngle;
+uniform sampler2D shadowMapLuceCentro;
+uniform float intensitaLuciLaterali;
+
+// Luci pratiche (practical_lights.h), stesso blocco e stessa funzione di progetto.fs
+layout (std140) uniform LuciPratiche {
+    vec4 luciPosRaggio[256];
+    vec4 luciColore[256];
+    int numLuci;
+};
+
+vec3 luciPratiche(vec3 pos, vec3 normal, vec3 viewDir, vec3 color, float shininess)
+{
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < numLuci; ++i)
+    {
+        vec3 l = luciPosRaggio[i].xyz - pos;
+        float d2 = dot(l, l);
+        float r2 = luciPosRaggio[i].w * luciPosRaggio[i].w;
+        if (d2 >= r2)
+            continue;
+        float att = 1.0 - d2 / r2;
+        att *= att;
+        l *= inversesqrt(d2);
+        float diff = max(dot(l, normal), 0.0);
+        float spec = pow(max(dot(normal, normalize(l + viewDir)), 0.0), shininess);
+        result += att * luciColore[i].rgb * (diff * color + vec3(0.2) * spec);
+    }
+    return result;
+}
+
+vec2 segno(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 decodificaOttaedrica(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * segno(n.xy);
+    return normalize(n);
+}
+
+float ShadowCalculation(vec4 fragPosLightSpace, sampler2D shadowMap)
+{
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    float currentDepth = projCoords.z;
+    float bias = 0.002;
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    for(int x = -1; x <= 1; ++x)
+    {
+        for(int y = -1; y <= 1; ++y)
+        {
+            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    shadow /= 9.0;
+    if(projCoords.z > 1.0)
+        shadow = 0.0;
+    return shadow;
+}
+
+void main()
+{
+    // TexCoords copre la viewport (per ricostruire la posizione), uv la porzione usata del G-buffer
+    vec2 uv = TexCoords * scala;
+    float depth = texture(gProfondita, uv).r;
+    if (depth >= 1.0)
+    {
+        FragColor = vec4(1.0);  // nessuna geometria: sfondo bianco come il clear del percorso forward
+        return;
+    }
+    vec4 world = inversaViewProj * vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+
+    vec4 albedoGloss = texture(gAlbedoGloss, uv);
+    vec3 color = albedoGloss.rgb;
+    float gloss = albedoGloss.a;
+    vec3 normal = decodificaOttaedrica(texture(gNormale, uv).rg);
+    vec3 ambient = 0.28 * color;
+    float shininess = mix(8.0, 128.0, gloss);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    // --- Spotlight (segue la camera) ---
+    vec3 lightDir = normalize(lightPos - fragPos);
+    float diff = max(dot(lightDir, normal), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    float theta = dot(lightDir, normalize(spotlightDir));
+    float epsilon = 0.15;
+    float intensity = smoothstep(cos(radians(12.5)), cos(radians(12.5 + epsilon)), theta) * 0.55;
+    vec3 spotlightResult = intensity * (diff * color + vec3(0.2) * spec);
+
+    // --- Luce Centrale (media tra DX e SX) ---
+    vec3 luceCentroDir = normalize(normalize(luceDxPos - fragPos) + normalize(luceSxPos - fragPos));
+    float luceCentroDiff = max(dot(luceCentroDir, normal), 0.0);
+    float luceCentroSpec = pow(max(dot(normal, normalize(luceCentroDir + viewDir)), 0.0), shininess);
+    vec3 luceCentroConeDir = normalize(normalize(luceDxDir) + normalize(luceSxDir));
+    float luceCentroTheta = dot(luceCentroDir, luceCentroConeDir);
+    float luceCentroEpsilon = 0.05;
+    float luceCentroAngle = 0.5 * (luceDxAngle + luceSxAngle) + 8.0;
+    float luceCentroIntensity = intensitaLuciLaterali * smoothstep(cos(radians(luceCentroAngle + luceCentroEpsilon)), cos(radians(luceCentroAngle)), luceCentroTheta) * 1.0;
+    vec4 fragPosLuceCentroSpace = 0.5 * (luceDxSpaceMatrix * vec4(fragPos, 1.0)) + 0.5 * (luceSxSpaceMatrix * vec4(fragPos, 1.0));
+    float shadowLuceCentro = ShadowCalculation(fragPosLuceCentroSpace, shadowMapLuceCentro);
+    vec3 luceCentroResult = luceCentroIntensity * (1.0 - shadowLuceCentro) * (luceCentroDiff * color + vec3(0.2) * luceCentroSpec);
+
+    // --- Luci pratiche ---
+    vec3 praticheResult = luciPratiche(fragPos, normal, viewDir, color, shininess);
+
+    vec3 result = ambient + spotlightResult + luceCentroResult + praticheResult;
+    FragColor = vec4(result, 1.0);
+}
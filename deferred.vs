@@ -0,0 +1,12 @@
+#version 330 core
+// Lighting pass del percorso deferred: un triangolo che copre tutto lo schermo, senza vertex buffer
+// (le posizioni vengono da gl_VertexID, il VAO legato e' vuoto). Lo usa anche l'upscaling (upscale.fs).
+
+out vec2 TexCoords;
+
+void main()
+{
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = p;
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
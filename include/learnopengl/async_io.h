@@ -0,0 +1,617 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// io_uring solo su Linux e solo se gli header del kernel lo prevedono (ASYNC_IO_NO_URING lo esclude)
+#if defined(__linux__) && !defined(ASYNC_IO_NO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ASYNC_IO_URING 1
+#endif
+#endif
+#endif
+
+// Servizio di lettura asincrona dei file: submit() accoda un gruppo di percorsi, un thread dedicato
+// li apre e li legge a blocchi (CHUNK byte) tenendo in volo fino a `profondita` letture, e per ogni file
+// completato chiama fatto(path, dati) con l'intero contenuto in memoria (nullptr se la lettura fallisce).
+// - Linux: io_uring (READV sul ring, nessuna dipendenza da liburing); se il kernel non lo permette
+//   si passa al backend a thread
+// - altrove (Windows): thread che leggono con offset esplicito (pread / ReadFile con OVERLAPPED);
+//   sono profondita - 1 lettori persistenti creati al primo uso, piu' il thread di I/O stesso
+// I callback arrivano dal thread di I/O o dai thread di lettura: devono essere thread-safe.
+class AsyncIO
+{
+public:
+    typedef std::shared_ptr<std::vector<unsigned char>> Buffer;
+    typedef std::function<void(const std::string& path, const Buffer& dati)> Callback;
+
+    struct Stats {
+        const char* backend = "";
+        unsigned long long file = 0;
+        unsigned long long bytes = 0;
+        double secondi = 0.0;              // tempo con almeno una lettura in corso
+        double profonditaMedia = 0.0;      // letture in volo, media sulle sottomissioni
+        int profonditaMax = 0;
+    };
+
+    static const size_t CHUNK = 1 << 20;
+
+    explicit AsyncIO(int profondita = 32) : profondita(std::max(1, profondita))
+    {
+#ifdef ASYNC_IO_URING
+        uringOk = ring.init((unsigned)this->profondita);
+#endif
+        thread = std::thread(&AsyncIO::loop, this);
+    }
+
+    ~AsyncIO()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        thread.join();
+        {
+            std::lock_guard<std::mutex> lock(mutexLettori);
+            fermaLettori = true;
+        }
+        cvLettori.notify_all();
+        for (std::thread& t : lettori)
+            t.join();
+#ifdef ASYNC_IO_URING
+        ring.close();
+#endif
+    }
+
+    static AsyncIO& shared()
+    {
+        static AsyncIO io;
+        return io;
+    }
+
+    void submit(const std::vector<std::string>& paths, const Callback& fatto)
+    {
+        if (paths.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            coda.push_back(Gruppo{ paths, fatto });
+        }
+        cv.notify_all();
+    }
+
+    Stats getStats()
+    {
+        std::lock_guard<std::mutex> lock(mutexStats);
+        Stats s = stats;
+        s.backend = backend();
+        s.profonditaMedia = sottomissioni ? (double)sommaProfondita / sottomissioni : 0.0;
+        return s;
+    }
+
+    const char* backend() const
+    {
+#ifdef ASYNC_IO_URING
+        if (uringOk)
+            return "io_uring";
+#endif
+        return "thread pread";
+    }
+
+private:
+    struct Gruppo {
+        std::vector<std::string> paths;
+        Callback fatto;
+    };
+
+#ifdef _WIN32
+    typedef HANDLE Handle;
+#else
+    typedef int Handle;
+#endif
+
+    struct Aperto {
+        std::string path;
+        Handle h;
+        Buffer dati;
+        std::atomic<size_t> rimanenti{ 0 };   // blocchi ancora da leggere
+        std::atomic<bool> errore{ false };
+    };
+    struct Blocco {
+        size_t file;
+        unsigned long long offset;
+        size_t len;
+        size_t fatti;
+#ifdef ASYNC_IO_URING
+        struct iovec iov;
+#endif
+    };
+
+    int profondita;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Gruppo> coda;
+    bool stopping = false;
+
+    std::mutex mutexStats;
+    Stats stats;
+    unsigned long long sottomissioni = 0, sommaProfondita = 0;
+
+    // lettori del backend a thread: eseguono lavoroCorrente a ogni nuova generazione
+    std::vector<std::thread> lettori;
+    std::mutex mutexLettori;
+    std::condition_variable cvLettori, cvLettoriFine;
+    std::function<void()> lavoroCorrente;
+    unsigned long long generazione = 0;
+    int occupati = 0;
+    bool fermaLettori = false;
+
+    void loopLettore()
+    {
+        unsigned long long vista = 0;
+        for (;;)
+        {
+            std::function<void()> lavoro;
+            {
+                std::unique_lock<std::mutex> lock(mutexLettori);
+                cvLettori.wait(lock, [&] { return fermaLettori || generazione != vista; });
+                if (fermaLettori)
+                    return;
+                vista = generazione;
+                if (!lavoroCorrente)
+                    continue;   // gruppo gia' terminato prima del risveglio
+                lavoro = lavoroCorrente;
+                occupati++;
+            }
+            lavoro();
+            {
+                std::lock_guard<std::mutex> lock(mutexLettori);
+                occupati--;
+            }
+            cvLettoriFine.notify_all();
+        }
+    }
+
+    void loop()
+    {
+        for (;;)
+        {
+            Gruppo g;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !coda.empty(); });
+                if (coda.empty())
+                    return;
+                g = std::move(coda.front());
+                coda.pop_front();
+            }
+            leggi(g);
+        }
+    }
+
+    static bool apri(const std::string& path, Handle& h, unsigned long long& size)
+    {
+#ifdef _WIN32
+        h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (h == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER dim;
+        if (!GetFileSizeEx(h, &dim))
+        {
+            CloseHandle(h);
+            return false;
+        }
+        size = (unsigned long long)dim.QuadPart;
+#else
+        h = ::open(path.c_str(), O_RDONLY);
+        if (h < 0)
+            return false;
+        struct stat st;
+        if (fstat(h, &st) != 0)
+        {
+            ::close(h);
+            return false;
+        }
+        size = (unsigned long long)st.st_size;
+#endif
+        return true;
+    }
+
+    static void chiudi(Handle h)
+    {
+#ifdef _WIN32
+        CloseHandle(h);
+#else
+        ::close(h);
+#endif
+    }
+
+    // Lettura sincrona con offset esplicito, sicura da piu' thread sullo stesso handle
+    static bool leggiBlocco(Handle h, unsigned char* dst, unsigned long long offset, size_t len)
+    {
+        while (len > 0)
+        {
+#ifdef _WIN32
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)(offset & 0xFFFFFFFFull);
+            ov.OffsetHigh = (DWORD)(offset >> 32);
+            DWORD letti = 0;
+            if (!ReadFile(h, dst, (DWORD)len, &letti, &ov) || letti == 0)
+                return false;
+#else
+            ssize_t letti = pread(h, dst, len, (off_t)offset);
+            if (letti < 0 && errno == EINTR)
+                continue;
+            if (letti <= 0)
+                return false;
+#endif
+            dst += letti;
+            offset += letti;
+            len -= (size_t)letti;
+        }
+        return true;
+    }
+
+    // Un blocco completato: l'ultimo del file chiude l'handle e consegna il buffer
+    void completato(Aperto& f, bool ok, const Callback& fatto)
+    {
+        if (!ok)
+            f.errore = true;
+        if (--f.rimanenti > 0)
+            return;
+        chiudi(f.h);
+        bool riuscito = !f.errore;
+        {
+            std::lock_guard<std::mutex> lock(mutexStats);
+            stats.file++;
+            if (riuscito)
+                stats.bytes += f.dati->size();
+        }
+        fatto(f.path, riuscito ? f.dati : Buffer());
+    }
+
+    void campiona(int inVolo)
+    {
+        std::lock_guard<std::mutex> lock(mutexStats);
+        sottomissioni++;
+        sommaProfondita += inVolo;
+        stats.profonditaMax = std::max(stats.profonditaMax, inVolo);
+    }
+
+    void leggi(Gruppo& g)
+    {
+        auto inizio = std::chrono::high_resolution_clock::now();
+        // apertura e dimensioni, poi la lista dei blocchi file per file (ordine sequenziale su disco)
+        std::vector<std::unique_ptr<Aperto>> aperti;
+        std::vector<Blocco> blocchi;
+        for (const std::string& path : g.paths)
+        {
+            std::unique_ptr<Aperto> f(new Aperto());
+            f->path = path;
+            unsigned long long size = 0;
+            if (!apri(path, f->h, size))
+            {
+                g.fatto(path, Buffer());
+                continue;
+            }
+            f->dati = std::make_shared<std::vector<unsigned char>>((size_t)size);
+            if (size == 0)
+            {
+                chiudi(f->h);
+                g.fatto(path, f->dati);
+                continue;
+            }
+            size_t n = (size_t)((size + CHUNK - 1) / CHUNK);
+            f->rimanenti = n;
+            for (size_t i = 0; i < n; ++i)
+            {
+                Blocco b;
+                b.file = aperti.size();
+                b.offset = (unsigned long long)i * CHUNK;
+                b.len = (size_t)std::min<unsigned long long>(CHUNK, size - b.offset);
+                b.fatti = 0;
+                blocchi.push_back(b);
+            }
+            aperti.push_back(std::move(f));
+        }
+
+#ifdef ASYNC_IO_URING
+        if (uringOk)
+            leggiUring(aperti, blocchi, g.fatto);
+        else
+#endif
+            leggiThread(aperti, blocchi, g.fatto);
+
+        std::lock_guard<std::mutex> lock(mutexStats);
+        stats.secondi += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizio).count();
+    }
+
+    void leggiThread(std::vector<std::unique_ptr<Aperto>>& aperti, std::vector<Blocco>& blocchi, const Callback& fatto)
+    {
+        // letture bloccanti in parallelo: ogni thread e' una richiesta in volo verso il disco
+        int nThread = (int)std::min<size_t>(profondita, blocchi.size());
+        std::atomic<size_t> prossimo(0);
+        std::atomic<int> inVolo(0);
+        auto lavoro = [&]() {
+            for (size_t i = prossimo++; i < blocchi.size(); i = prossimo++)
+            {
+                const Blocco& b = blocchi[i];
+                Aperto& f = *aperti[b.file];
+                campiona(++inVolo);
+                bool ok = leggiBlocco(f.h, f.dati->data() + b.offset, b.offset, b.len);
+                inVolo--;
+                completato(f, ok, fatto);
+            }
+        };
+        if (nThread <= 1)
+        {
+            lavoro();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutexLettori);
+            while ((int)lettori.size() < profondita - 1)
+                lettori.emplace_back(&AsyncIO::loopLettore, this);
+            lavoroCorrente = lavoro;
+            generazione++;
+        }
+        cvLettori.notify_all();
+        lavoro();
+        // blocchi e buffer sono locali al gruppo: si aspetta che ogni lettore entrato ne sia uscito
+        std::unique_lock<std::mutex> lock(mutexLettori);
+        lavoroCorrente = nullptr;
+        cvLettoriFine.wait(lock, [this] { return occupati == 0; });
+    }
+
+#ifdef ASYNC_IO_URING
+    // Ring minimo sopra le syscall io_uring_setup / io_uring_enter
+    struct Ring {
+        int fd = -1;
+        unsigned entries = 0;
+        unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+        unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+        struct io_uring_sqe* sqes = nullptr;
+        struct io_uring_cqe* cqes = nullptr;
+        void* sqPtr = MAP_FAILED;
+        void* cqPtr = MAP_FAILED;
+        size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+
+        bool init(unsigned n)
+        {
+            struct io_uring_params p;
+            memset(&p, 0, sizeof(p));
+            fd = (int)syscall(__NR_io_uring_setup, n, &p);
+            if (fd < 0)
+                return false;
+            entries = p.sq_entries;
+            sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+            bool unico = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (unico)
+                sqSize = cqSize = std::max(sqSize, cqSize);
+            sqPtr = mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sqPtr == MAP_FAILED)
+                return close(), false;
+            cqPtr = unico ? sqPtr : mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqPtr == MAP_FAILED)
+                return close(), false;
+            sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+            void* s = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (s == MAP_FAILED)
+                return close(), false;
+            sqes = (struct io_uring_sqe*)s;
+            char* sq = (char*)sqPtr;
+            char* cq = (char*)cqPtr;
+            sqHead = (unsigned*)(sq + p.sq_off.head);
+            sqTail = (unsigned*)(sq + p.sq_off.tail);
+            sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+            sqArray = (unsigned*)(sq + p.sq_off.array);
+            cqHead = (unsigned*)(cq + p.cq_off.head);
+            cqTail = (unsigned*)(cq + p.cq_off.tail);
+            cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+            cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+            return true;
+        }
+
+        void close()
+        {
+            if (sqes)
+                munmap(sqes, sqesSize);
+            if (cqPtr != MAP_FAILED && cqPtr != sqPtr)
+                munmap(cqPtr, cqSize);
+            if (sqPtr != MAP_FAILED)
+                munmap(sqPtr, sqSize);
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+            sqes = nullptr;
+            sqPtr = cqPtr = MAP_FAILED;
+        }
+
+        // Accoda una READV; il chiamante garantisce che ci sia posto (in volo < entries)
+        void accoda(int file, const struct iovec* iov, unsigned long long offset, unsigned long long userData)
+        {
+            unsigned tail = *sqTail;
+            unsigned idx = tail & *sqMask;
+            struct io_uring_sqe* sqe = &sqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = file;
+            sqe->addr = (unsigned long long)(uintptr_t)iov;
+            sqe->len = 1;
+            sqe->off = offset;
+            sqe->user_data = userData;
+            sqArray[idx] = idx;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        int enter(unsigned daInviare, unsigned minimo)
+        {
+            return (int)syscall(__NR_io_uring_enter, fd, daInviare, minimo, minimo ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        }
+    };
+    Ring ring;
+    std::atomic<bool> uringOk{ false };
+    std::vector<Buffer> abbandonati;   // buffer di letture rimaste nel kernel alla chiusura del ring
+
+    void leggiUring(std::vector<std::unique_ptr<Aperto>>& aperti, std::vector<Blocco>& blocchi, const Callback& fatto)
+    {
+        size_t prossimo = 0;
+        unsigned inVolo = 0, daInviare = 0;
+        unsigned limite = std::min<unsigned>(ring.entries, (unsigned)profondita);
+        std::vector<size_t> ripeti;   // blocchi da riaccodare dopo una lettura parziale
+        std::deque<size_t> inCoda;    // blocchi accodati nel ring ma non ancora presi dal kernel, in ordine
+        // 0: da leggere (mai inviato, riaccodato o ancora nella coda di invio), 1: nel kernel, 2: finito
+        std::vector<char> stato(blocchi.size(), 0);
+
+        // Consuma le completion disponibili; riaccoda == false (ring in chiusura) lascia i blocchi
+        // incompleti a stato 0, per la lettura sincrona
+        auto raccogli = [&](bool riaccoda) {
+            unsigned head = *ring.cqHead;
+            unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head)
+            {
+                const struct io_uring_cqe& cqe = ring.cqes[head & *ring.cqMask];
+                size_t i = (size_t)cqe.user_data;
+                Blocco& b = blocchi[i];
+                Aperto& f = *aperti[b.file];
+                inVolo--;
+                stato[i] = 0;
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+                {
+                    if (riaccoda)
+                        ripeti.push_back(i);
+                    continue;
+                }
+                bool ok;
+                if (cqe.res > 0)
+                {
+                    b.fatti += (size_t)cqe.res;
+                    if (b.fatti < b.len)
+                    {
+                        if (riaccoda)
+                            ripeti.push_back(i);   // lettura parziale: si riaccoda il resto
+                        continue;
+                    }
+                    ok = true;
+                }
+                else if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP)
+                    // operazione non supportata per questo file: il resto del blocco si legge in modo sincrono
+                    ok = leggiBlocco(f.h, f.dati->data() + b.offset + b.fatti, b.offset + b.fatti, b.len - b.fatti);
+                else
+                    ok = false;   // errore di I/O o file accorciato nel frattempo
+                stato[i] = 2;
+                completato(f, ok, fatto);
+            }
+            __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+        };
+
+        while (prossimo < blocchi.size() || inVolo + daInviare > 0 || !ripeti.empty())
+        {
+            while (inVolo + daInviare < limite && (!ripeti.empty() || prossimo < blocchi.size()))
+            {
+                size_t i;
+                if (!ripeti.empty())
+                {
+                    i = ripeti.back();
+                    ripeti.pop_back();
+                }
+                else
+                    i = prossimo++;
+                Blocco& b = blocchi[i];
+                b.iov.iov_base = aperti[b.file]->dati->data() + b.offset + b.fatti;
+                b.iov.iov_len = b.len - b.fatti;
+                ring.accoda(aperti[b.file]->h, &b.iov, b.offset + b.fatti, i);
+                inCoda.push_back(i);
+                daInviare++;
+            }
+            int r = ring.enter(daInviare, 1);
+            if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                chiudiUring(aperti, blocchi, stato, inVolo, raccogli, fatto);
+                return;
+            }
+            if (r > 0)
+            {
+                inVolo += (unsigned)r;
+                daInviare -= (unsigned)r;
+                for (int k = 0; k < r; ++k)
+                {
+                    stato[inCoda.front()] = 1;
+                    inCoda.pop_front();
+                }
+                campiona((int)inVolo);
+            }
+            raccogli(true);
+        }
+    }
+
+    // Ring inutilizzabile: le letture gia' prese dal kernel possono ancora scrivere nei buffer anche dopo la
+    // chiusura (la dismissione di io_uring e' asincrona), quindi prima si aspettano le loro completion.
+    // Poi si chiude il ring e i blocchi mai inviati o incompleti si leggono con pread.
+    template <typename Raccogli>
+    void chiudiUring(std::vector<std::unique_ptr<Aperto>>& aperti, std::vector<Blocco>& blocchi, std::vector<char>& stato,
+                     unsigned& inVolo, Raccogli& raccogli, const Callback& fatto)
+    {
+        raccogli(false);
+        while (inVolo > 0)
+        {
+            int r = ring.enter(0, 1);
+            if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                break;
+            raccogli(false);
+        }
+        ring.close();
+        uringOk = false;
+        for (size_t i = 0; i < blocchi.size(); ++i)
+        {
+            Blocco& b = blocchi[i];
+            Aperto& f = *aperti[b.file];
+            if (stato[i] == 1)
+            {
+                // completion mai arrivata: il buffer resta in vita fino alla distruzione di AsyncIO e il file fallisce
+                abbandonati.push_back(f.dati);
+                completato(f, false, fatto);
+            }
+            else if (stato[i] == 0)
+                completato(f, leggiBlocco(f.h, f.dati->data() + b.offset + b.fatti, b.offset + b.fatti, b.len - b.fatti), fatto);
+        }
+    }
+#endif
+};
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Contenitore DDS per texture compresse BCn con catena di mipmap precalcolata.
+// Scrittura (usata dal cooker offline tools/texcook) e lettura + upload con glCompressedTexImage2D.
+// Formati: BC1 (DXT1, colore), BC3 (DXT5, colore + alpha), BC4 (ATI1, gloss), BC5 (ATI2, normal map XY).
+// Definire DDS_NO_GL per usare solo la parte senza OpenGL.
+
+namespace dds
+{
+    enum Format { BC1 = 0, BC3, BC4, BC5 };
+
+    inline unsigned int fourCC(char a, char b, char c, char d)
+    {
+        return (unsigned int)a | ((unsigned int)b << 8) | ((unsigned int)c << 16) | ((unsigned int)d << 24);
+    }
+
+    inline int blockBytes(Format f) { return (f == BC1 || f == BC4) ? 8 : 16; }
+
+    inline size_t levelSize(Format f, int width, int height)
+    {
+        size_t bx = (size_t)((width + 3) / 4), by = (size_t)((height + 3) / 4);
+        return (bx ? bx : 1) * (by ? by : 1) * blockBytes(f);
+    }
+
+    struct PixelFormat {
+        unsigned int size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+    };
+    struct Header {
+        unsigned int size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+        unsigned int reserved1[11];
+        PixelFormat pf;
+        unsigned int caps, caps2, caps3, caps4, reserved2;
+    };
+
+    // Immagine compressa: un buffer per ogni livello di mipmap (0 = risoluzione piena)
+    struct Image {
+        Format format = BC1;
+        int width = 0;
+        int height = 0;
+        std::vector<std::vector<unsigned char>> levels;
+    };
+
+    inline bool write(const std::string& path, const Image& img)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        Header h;
+        memset(&h, 0, sizeof(h));
+        h.size = 124;
+        h.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS|HEIGHT|WIDTH|PIXELFORMAT|MIPMAPCOUNT|LINEARSIZE
+        h.height = img.height;
+        h.width = img.width;
+        h.pitchOrLinearSize = (unsigned int)img.levels[0].size();
+        h.mipMapCount = (unsigned int)img.levels.size();
+        h.pf.size = 32;
+        h.pf.flags = 0x4; // DDPF_FOURCC
+        const unsigned int codes[] = { fourCC('D','X','T','1'), fourCC('D','X','T','5'), fourCC('A','T','I','1'), fourCC('A','T','I','2') };
+        h.pf.fourCC = codes[img.format];
+        h.caps = 0x1000 | 0x8 | 0x400000; // TEXTURE|COMPLEX|MIPMAP
+        fwrite("DDS ", 1, 4, f);
+        fwrite(&h, sizeof(h), 1, f);
+        for (const std::vector<unsigned char>& level : img.levels)
+            fwrite(level.data(), 1, level.size(), f);
+        fclose(f);
+        return true;
+    }
+
+    inline bool formatOf(const Header& h, Format& f)
+    {
+        if (!(h.pf.flags & 0x4))
+            return false;
+        if (h.pf.fourCC == fourCC('D','X','T','1')) f = BC1;
+        else if (h.pf.fourCC == fourCC('D','X','T','5')) f = BC3;
+        else if (h.pf.fourCC == fourCC('A','T','I','1') || h.pf.fourCC == fourCC('B','C','4','U')) f = BC4;
+        else if (h.pf.fourCC == fourCC('A','T','I','2') || h.pf.fourCC == fourCC('B','C','5','U')) f = BC5;
+        else return false;
+        return true;
+    }
+
+    // Legge da memoria un DDS prodotto dal cooker copiando solo i livelli [primo, fine): gli altri restano vuoti.
+    // img.levels ha tutti i livelli presenti nel file; ritorna false per formati non supportati
+    inline bool parseLevels(const unsigned char* data, size_t len, int primo, int fine, Image& img)
+    {
+        if (len < 4 + sizeof(Header) || memcmp(data, "DDS ", 4) != 0)
+            return false;
+        Header h;
+        memcpy(&h, data + 4, sizeof(h));
+        if (!formatOf(h, img.format))
+            return false;
+
+        img.width = (int)h.width;
+        img.height = (int)h.height;
+        int mips = h.mipMapCount ? (int)h.mipMapCount : 1;
+        size_t offset = 4 + sizeof(Header);
+        int w = img.width, hh = img.height;
+        img.levels.assign(mips, std::vector<unsigned char>());
+        for (int i = 0; i < mips; ++i)
+        {
+            size_t sz = levelSize(img.format, w, hh);
+            if (offset + sz > len)
+            {
+                img.levels.resize(i);   // file troncato: si tengono i livelli completi
+                break;
+            }
+            if (i >= primo && i < fine)
+                img.levels[i].assign(data + offset, data + offset + sz);
+            offset += sz;
+            w = w > 1 ? w / 2 : 1;
+            hh = hh > 1 ? hh / 2 : 1;
+        }
+        return !img.levels.empty();
+    }
+
+    inline bool parse(const unsigned char* data, size_t len, Image& img)
+    {
+        return parseLevels(data, len, 0, INT_MAX, img);
+    }
+
+    // Legge dal pacchetto degli asset se montato (vfs.h), altrimenti dal disco
+    inline bool read(const std::string& path, Image& img)
+    {
+        vfs::File f;
+        return vfs::open(path, f) && parse(f.data, f.size, img);
+    }
+
+    // Legge l'header e solo i livelli [primo, fine) senza caricare il resto del file (streaming progressivo).
+    // img.levels ha sempre tutti i livelli del file: quelli fuori dall'intervallo restano vuoti.
+    // Se il file e' in memoria (pacchetto o lettura anticipata) e blob non e' nullo, il contenuto aperto
+    // (decompresso una volta per le voci LZ4) resta in *blob e le chiamate successive lo riusano.
+    inline bool readLevels(const std::string& path, int primo, int fine, Image& img, std::shared_ptr<vfs::File>* blob = nullptr)
+    {
+        if (blob && *blob)
+            return parseLevels((*blob)->data, (*blob)->size, primo, fine, img);
+        if (vfs::inMemoria(path))
+        {
+            std::shared_ptr<vfs::File> f = std::make_shared<vfs::File>();
+            if (!vfs::open(path, *f))
+                return false;
+            if (blob)
+                *blob = f;
+            return parseLevels(f->data, f->size, primo, fine, img);
+        }
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f)
+            return false;
+        char magic[4];
+        Header h;
+        bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, "DDS ", 4) == 0
+            && fread(&h, sizeof(h), 1, f) == 1 && formatOf(h, img.format);
+        if (!ok)
+        {
+            fclose(f);
+            return false;
+        }
+
+        img.width = (int)h.width;
+        img.height = (int)h.height;
+        int mips = h.mipMapCount ? (int)h.mipMapCount : 1;
+        img.levels.assign(mips, std::vector<unsigned char>());
+        long offset = (long)(4 + sizeof(Header));
+        int w = img.width, hh = img.height;
+        for (int i = 0; ok && i < mips && i < fine; ++i)
+        {
+            size_t sz = levelSize(img.format, w, hh);
+            if (i >= primo)
+            {
+                img.levels[i].resize(sz);
+                ok = fseek(f, offset, SEEK_SET) == 0 && fread(img.levels[i].data(), 1, sz, f) == sz;
+            }
+            offset += (long)sz;
+            w = w > 1 ? w / 2 : 1;
+            hh = hh > 1 ? hh / 2 : 1;
+        }
+        fclose(f);
+        return ok;
+    }
+
+    // Percorso del file cotto corrispondente a una texture sorgente (stessa cartella, estensione .dds)
+    inline std::string cookedPath(const std::string& sourcePath)
+    {
+        size_t dot = sourcePath.find_last_of('.');
+        size_t slash = sourcePath.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return sourcePath + ".dds";
+        return sourcePath.substr(0, dot) + ".dds";
+    }
+
+    // File che i loader leggeranno per una texture: il DDS cotto se esiste, altrimenti la sorgente
+    inline std::string fileToLoad(const std::string& sourcePath)
+    {
+        std::string cooked = cookedPath(sourcePath);
+        return vfs::exists(cooked) ? cooked : sourcePath;
+    }
+}
+
+#ifndef DDS_NO_GL
+#include <glad/glad.h>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace dds
+{
+    inline GLenum glFormat(Format f)
+    {
+        switch (f)
+        {
+        case BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BC4: return GL_COMPRESSED_RED_RGTC1;
+        default:  return GL_COMPRESSED_RG_RGTC2;
+        }
+    }
+
+    // Crea una texture GL da un'immagine gia' letta (tutti i livelli presenti, niente glGenerateMipmap)
+    inline unsigned int createTexture(const Image& img, bool clamp)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        int w = img.width, h = img.height;
+        for (size_t level = 0; level < img.levels.size(); ++level)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, glFormat(img.format), w, h, 0,
+                (GLsizei)img.levels[level].size(), img.levels[level].data());
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)img.levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
+    // Crea una texture GL dal DDS cotto.
+    // clampIfAlpha: come loadTexture() del progetto, le texture con alpha (BC3) usano GL_CLAMP_TO_EDGE.
+    // Ritorna 0 se il file non esiste o non e' leggibile, cosi' il chiamante puo' ripiegare sull'immagine sorgente.
+    inline unsigned int loadTexture(const std::string& path, bool clampIfAlpha = false)
+    {
+        Image img;
+        if (!read(path, img))
+            return 0;
+        return createTexture(img, clampIfAlpha && img.format == BC3);
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <glad/glad.h>
+
+// Decide se far precedere il pass principale da un pre-pass di sola profondita' (poi GL_EQUAL e niente
+// scritture di profondita'), in base all'overdraw misurato con query GL_SAMPLES_PASSED sul pass principale:
+// - senza pre-pass contano tutti i frammenti che superano il depth test al momento del disegno, cioe'
+//   quelli che progetto.fs calcola, compresi quelli poi coperti da geometria piu' vicina
+// - con il pre-pass contano solo i frammenti visibili
+// Il rapporto tra le due misure e' l'overdraw evitabile: il pre-pass conviene quando supera SOGLIA, perche'
+// costa un secondo passaggio della geometria (solo posizione, senza fragment shader pesante).
+// In automatico si usa la modalita' scelta e ogni FRAME_SONDA frame si misura un frame con l'altra, cosi'
+// la scelta segue la camera e la scena. I risultati delle query si leggono nei frame successivi, senza attese.
+class PrePassProfondita
+{
+public:
+    enum Modo { Spento, Acceso, Automatico };
+
+    static const int FRAME_SONDA = 120;
+    static const int QUERY = 4;             // misure in volo
+
+    struct Stats {
+        bool attivo = false;                // modalita' dell'ultimo frame
+        double frammentiSenza = -1.0;       // frammenti calcolati nell'ultima misura senza pre-pass
+        double frammentiCon = -1.0;         // ... e con il pre-pass (circa i pixel visibili)
+        float overdraw = 0.0f;              // senza / con
+        unsigned long long sonde = 0;       // frame misurati con la modalita' non scelta
+    };
+
+    Modo modo = Automatico;
+    float soglia = 1.3f;
+
+    // Una volta per frame, prima del pass principale: true se il frame usa il pre-pass
+    bool inizia()
+    {
+        raccogli();
+        frame++;
+        bool usa;
+        if (modo != Automatico)
+            usa = modo == Acceso;
+        else if (stats.frammentiSenza < 0.0 && !inVolo(false))
+            usa = false;
+        else if (stats.frammentiCon < 0.0 && !inVolo(true))
+            usa = true;
+        else
+        {
+            usa = scelta;
+            if (frame - ultimaSonda >= FRAME_SONDA)
+            {
+                usa = !scelta;
+                ultimaSonda = frame;
+                stats.sonde++;
+            }
+        }
+        stats.attivo = usa;
+        return usa;
+    }
+
+    // Racchiude il pass principale (solo una misura alla volta per query libera)
+    void iniziaMisura(bool conPrePass)
+    {
+        if (query[0].id == 0)
+            for (Query& q : query)
+                glGenQueries(1, &q.id);
+        corrente = -1;
+        for (int i = 0; i < QUERY && corrente < 0; ++i)
+            if (!query[i].inVolo)
+                corrente = i;
+        if (corrente < 0)
+            return;
+        query[corrente].inVolo = true;
+        query[corrente].conPrePass = conPrePass;
+        glBeginQuery(GL_SAMPLES_PASSED, query[corrente].id);
+    }
+
+    void fineMisura()
+    {
+        if (corrente >= 0)
+            glEndQuery(GL_SAMPLES_PASSED);
+        corrente = -1;
+    }
+
+    Stats getStats() const { return stats; }
+
+private:
+    struct Query {
+        unsigned int id = 0;
+        bool inVolo = false;
+        bool conPrePass = false;
+    };
+
+    Query query[QUERY];
+    int corrente = -1;
+    bool scelta = false;
+    unsigned long long frame = 0, ultimaSonda = 0;
+    Stats stats;
+
+    bool inVolo(bool conPrePass) const
+    {
+        for (const Query& q : query)
+            if (q.inVolo && q.conPrePass == conPrePass)
+                return true;
+        return false;
+    }
+
+    void raccogli()
+    {
+        for (Query& q : query)
+        {
+            if (!q.inVolo)
+                continue;
+            GLint pronta = 0;
+            glGetQueryObjectiv(q.id, GL_QUERY_RESULT_AVAILABLE, &pronta);
+            if (!pronta)
+                continue;
+            GLuint64 frammenti = 0;
+            glGetQueryObjectui64v(q.id, GL_QUERY_RESULT, &frammenti);
+            (q.conPrePass ? stats.frammentiCon : stats.frammentiSenza) = (double)frammenti;
+            q.inVolo = false;
+        }
+        if (stats.frammentiSenza >= 0.0 && stats.frammentiCon > 0.0)
+        {
+            stats.overdraw = (float)(stats.frammentiSenza / stats.frammentiCon);
+            scelta = stats.overdraw > soglia;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef DRAW_INDIRECT_H
+#define DRAW_INDIRECT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/material_table.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_arena.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// Funzioni e costanti di GL 4.3 assenti da glad (generato fino a 4.2): caricate a mano in DrawIndiretto::init
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECT)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+// Percorso GPU-driven per i modelli della scena (richiede un contesto OpenGL 4.3):
+// durante il pass le mesh non vengono disegnate ma registrate (registra); esegui() le trasforma in
+// una tabella dei disegni in un SSBO (matrice modello, materiale, intervallo nell'arena) e in comandi
+// DrawElementsIndirectCommand, e li esegue con glMultiDrawElementsIndirect.
+// - tabella e comandi si riscrivono solo quando la lista del pass cambia (sceneState, livelli di dettaglio,
+//   visibilita'); altrimenti il pass non carica nulla sulla GPU
+// - l'indice del disegno arriva allo shader come attributo per istanza (location 7) letto da un buffer
+//   0, 1, 2...: il baseInstance del comando seleziona l'elemento, senza ARB_shader_draw_parameters
+// - le mesh condividono l'arena (mesh_arena.h), quindi basta un VAO: una chiamata per pass senza texture
+//   (shadow map), una per gruppo di texture nel pass principale (i comandi sono ordinati per materiale)
+// - con la tabella dei materiali (setTabella, material_table.h) le mesh i cui materiali sono in tabella e
+//   quelle senza texture proprie formano un solo gruppo: lo shader legge le texture dagli array
+// Gli shader usano la permutazione DISEGNO_INDIRETTO (vedi progetto.vs e shadow_mapping.vs).
+class DrawIndiretto
+{
+public:
+    static const int PASSI = 5;             // pass principale + 3 shadow map + pre-pass di profondita'
+    static const int PASSO_PREPASS = 4;
+    static const int MAX_DISEGNI = 1024;    // mesh per pass
+
+    // Layout std430 condiviso con gli shader (struct Disegno)
+    struct Disegno {
+        glm::mat4 model;
+        unsigned int materiale;     // indice nella tabella dei materiali, NESSUNO = texture legate
+        unsigned int primoIndice;
+        unsigned int numeroIndici;
+        int baseVertex;
+    };
+
+    struct Comando {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int baseInstance;
+    };
+
+    struct Stats {
+        int chiamate = 0;                       // glMultiDrawElementsIndirect nell'ultimo pass principale
+        int comandi = 0;                        // disegni nell'ultimo pass principale
+        unsigned long long ricostruzioni = 0;   // tabelle riscritte (tutti i pass)
+    };
+
+    // Richiede GL >= 4.3 e il caricamento delle funzioni mancanti; da chiamare dopo aver caricato i modelli
+    bool init(GLADloadproc carica)
+    {
+        if (GLVersion.major * 10 + GLVersion.minor < 43)
+        {
+            std::cout << "Multi-draw indirect non disponibile: contesto OpenGL " << GLVersion.major << "." << GLVersion.minor << std::endl;
+            return false;
+        }
+        glMultiDrawElementsIndirect_ = (PFNMULTIDRAWELEMENTSINDIRECT)carica("glMultiDrawElementsIndirect");
+        if (!glMultiDrawElementsIndirect_)
+        {
+            std::cout << "Multi-draw indirect non disponibile: glMultiDrawElementsIndirect mancante" << std::endl;
+            return false;
+        }
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &idBuffer);
+        glGenBuffers(1, &comandiBuffer);
+        glGenBuffers(1, &disegniBuffer);
+        std::vector<unsigned int> id(PASSI * MAX_DISEGNI);
+        for (size_t i = 0; i < id.size(); ++i)
+            id[i] = (unsigned int)i;
+        glBindBuffer(GL_ARRAY_BUFFER, idBuffer);
+        glBufferData(GL_ARRAY_BUFFER, id.size() * sizeof(unsigned int), id.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, comandiBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, PASSI * MAX_DISEGNI * sizeof(Comando), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, disegniBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, PASSI * MAX_DISEGNI * sizeof(Disegno), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        configuraVao();
+        return true;
+    }
+
+    bool attivo() const { return VAO != 0; }
+    Stats getStats() const { return stats; }
+
+    // Tabella dei materiali gia' costruita (nullptr per legare le texture di ogni gruppo)
+    void setTabella(const TabellaMateriali* t)
+    {
+        tabella = t && t->attiva() ? t : nullptr;
+        for (Lista& l : liste)
+            l.valida = false;
+    }
+
+    // Accoda una mesh al pass corrente al livello di dettaglio lod
+    void registra(const Mesh& mesh, const glm::mat4& model, int lod)
+    {
+        size_t livello = std::min<size_t>(lod, mesh.lodCount.size() - 1);
+        Disegno d;
+        d.model = model;
+        d.materiale = TabellaMateriali::NESSUNO;
+        unsigned int gruppo = 0;   // 0: nessuna texture da legare oltre al materiale di base
+        if (tabella && !mesh.textures.empty())
+            d.materiale = tabella->trova(TabellaMateriali::terna(mesh));
+        if (!mesh.textures.empty() && d.materiale == TabellaMateriali::NESSUNO)
+            gruppo = materiale(mesh) + 1;
+        d.primoIndice = mesh.firstIndex + mesh.lodFirst[livello];
+        d.numeroIndici = mesh.lodCount[livello];
+        d.baseVertex = (int)mesh.baseVertex;
+        inAttesa.push_back(d);
+        gruppiAttesa.push_back(gruppo);
+    }
+
+    // Esegue i disegni registrati per il pass. Con bindMateriale (pass principale) i comandi sono raggruppati
+    // per materiale: prima di ogni gruppo si chiama bindMateriale() e si legano le texture delle sue mesh
+    // (nessuna per il gruppo 0, che con la tabella contiene tutti i materiali in tabella).
+    void esegui(int passo, Shader& shader, const std::function<void()>& bindMateriale = std::function<void()>())
+    {
+        bool conTexture = (bool)bindMateriale;
+        Lista& lista = liste[passo];
+        if (conTexture)
+        {
+            std::vector<size_t> ordine(inAttesa.size());
+            for (size_t i = 0; i < ordine.size(); ++i)
+                ordine[i] = i;
+            std::stable_sort(ordine.begin(), ordine.end(), [&](size_t a, size_t b) { return gruppiAttesa[a] < gruppiAttesa[b]; });
+            std::vector<Disegno> disegni(inAttesa.size());
+            std::vector<unsigned int> gruppi(inAttesa.size());
+            for (size_t i = 0; i < ordine.size(); ++i)
+            {
+                disegni[i] = inAttesa[ordine[i]];
+                gruppi[i] = gruppiAttesa[ordine[i]];
+            }
+            inAttesa.swap(disegni);
+            gruppiAttesa.swap(gruppi);
+        }
+        if (inAttesa.size() > MAX_DISEGNI)
+        {
+            std::cout << "ERROR::DRAW_INDIRECT:: " << inAttesa.size() << " disegni nel pass, massimo " << MAX_DISEGNI << std::endl;
+            inAttesa.resize(MAX_DISEGNI);
+            gruppiAttesa.resize(MAX_DISEGNI);
+        }
+        // l'intervallo di indici identifica la mesh, quindi disegni uguali implicano gruppi uguali
+        if (!lista.valida || lista.disegni.size() != inAttesa.size()
+            || memcmp(lista.disegni.data(), inAttesa.data(), inAttesa.size() * sizeof(Disegno)) != 0)
+            ricostruisci(passo, lista);
+        inAttesa.clear();
+        gruppiAttesa.clear();
+        if (lista.disegni.empty())
+            return;
+
+        if (arenaRicrescite != MeshArena<Vertex>::shared().getStats().ricrescite)
+            configuraVao();
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, comandiBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, disegniBuffer);
+        shader.setBool("disegnoIndiretto", true);
+        if (conTexture && tabella)
+            tabella->bind(shader);
+        int chiamate = 0;
+        for (const Gruppo& g : lista.gruppi)
+        {
+            if (conTexture)
+            {
+                bindMateriale();
+                if (g.gruppo > 0)
+                    mesh[g.gruppo - 1]->BindTextures(shader);
+            }
+            size_t offset = ((size_t)passo * MAX_DISEGNI + g.primo) * sizeof(Comando);
+            glMultiDrawElementsIndirect_(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)offset, (GLsizei)g.numero, 0);
+            chiamate++;
+        }
+        shader.setBool("disegnoIndiretto", false);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        if (passo == 0)
+        {
+            stats.chiamate = chiamate;
+            stats.comandi = (int)lista.disegni.size();
+        }
+    }
+
+private:
+    struct Gruppo { size_t primo, numero; unsigned int gruppo; };
+    struct Lista {
+        bool valida = false;
+        std::vector<Disegno> disegni;
+        std::vector<Gruppo> gruppi;
+    };
+
+    PFNMULTIDRAWELEMENTSINDIRECT glMultiDrawElementsIndirect_ = nullptr;
+    unsigned int VAO = 0, idBuffer = 0, comandiBuffer = 0, disegniBuffer = 0;
+    int arenaRicrescite = -1;
+    Lista liste[PASSI];
+    std::vector<Disegno> inAttesa;
+    std::vector<unsigned int> gruppiAttesa;
+    const TabellaMateriali* tabella = nullptr;
+    // materiale = insieme di texture della mesh; mesh[i] e' una mesh rappresentativa del materiale i
+    std::map<std::vector<unsigned int>, unsigned int> materiali;
+    std::vector<const Mesh*> mesh;
+    Stats stats;
+
+    unsigned int materiale(const Mesh& m)
+    {
+        std::vector<unsigned int> chiave;
+        for (const Texture& t : m.textures)
+            chiave.push_back(t.id);
+        auto it = materiali.find(chiave);
+        if (it != materiali.end())
+            return it->second;
+        unsigned int id = (unsigned int)mesh.size();
+        materiali[chiave] = id;
+        mesh.push_back(&m);
+        return id;
+    }
+
+    void ricostruisci(int passo, Lista& lista)
+    {
+        lista.disegni = inAttesa;
+        lista.gruppi.clear();
+        std::vector<Comando> comandi(lista.disegni.size());
+        for (size_t i = 0; i < lista.disegni.size(); ++i)
+        {
+            const Disegno& d = lista.disegni[i];
+            comandi[i] = { d.numeroIndici, 1, d.primoIndice, d.baseVertex, (unsigned int)(passo * MAX_DISEGNI + i) };
+            if (lista.gruppi.empty() || lista.gruppi.back().gruppo != gruppiAttesa[i])
+                lista.gruppi.push_back({ i, 0, gruppiAttesa[i] });
+            lista.gruppi.back().numero++;
+        }
+        // senza texture (shadow map) i materiali non contano: un solo gruppo
+        if (!lista.gruppi.empty() && passo != 0)
+            lista.gruppi.assign(1, { 0, lista.disegni.size(), 0 });
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, comandiBuffer);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, (size_t)passo * MAX_DISEGNI * sizeof(Comando), comandi.size() * sizeof(Comando), comandi.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, disegniBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (size_t)passo * MAX_DISEGNI * sizeof(Disegno), lista.disegni.size() * sizeof(Disegno), lista.disegni.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        lista.valida = true;
+        stats.ricostruzioni++;
+    }
+
+    // Attributi dell'arena + indice del disegno per istanza (location 7)
+    void configuraVao()
+    {
+        MeshArena<Vertex>::shared().configura(VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, idBuffer);
+        glEnableVertexAttribArray(7);
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+        glVertexAttribDivisor(7, 1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        arenaRicrescite = MeshArena<Vertex>::shared().getStats().ricrescite;
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/offscreen.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Risoluzione dinamica del pass principale: la scena si renderizza in un target fuori schermo alla
+// risoluzione nativa, usandone solo la porzione scala * nativa, e poi viene portata alla finestra con un
+// upscaling bilineare + maschera di contrasto adattiva (upscale.fs). ImGui resta alla risoluzione nativa.
+// La scala segue il tempo GPU del frame, misurato con query GL_TIME_ELAPSED lette nei frame successivi
+// (nessuna attesa), per restare entro budgetMs:
+// - media esponenziale del tempo GPU, poi scala desiderata = scala * sqrt(budget * MARGINE / tempo)
+//   (il costo cresce circa con i pixel, cioe' con il quadrato della scala)
+// - la scala si muove a passi di PASSO e al massimo ogni FRAME_TRA_CAMBI frame, cosi' non oscilla
+// Il target si ricrea solo quando cambia la dimensione nativa, non quando cambia la scala.
+class RisoluzioneDinamica
+{
+public:
+    static const int QUERY = 4;                 // misure in volo
+    static const int FRAME_TRA_CAMBI = 30;
+    static constexpr float PASSO = 0.05f;
+    static constexpr float MARGINE = 0.9f;      // si punta al 90% del budget
+
+    struct Stats {
+        float scala = 1.0f;
+        int width = 0, height = 0;              // risoluzione renderizzata
+        float msGpu = 0.0f;                     // media del tempo GPU del pass principale
+        int cambi = 0;
+    };
+
+    bool attiva = true;
+    float budgetMs = 16.7f;
+    float scalaMinima = 0.5f;
+    float nitidezza = 0.5f;                     // 0..1
+
+    // Prima del pass principale: raccoglie le misure, aggiorna la scala e prepara il target nativo
+    void iniziaFrame(int nativaW, int nativaH)
+    {
+        if (query[0].id == 0)
+        {
+            for (Query& q : query)
+                glGenQueries(1, &q.id);
+            glGenVertexArrays(1, &vaoVuoto);
+        }
+        raccogli();
+        if (target.width != nativaW || target.height != nativaH)
+            target.create(nativaW, nativaH);
+        aggiornaScala();
+        stats.width = std::max(1, (int)(nativaW * stats.scala + 0.5f));
+        stats.height = std::max(1, (int)(nativaH * stats.scala + 0.5f));
+    }
+
+    unsigned int fbo() const { return target.FBO; }
+    int width() const { return stats.width; }
+    int height() const { return stats.height; }
+
+    // Racchiude il pass principale (una misura alla volta per query libera)
+    void iniziaMisura()
+    {
+        corrente = -1;
+        for (int i = 0; i < QUERY && corrente < 0; ++i)
+            if (!query[i].inVolo)
+                corrente = i;
+        if (corrente < 0)
+            return;
+        query[corrente].inVolo = true;
+        glBeginQuery(GL_TIME_ELAPSED, query[corrente].id);
+    }
+
+    void fineMisura()
+    {
+        if (corrente >= 0)
+            glEndQuery(GL_TIME_ELAPSED);
+        corrente = -1;
+    }
+
+    // Porta la porzione renderizzata nel framebuffer fbo (nativaW x nativaH): copia diretta a scala piena,
+    // altrimenti upscaling con maschera di contrasto
+    void presenta(Shader& upscale, unsigned int fbo, int nativaW, int nativaH)
+    {
+        if (stats.width == target.width && stats.height == target.height)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, target.FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+            glBlitFramebuffer(0, 0, target.width, target.height, 0, 0, nativaW, nativaH, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            return;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, nativaW, nativaH);
+        glDisable(GL_DEPTH_TEST);
+        upscale.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, target.colorTex);
+        upscale.setInt("scena", 0);
+        upscale.setVec2("scala", (float)stats.width / target.width, (float)stats.height / target.height);
+        upscale.setFloat("nitidezza", nitidezza);
+        glBindVertexArray(vaoVuoto);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    Stats getStats() const { return stats; }
+
+private:
+    struct Query {
+        unsigned int id = 0;
+        bool inVolo = false;
+    };
+
+    OffscreenTarget target;
+    unsigned int vaoVuoto = 0;              // upscale.fs disegna un triangolo a schermo intero senza vertex buffer
+    Query query[QUERY];
+    int corrente = -1;
+    bool misurato = false;
+    int frameDalCambio = 0;
+    Stats stats;
+
+    void raccogli()
+    {
+        for (Query& q : query)
+        {
+            if (!q.inVolo)
+                continue;
+            GLint pronta = 0;
+            glGetQueryObjectiv(q.id, GL_QUERY_RESULT_AVAILABLE, &pronta);
+            if (!pronta)
+                continue;
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(q.id, GL_QUERY_RESULT, &ns);
+            float ms = (float)(ns / 1.0e6);
+            stats.msGpu = misurato ? stats.msGpu + 0.1f * (ms - stats.msGpu) : ms;
+            misurato = true;
+            q.inVolo = false;
+        }
+    }
+
+    void aggiornaScala()
+    {
+        frameDalCambio++;
+        float scala = stats.scala;
+        if (!attiva)
+            scala = 1.0f;
+        else if (misurato && stats.msGpu > 0.0f && frameDalCambio >= FRAME_TRA_CAMBI)
+        {
+            float desiderata = stats.scala * std::sqrt(budgetMs * MARGINE / stats.msGpu);
+            desiderata = std::min(1.0f, std::max(scalaMinima, desiderata));
+            // a passi di PASSO, e solo se la differenza supera mezzo passo (isteresi)
+            if (std::fabs(desiderata - stats.scala) > 0.5f * PASSO)
+                scala = std::min(1.0f, std::max(scalaMinima, std::round(desiderata / PASSO) * PASSO));
+        }
+        if (scala != stats.scala)
+        {
+            stats.scala = scala;
+            stats.cambi++;
+            frameDalCambio = 0;
+        }
+    }
+};
+
+#endif
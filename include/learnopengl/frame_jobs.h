@@ -0,0 +1,391 @@
+#ifndef FRAME_JOBS_H
+#define FRAME_JOBS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <learnopengl/mip_feedback.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Traccia di animazione a chiavi di posizione e rotazione (come Bone in bone.h, senza scala), in ciclo su durata
+struct TracciaAnimazione {
+    struct ChiavePosizione { glm::vec3 posizione; float tempo; };
+    struct ChiaveRotazione { glm::quat rotazione; float tempo; };
+
+    std::vector<ChiavePosizione> posizioni;
+    std::vector<ChiaveRotazione> rotazioni;
+    float durata = 1.0f;
+
+    glm::mat4 campiona(float t) const
+    {
+        t = std::fmod(t, durata);
+        if (t < 0.0f)
+            t += durata;
+        glm::vec3 p = posizioni.empty() ? glm::vec3(0.0f) : posizioni.back().posizione;
+        for (size_t i = 0; i + 1 < posizioni.size(); ++i)
+            if (t < posizioni[i + 1].tempo)
+            {
+                float f = (t - posizioni[i].tempo) / (posizioni[i + 1].tempo - posizioni[i].tempo);
+                p = glm::mix(posizioni[i].posizione, posizioni[i + 1].posizione, f);
+                break;
+            }
+        glm::quat q = rotazioni.empty() ? glm::quat(1.0f, 0.0f, 0.0f, 0.0f) : rotazioni.back().rotazione;
+        for (size_t i = 0; i + 1 < rotazioni.size(); ++i)
+            if (t < rotazioni[i + 1].tempo)
+            {
+                float f = (t - rotazioni[i].tempo) / (rotazioni[i + 1].tempo - rotazioni[i].tempo);
+                q = glm::normalize(glm::slerp(rotazioni[i].rotazione, rotazioni[i + 1].rotazione, f));
+                break;
+            }
+        return glm::translate(glm::mat4(1.0f), p) * glm::mat4_cast(q);
+    }
+};
+
+// Lavori CPU di un frame su una scena di istanze, come grafo sul job system (thread_pool.h):
+//
+//   animazione -> culling ---+
+//                            +--> lista di rendering
+//   binning delle luci ------+
+//
+// - animazione: ogni istanza campiona la propria traccia al tempo t (piu' la sua fase) e compone la matrice
+//   modello e il bounding box in spazio mondo
+// - culling: bounding box contro il frustum, con lo stesso test del feedback dei mipmap (mip_feedback.h)
+// - binning: le luci puntiformi in una griglia di celle sul piano XZ; ogni riga di celle e' scritta da un solo
+//   lavoro, quindi senza atomici; oltre MAX_LUCI_CELLA luci per cella le luci si scartano (e si contano)
+// - lista di rendering: per ogni istanza visibile fino a MAX_LUCI_ISTANZA luci, le piu' vicine tra quelle delle
+//   celle toccate; poi ordinamento per chiave (materiale, mesh, istanza): ogni blocco ordina la propria parte
+//   e le parti si fondono a coppie in parallelo. La chiave e' unica, quindi la lista non dipende dai thread.
+// Ogni fase e' un parallelFor annidato nel proprio nodo: animazione e binning procedono insieme.
+class LavoriFrame
+{
+public:
+    static const int MAX_LUCI_ISTANZA = 8;
+    static const int MAX_LUCI_CELLA = 64;
+    static const int MAX_ISTANZE = 1 << 20;     // l'indice dell'istanza occupa 20 bit della chiave
+
+    struct Istanza {
+        glm::vec3 posizione = glm::vec3(0.0f);
+        float scala = 1.0f;
+        int traccia = 0;                    // indice in tracce
+        float fase = 0.0f;                  // secondi aggiunti al tempo della traccia
+        glm::vec3 minimo = glm::vec3(-0.5f), massimo = glm::vec3(0.5f);   // bounds in spazio modello
+        unsigned int mesh = 0;
+        unsigned int materiale = 0;
+    };
+
+    struct Luce {
+        glm::vec3 posizione;
+        float raggio;
+    };
+
+    // Voce della lista di rendering: chiave = materiale (bit 40..63), mesh (20..39), istanza (0..19)
+    struct Voce {
+        uint64_t chiave;
+        int istanza;
+        int numeroLuci;
+        int luci[MAX_LUCI_ISTANZA];
+    };
+
+    struct Stats {
+        int istanze = 0;
+        int visibili = 0;
+        int luci = 0;
+        int celle = 0;
+        int luciScartate = 0;               // luci oltre MAX_LUCI_CELLA in una cella
+        double ms = 0.0;                    // ultimo frame, grafo completo
+    };
+
+    std::vector<TracciaAnimazione> tracce;
+    std::vector<Istanza> istanze;
+    std::vector<Luce> luci;
+    float dimensioneCella = 8.0f;
+
+    explicit LavoriFrame(ThreadPool& pool) : pool(pool)
+    {
+        int animazione = grafo.aggiungi([this]() { anima(); });
+        int culling = grafo.aggiungi([this]() { seleziona(); }, { animazione });
+        int binning = grafo.aggiungi([this]() { distribuisciLuci(); });
+        grafo.aggiungi([this]() { costruisciLista(); }, { culling, binning });
+    }
+
+    LavoriFrame(const LavoriFrame&) = delete;
+    LavoriFrame& operator=(const LavoriFrame&) = delete;
+
+    // Esegue il grafo del frame al tempo t (secondi) per l'osservatore viewProj
+    void esegui(float t, const glm::mat4& viewProj)
+    {
+        auto inizio = std::chrono::steady_clock::now();
+        tempo = t;
+        vistaProiezione = viewProj;
+        size_t n = istanze.size();
+        mondo.resize(n);
+        boxMondo.resize(n);
+        visibili.resize(n);
+        pool.esegui(grafo);
+        stats.istanze = (int)n;
+        stats.visibili = (int)lista.size();
+        stats.luci = (int)luci.size();
+        stats.celle = celleX * celleZ;
+        stats.luciScartate = scartate;
+        stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inizio).count();
+    }
+
+    const std::vector<Voce>& listaRender() const { return lista; }
+    const std::vector<glm::mat4>& matrici() const { return mondo; }
+    Stats getStats() const { return stats; }
+
+    // Scena sintetica per il benchmark: n istanze su una griglia (2 unita' di passo) con 16 tracce in ciclo,
+    // 64 mesh e 32 materiali, e nLuci luci sparse sulla stessa area. Deterministica.
+    void generaScenaSintetica(int n, int nLuci)
+    {
+        tracce.assign(16, TracciaAnimazione());
+        for (size_t k = 0; k < tracce.size(); ++k)
+        {
+            TracciaAnimazione& tr = tracce[k];
+            tr.durata = 2.0f + k * 0.25f;
+            int chiavi = 4 + (int)(k % 5) * 3;
+            for (int c = 0; c <= chiavi; ++c)
+            {
+                float t = tr.durata * c / chiavi;
+                float a = 6.2831853f * c / chiavi;
+                // la prima e l'ultima chiave coincidono: il ciclo non scatta
+                glm::vec3 p = c == chiavi ? glm::vec3(0.0f) : glm::vec3(0.3f * std::sin(a * (1 + k % 3)), 0.2f * std::sin(a), 0.3f * std::cos(a * (1 + k % 2)) - 0.3f);
+                tr.posizioni.push_back({ p, t });
+                tr.rotazioni.push_back({ glm::angleAxis(a, glm::normalize(glm::vec3(0.2f * (k % 4), 1.0f, 0.1f * (k % 3)))), t });
+            }
+        }
+        n = std::max(0, std::min(n, MAX_ISTANZE));
+        int lato = std::max(1, (int)std::ceil(std::sqrt((double)n)));
+        istanze.assign(n, Istanza());
+        for (int i = 0; i < n; ++i)
+        {
+            unsigned int h = hash((unsigned int)i);
+            Istanza& is = istanze[i];
+            is.posizione = glm::vec3(2.0f * (i % lato - lato * 0.5f), 0.0f, 2.0f * (i / lato - lato * 0.5f));
+            is.scala = 0.5f + (h & 0xff) / 255.0f;
+            is.traccia = (int)((h >> 8) % tracce.size());
+            is.fase = ((h >> 12) & 0xff) / 64.0f;
+            is.mesh = (h >> 20) % 64;
+            is.materiale = (h >> 26) % 32;
+        }
+        luci.assign(nLuci, Luce());
+        float meta = lato * 1.0f;
+        for (int i = 0; i < nLuci; ++i)
+        {
+            unsigned int h = hash((unsigned int)i + 0x9e3779b9u);
+            luci[i].posizione = glm::vec3(((h & 0xffff) / 65535.0f * 2.0f - 1.0f) * meta, 2.5f,
+                                          (((h >> 16) & 0xffff) / 65535.0f * 2.0f - 1.0f) * meta);
+            luci[i].raggio = 3.0f + (hash(h) % 8);
+        }
+    }
+
+private:
+    ThreadPool& pool;
+    GrafoLavori grafo;
+    float tempo = 0.0f;
+    glm::mat4 vistaProiezione = glm::mat4(1.0f);
+    Stats stats;
+
+    std::vector<glm::mat4> mondo;
+    std::vector<SuperficieMip> boxMondo;
+    std::vector<unsigned char> visibili;
+
+    // griglia delle luci: per cella un conteggio e fino a MAX_LUCI_CELLA indici
+    glm::vec2 origineGriglia = glm::vec2(0.0f);
+    int celleX = 0, celleZ = 0;
+    std::vector<int> conteggioCella;
+    std::vector<int> luciCella;
+    std::atomic<int> scartate{ 0 };
+
+    std::vector<std::vector<Voce>> parti;   // per blocco, riusate tra i frame
+    std::vector<size_t> inizioParte;
+    std::vector<Voce> lista;
+
+    static unsigned int hash(unsigned int x)
+    {
+        x ^= x >> 16; x *= 0x7feb352du;
+        x ^= x >> 15; x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    void anima()
+    {
+        pool.parallelFor((int)istanze.size(), [this](int i) {
+            const Istanza& is = istanze[i];
+            glm::mat4 m = glm::translate(glm::mat4(1.0f), is.posizione) * glm::scale(glm::mat4(1.0f), glm::vec3(is.scala));
+            if (is.traccia >= 0 && is.traccia < (int)tracce.size())
+                m = m * tracce[is.traccia].campiona(tempo + is.fase);
+            mondo[i] = m;
+            SuperficieMip locale;
+            locale.minimo = is.minimo;
+            locale.massimo = is.massimo;
+            boxMondo[i] = trasforma(locale, m);
+        }, 256);
+    }
+
+    void seleziona()
+    {
+        pool.parallelFor((int)istanze.size(), [this](int i) {
+            visibili[i] = visibile(boxMondo[i], vistaProiezione) ? 1 : 0;
+        }, 512);
+    }
+
+    void distribuisciLuci()
+    {
+        scartate = 0;
+        if (luci.empty())
+        {
+            celleX = celleZ = 0;
+            return;
+        }
+        glm::vec2 minimo(1e30f), massimo(-1e30f);
+        for (const Luce& l : luci)
+        {
+            minimo = glm::min(minimo, glm::vec2(l.posizione.x, l.posizione.z) - l.raggio);
+            massimo = glm::max(massimo, glm::vec2(l.posizione.x, l.posizione.z) + l.raggio);
+        }
+        origineGriglia = minimo;
+        celleX = std::max(1, (int)std::ceil((massimo.x - minimo.x) / dimensioneCella));
+        celleZ = std::max(1, (int)std::ceil((massimo.y - minimo.y) / dimensioneCella));
+        conteggioCella.assign((size_t)celleX * celleZ, 0);
+        luciCella.resize((size_t)celleX * celleZ * MAX_LUCI_CELLA);
+
+        // una riga di celle per indice: ogni lavoro scrive solo le celle della propria riga
+        pool.parallelFor(celleZ, [this](int z) {
+            float z0 = origineGriglia.y + z * dimensioneCella, z1 = z0 + dimensioneCella;
+            for (int li = 0; li < (int)luci.size(); ++li)
+            {
+                const Luce& l = luci[li];
+                if (l.posizione.z + l.raggio < z0 || l.posizione.z - l.raggio > z1)
+                    continue;
+                int x0, x1;
+                if (!intervalloCelle(l.posizione.x - l.raggio, l.posizione.x + l.raggio, x0, x1))
+                    continue;
+                for (int x = x0; x <= x1; ++x)
+                {
+                    size_t cella = (size_t)z * celleX + x;
+                    if (conteggioCella[cella] == MAX_LUCI_CELLA)
+                    {
+                        scartate++;
+                        continue;
+                    }
+                    luciCella[cella * MAX_LUCI_CELLA + conteggioCella[cella]++] = li;
+                }
+            }
+        }, 1);
+    }
+
+    // celle lungo X (o Z, con origine diversa) coperte da [a, b]; false se fuori dalla griglia
+    bool intervalloCelle(float a, float b, int& c0, int& c1, bool asseZ = false) const
+    {
+        float origine = asseZ ? origineGriglia.y : origineGriglia.x;
+        int n = asseZ ? celleZ : celleX;
+        c0 = std::max(0, (int)std::floor((a - origine) / dimensioneCella));
+        c1 = std::min(n - 1, (int)std::floor((b - origine) / dimensioneCella));
+        return c0 <= c1;
+    }
+
+    // luci che toccano il box, le MAX_LUCI_ISTANZA piu' vicine al centro
+    void luciIstanza(const SuperficieMip& box, Voce& v) const
+    {
+        v.numeroLuci = 0;
+        int x0, x1, z0, z1;
+        if (celleX == 0 || !intervalloCelle(box.minimo.x, box.massimo.x, x0, x1) ||
+            !intervalloCelle(box.minimo.z, box.massimo.z, z0, z1, true))
+            return;
+        glm::vec3 centro = 0.5f * (box.minimo + box.massimo);
+        float distanze[MAX_LUCI_ISTANZA];
+        for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x)
+            {
+                size_t cella = (size_t)z * celleX + x;
+                for (int k = 0; k < conteggioCella[cella]; ++k)
+                {
+                    int li = luciCella[cella * MAX_LUCI_CELLA + k];
+                    if (std::find(v.luci, v.luci + v.numeroLuci, li) != v.luci + v.numeroLuci)
+                        continue;
+                    const Luce& l = luci[li];
+                    glm::vec3 vicino = glm::clamp(l.posizione, box.minimo, box.massimo);
+                    glm::vec3 d = l.posizione - vicino;
+                    if (glm::dot(d, d) > l.raggio * l.raggio)
+                        continue;
+                    float distanza = glm::length(l.posizione - centro);
+                    // inserimento ordinato per distanza; la piu' lontana esce se la lista e' piena
+                    int pos = v.numeroLuci;
+                    if (pos == MAX_LUCI_ISTANZA)
+                    {
+                        if (distanza >= distanze[pos - 1])
+                            continue;
+                        pos--;
+                    }
+                    else
+                        v.numeroLuci++;
+                    while (pos > 0 && (distanze[pos - 1] > distanza || (distanze[pos - 1] == distanza && v.luci[pos - 1] > li)))
+                    {
+                        distanze[pos] = distanze[pos - 1];
+                        v.luci[pos] = v.luci[pos - 1];
+                        pos--;
+                    }
+                    distanze[pos] = distanza;
+                    v.luci[pos] = li;
+                }
+            }
+    }
+
+    void costruisciLista()
+    {
+        int n = (int)istanze.size();
+        int blocchi = std::max(1, std::min(n, pool.size() * 4));
+        parti.resize(blocchi);
+        inizioParte.assign(blocchi + 1, 0);
+
+        // ogni blocco di istanze produce e ordina la propria parte
+        pool.parallelFor(blocchi, [this, n, blocchi](int b) {
+            std::vector<Voce>& parte = parti[b];
+            parte.clear();
+            int inizio = (int)((long long)n * b / blocchi), fine = (int)((long long)n * (b + 1) / blocchi);
+            for (int i = inizio; i < fine; ++i)
+            {
+                if (!visibili[i])
+                    continue;
+                Voce v;
+                v.istanza = i;
+                v.chiave = ((uint64_t)istanze[i].materiale << 40) | ((uint64_t)(istanze[i].mesh & 0xfffff) << 20) | (uint64_t)(i & 0xfffff);
+                luciIstanza(boxMondo[i], v);
+                parte.push_back(v);
+            }
+            std::sort(parte.begin(), parte.end(), [](const Voce& a, const Voce& c) { return a.chiave < c.chiave; });
+        }, 1);
+
+        for (int b = 0; b < blocchi; ++b)
+            inizioParte[b + 1] = inizioParte[b] + parti[b].size();
+        lista.resize(inizioParte[blocchi]);
+        pool.parallelFor(blocchi, [this](int b) {
+            std::copy(parti[b].begin(), parti[b].end(), lista.begin() + inizioParte[b]);
+        }, 1);
+
+        // fusione a coppie: a ogni livello le coppie di parti adiacenti si fondono in parallelo
+        for (int larghezza = 1; larghezza < blocchi; larghezza *= 2)
+        {
+            int coppie = (blocchi + 2 * larghezza - 1) / (2 * larghezza);
+            pool.parallelFor(coppie, [this, larghezza, blocchi](int c) {
+                int a = c * 2 * larghezza;
+                int meta = std::min(blocchi, a + larghezza), fine = std::min(blocchi, a + 2 * larghezza);
+                if (meta < fine)
+                    std::inplace_merge(lista.begin() + inizioParte[a], lista.begin() + inizioParte[meta], lista.begin() + inizioParte[fine],
+                                       [](const Voce& x, const Voce& y) { return x.chiave < y.chiave; });
+            }, 1);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/stream_buffer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+
+// Frame in volo espliciti per il ciclo interattivo: a fine frame (prima dello swap) un fence e un timestamp
+// GPU chiudono i comandi del frame; all'inizio del frame successivo la CPU aspetta finche' i frame non ancora
+// completati dalla GPU sono meno di frameInVolo. Cosi' la distanza tra CPU e GPU non dipende dal driver:
+// - 1 frame: CPU e GPU in serie, latenza minima, throughput minimo
+// - 2-3 frame: la CPU prepara il frame successivo mentre la GPU disegna, latenza piu' alta
+// I dati che cambiano a ogni frame (matrici per oggetto, stream_buffer.h) hanno MAX_IN_VOLO copie, quindi
+// con frameInVolo <= MAX_IN_VOLO i fence del buffer circolare non devono mai aspettare.
+// La latenza misurata va dall'inizio del frame (lettura dell'input) alla fine del rendering sulla GPU,
+// convertendo il timestamp GPU nell'orologio della CPU; la scansione sul display non e' compresa.
+class CadenzaFrame
+{
+public:
+    static const int MAX_IN_VOLO = BufferCircolare::FRAME_IN_VOLO;
+
+    struct Stats {
+        int inVolo = 0;                     // frame inviati e non ancora completati dalla GPU
+        double msCpu = 0.0;                 // lavoro CPU del frame (esclusa l'attesa sui fence), media
+        double msAttesa = 0.0;              // attesa sui fence per frame, media
+        double msIntervallo = 0.0;          // tra l'inizio di due frame, media
+        double msJitter = 0.0;              // deviazione standard dell'intervallo
+        double msLatenza = 0.0;             // inizio del frame -> fine del rendering GPU, media
+        unsigned long long frame = 0;
+        unsigned long long attese = 0;      // frame iniziati aspettando la GPU
+    };
+
+    int frameInVolo = 2;
+
+    // Attende la GPU se ci sono gia' frameInVolo frame in volo, poi apre il frame
+    void iniziaFrame()
+    {
+        if (query[0] == 0)
+            glGenQueries(MAX_IN_VOLO + 1, query);
+        int limite = std::max(1, std::min(frameInVolo, MAX_IN_VOLO));
+        auto t0 = orologio::now();
+        bool atteso = false;
+        raccogli();
+        while ((int)inVolo.size() >= limite)
+        {
+            atteso = true;
+            completa(inVolo.front(), true);
+            inVolo.pop_front();
+        }
+        auto t1 = orologio::now();
+        stats.inVolo = (int)inVolo.size();
+        if (atteso)
+            stats.attese++;
+        media(stats.msAttesa, ms(t1 - t0));
+        if (stats.frame > 0)
+        {
+            double intervallo = ms(t1 - inizio);
+            double scarto = intervallo - stats.msIntervallo;
+            media(stats.msIntervallo, intervallo);
+            varianza += ALFA * (scarto * scarto - varianza);
+            stats.msJitter = std::sqrt(varianza);
+        }
+        if (stats.frame % 300 == 0)
+            calibra();
+        inizio = t1;
+        stats.frame++;
+    }
+
+    // Chiude i comandi del frame (da chiamare prima di glfwSwapBuffers)
+    void fineFrame()
+    {
+        auto t = orologio::now();
+        media(stats.msCpu, ms(t - inizio));
+        Frame f;
+        f.inizio = inizio;
+        f.query = query[stats.frame % (MAX_IN_VOLO + 1)];
+        glQueryCounter(f.query, GL_TIMESTAMP);
+        f.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        inVolo.push_back(f);
+        stats.inVolo = (int)inVolo.size();
+    }
+
+    Stats getStats() const { return stats; }
+
+private:
+    typedef std::chrono::steady_clock orologio;
+    static constexpr double ALFA = 0.05;    // peso dell'ultimo frame nelle medie
+
+    struct Frame {
+        orologio::time_point inizio;
+        GLsync fence = 0;
+        unsigned int query = 0;
+    };
+
+    std::deque<Frame> inVolo;
+    unsigned int query[MAX_IN_VOLO + 1] = {};
+    orologio::time_point inizio;
+    long long scartoGpuNs = 0;              // orologio CPU - orologio GPU
+    double varianza = 0.0;
+    Stats stats;
+
+    static double ms(orologio::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+    static void media(double& valore, double campione)
+    {
+        valore = valore == 0.0 ? campione : valore + ALFA * (campione - valore);
+    }
+
+    void calibra()
+    {
+        GLint64 gpu = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu);
+        long long cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(orologio::now().time_since_epoch()).count();
+        scartoGpuNs = cpu - (long long)gpu;
+    }
+
+    // Toglie dalla testa i frame gia' completati, senza attese
+    void raccogli()
+    {
+        while (!inVolo.empty() && glClientWaitSync(inVolo.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+        {
+            completa(inVolo.front(), false);
+            inVolo.pop_front();
+        }
+    }
+
+    // Attende (se richiesto) il fence del frame e ne registra la latenza
+    void completa(Frame& f, bool aspetta)
+    {
+        if (aspetta)
+            while (glClientWaitSync(f.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+        glDeleteSync(f.fence);
+        GLuint64 fineGpu = 0;
+        glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &fineGpu);
+        long long fineCpu = (long long)fineGpu + scartoGpuNs;
+        long long inizioCpu = std::chrono::duration_cast<std::chrono::nanoseconds>(f.inizio.time_since_epoch()).count();
+        if (fineCpu > inizioCpu)
+            media(stats.msLatenza, (fineCpu - inizioCpu) / 1.0e6);
+    }
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <iostream>
+
+// G-buffer compatto del percorso deferred, 12 byte per pixel:
+// - colore 0: albedo + gloss, RGBA8
+// - colore 1: normale in spazio mondo con codifica ottaedrica, RG16 (due componenti senza segno in [0, 1])
+// - profondita' 24 bit come texture: il lighting pass ricostruisce la posizione con l'inversa di projection * view
+// Il geometry pass e' progetto.fs compilato con GBUFFER; il lighting pass (deferred.fs) disegna un triangolo
+// a schermo intero senza vertex buffer, per questo serve un VAO vuoto.
+struct GBuffer
+{
+    unsigned int FBO = 0;
+    unsigned int albedoGloss = 0;
+    unsigned int normale = 0;
+    unsigned int profondita = 0;
+    unsigned int vaoVuoto = 0;
+    int width = 0;
+    int height = 0;
+
+    // crea (o ricrea) il G-buffer alla dimensione richiesta; ritorna false se l'FBO non e' completo
+    bool create(int w, int h)
+    {
+        destroy();
+        width = w;
+        height = h;
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        albedoGloss = texture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoGloss, 0);
+        normale = texture(GL_RG16, GL_RG, GL_UNSIGNED_SHORT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normale, 0);
+        profondita = texture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, profondita, 0);
+        const GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!complete)
+            std::cout << "ERROR::GBUFFER:: framebuffer " << width << "x" << height << " non completo" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (vaoVuoto == 0)
+            glGenVertexArrays(1, &vaoVuoto);
+        return complete;
+    }
+
+    // ricrea il G-buffer solo se la dimensione e' cambiata
+    bool assicura(int w, int h)
+    {
+        if (FBO && w == width && h == height)
+            return true;
+        return create(w, h);
+    }
+
+    // lega albedo + gloss, normale e profondita' alle unita' primaUnita, primaUnita + 1, primaUnita + 2
+    void bindTexture(int primaUnita) const
+    {
+        const unsigned int texture[3] = { albedoGloss, normale, profondita };
+        for (int i = 0; i < 3; ++i)
+        {
+            glActiveTexture(GL_TEXTURE0 + primaUnita + i);
+            glBindTexture(GL_TEXTURE_2D, texture[i]);
+        }
+    }
+
+    void disegnaSchermoIntero() const
+    {
+        glBindVertexArray(vaoVuoto);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+
+    size_t bytes() const { return (size_t)width * height * (4 + 4 + 4); }
+
+    void destroy()
+    {
+        if (albedoGloss) glDeleteTextures(1, &albedoGloss);
+        if (normale) glDeleteTextures(1, &normale);
+        if (profondita) glDeleteTextures(1, &profondita);
+        if (FBO) glDeleteFramebuffers(1, &FBO);
+        FBO = albedoGloss = normale = profondita = 0;
+    }
+
+private:
+    unsigned int texture(GLenum internalFormat, GLenum format, GLenum type) const
+    {
+        unsigned int tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return tex;
+    }
+};
+
+#endif
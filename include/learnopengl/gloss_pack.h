@@ -0,0 +1,81 @@
+#ifndef GLOSS_PACK_H
+#define GLOSS_PACK_H
+
+#include <stb_image.h>
+
+#include <learnopengl/dds.h>
+#include <learnopengl/vfs.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Impacchettamento della gloss map nel canale alpha della diffuse, fatto al caricamento:
+// il materiale passa da tre texture a due e progetto.fs (compilato con GLOSS_IN_DIFFUSE_ALPHA)
+// legge colore e gloss con un solo fetch. L'alpha della diffuse non e' usato per lo shading.
+// - DDS cotti: BC1 (o BC3) + BC4 -> BC3 copiando i blocchi, senza ricompressione: il blocco alpha di BC3
+//   ha lo stesso formato di un blocco BC4, e texcook scrive i blocchi colore sempre in modalita' 4 colori
+// - immagini sorgente: la gloss (ricampionata se di dimensioni diverse) sostituisce l'alpha dei pixel RGBA
+namespace glosspack
+{
+    // I due DDS cotti possono essere combinati (basta l'header: vale anche per immagini lette con readLevels)
+    inline bool compatibili(const dds::Image& diffuse, const dds::Image& gloss)
+    {
+        return (diffuse.format == dds::BC1 || diffuse.format == dds::BC3) && gloss.format == dds::BC4
+            && diffuse.width == gloss.width && diffuse.height == gloss.height
+            && diffuse.levels.size() == gloss.levels.size();
+    }
+
+    // diffuse diventa BC3 con la gloss nell'alpha; i livelli vuoti (non letti) restano vuoti
+    inline bool packBlocks(dds::Image& diffuse, const dds::Image& gloss)
+    {
+        if (!compatibili(diffuse, gloss))
+            return false;
+        int passo = dds::blockBytes(diffuse.format);
+        int colore = diffuse.format == dds::BC3 ? 8 : 0;   // offset del blocco colore nel blocco sorgente
+        for (size_t l = 0; l < diffuse.levels.size(); ++l)
+            if (!diffuse.levels[l].empty() && gloss.levels[l].size() != diffuse.levels[l].size() / passo * 8)
+                return false;
+
+        for (size_t l = 0; l < diffuse.levels.size(); ++l)
+        {
+            const std::vector<unsigned char>& d = diffuse.levels[l];
+            if (d.empty())
+                continue;
+            size_t blocchi = d.size() / passo;
+            std::vector<unsigned char> out(blocchi * 16);
+            for (size_t b = 0; b < blocchi; ++b)
+            {
+                memcpy(&out[b * 16], &gloss.levels[l][b * 8], 8);
+                memcpy(&out[b * 16 + 8], &d[b * passo + colore], 8);
+            }
+            diffuse.levels[l].swap(out);
+        }
+        diffuse.format = dds::BC3;
+        return true;
+    }
+
+    // Scrive la gloss nell'alpha di un'immagine RGBA w x h; se la gloss non si carica l'alpha resta invariato
+    inline bool packPixels(unsigned char* rgba, int w, int h, const std::string& glossPath)
+    {
+        int gw, gh, n;
+        unsigned char* g = vfs::loadImage(glossPath, &gw, &gh, &n, 1);
+        if (!g)
+        {
+            std::cout << "Texture failed to load at path: " << glossPath << std::endl;
+            return false;
+        }
+        for (int y = 0; y < h; ++y)
+        {
+            const unsigned char* riga = g + (size_t)((long long)y * gh / h) * gw;
+            unsigned char* out = rgba + (size_t)y * w * 4 + 3;
+            for (int x = 0; x < w; ++x)
+                out[(size_t)x * 4] = riga[(long long)x * gw / w];
+        }
+        stbi_image_free(g);
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef IDLE_REDRAW_H
+#define IDLE_REDRAW_H
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Ridisegno a eventi per il ciclo interattivo: un frame si disegna solo se qualcosa lo ha invalidato
+// (input, resize, cambio di materiale, luci o ambiente) o se c'e' un lavoro in corso che cambia l'immagine
+// a ogni frame (camera in movimento, streaming delle texture, registrazione). Altrimenti il ciclo dorme in
+// glfwWaitEventsTimeout e la finestra continua a mostrare l'ultimo frame (niente swap); le shadow map
+// restano in cache come sempre. Il timeout sveglia il ciclo anche senza eventi, per accorgersi del lavoro
+// in background (decodifiche, streaming) che deve ripartire.
+// Ogni secondo si misura l'occupazione: tempo CPU del processo e tempo GPU dei frame disegnati rispetto
+// al tempo reale. Per i periodi inattivi (da un'attesa al frame successivo) si misura a parte la CPU:
+// la GPU in quei periodi non riceve comandi.
+class RidisegnoSuEventi
+{
+public:
+    struct Stats {
+        unsigned long long disegnati = 0;
+        unsigned long long attese = 0;         // risvegli senza niente da disegnare
+        double percentualeCpu = 0.0;           // ultimo secondo, rispetto a un core
+        double percentualeGpu = 0.0;           // ultimo secondo
+        double fps = 0.0;                      // frame disegnati nell'ultimo secondo
+        double secondiInattivo = 0.0;          // totale dei periodi inattivi
+        double percentualeCpuInattivo = 0.0;   // ultimo periodo inattivo concluso
+    };
+
+    bool attivo = true;
+    double timeout = 0.25;                     // secondi
+
+    // Il prossimo giro del ciclo deve disegnare un frame
+    void invalida() { invalidato = true; }
+
+    // true se il frame va disegnato; inCorso: lavoro che cambia l'immagine a ogni frame
+    bool serve(bool inCorso) const { return !attivo || invalidato || inCorso; }
+
+    // Niente da disegnare: dorme fino al prossimo evento o al timeout
+    void attendi()
+    {
+        if (!inattivo)
+        {
+            inattivo = true;
+            inizioInattivo = orologio::now();
+            cpuInizioInattivo = secondiCpu();
+        }
+        glfwWaitEventsTimeout(timeout);
+        stats.attese++;
+        misura();
+    }
+
+    // Dopo ogni frame disegnato; msGpu: tempo GPU stimato del frame
+    void frameDisegnato(double msGpu)
+    {
+        invalidato = false;
+        if (inattivo)
+        {
+            double reale = std::chrono::duration<double>(orologio::now() - inizioInattivo).count();
+            if (reale > 0.0)
+                stats.percentualeCpuInattivo = 100.0 * (secondiCpu() - cpuInizioInattivo) / reale;
+            stats.secondiInattivo += reale;
+            inattivo = false;
+        }
+        stats.disegnati++;
+        frameFinestra++;
+        msGpuFinestra += msGpu;
+        misura();
+    }
+
+    Stats getStats() const { return stats; }
+
+private:
+    typedef std::chrono::steady_clock orologio;
+
+    bool invalidato = true;
+    bool inattivo = false;
+    orologio::time_point inizioInattivo;
+    double cpuInizioInattivo = 0.0;
+    orologio::time_point inizioFinestra = orologio::now();
+    double cpuInizioFinestra = secondiCpu();
+    int frameFinestra = 0;
+    double msGpuFinestra = 0.0;
+    Stats stats;
+
+    void misura()
+    {
+        double reale = std::chrono::duration<double>(orologio::now() - inizioFinestra).count();
+        if (reale < 1.0)
+            return;
+        double cpu = secondiCpu();
+        stats.percentualeCpu = 100.0 * (cpu - cpuInizioFinestra) / reale;
+        stats.percentualeGpu = std::min(100.0, 0.1 * msGpuFinestra / reale);
+        stats.fps = frameFinestra / reale;
+        inizioFinestra = orologio::now();
+        cpuInizioFinestra = cpu;
+        frameFinestra = 0;
+        msGpuFinestra = 0.0;
+    }
+
+    // Tempo CPU del processo (utente + sistema, tutti i thread)
+    static double secondiCpu()
+    {
+#ifdef _WIN32
+        FILETIME creazione, uscita, kernel, utente;
+        if (!GetProcessTimes(GetCurrentProcess(), &creazione, &uscita, &kernel, &utente))
+            return 0.0;
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = utente.dwLowDateTime;
+        u.HighPart = utente.dwHighDateTime;
+        return (k.QuadPart + u.QuadPart) * 1.0e-7;
+#else
+        timespec t;
+        if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t) != 0)
+            return 0.0;
+        return t.tv_sec + t.tv_nsec * 1.0e-9;
+#endif
+    }
+};
+
+#endif
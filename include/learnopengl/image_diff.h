@@ -0,0 +1,131 @@
+#ifndef IMAGE_DIFF_H
+#define IMAGE_DIFF_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGE_DIFF_SSE2 1
+#endif
+
+// Confronto tra due immagini RGBA8 della stessa dimensione per i test di regressione (golden image).
+// Metriche: RMSE su tutti i canali, errore massimo e percentuale di pixel il cui errore massimo
+// tra i canali supera una soglia percettiva. Il ciclo principale usa SSE2 (16 byte = 4 pixel per iterazione).
+
+struct ImageDiffResult {
+    double rmse = 0.0;              // in unita' 0..255
+    int maxError = 0;               // massima differenza assoluta su un canale
+    size_t pixelOltreSoglia = 0;    // pixel con errore > soglia
+    double percentualeOltreSoglia = 0.0;
+};
+
+// a e b: pixelCount pixel RGBA; il canale alpha viene ignorato
+inline ImageDiffResult diffImagesRGBA(const unsigned char* a, const unsigned char* b, size_t pixelCount, int soglia)
+{
+    ImageDiffResult r;
+    unsigned long long sommaQuadrati = 0;
+    int maxErr = 0;
+    size_t oltre = 0;
+    size_t i = 0;
+
+#ifdef IMAGE_DIFF_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maskRGB = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i maskByte = _mm_set1_epi32(0xFF);
+    const __m128i vSoglia = _mm_set1_epi32(soglia);
+    __m128i vMax = zero;
+    __m128i vSomma = zero; // 4 accumulatori a 32 bit, svuotati periodicamente per evitare overflow
+    int blocchi = 0;
+
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i * 4));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i * 4));
+        // |a - b| per byte, alpha azzerato
+        __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        d = _mm_and_si128(d, maskRGB);
+        vMax = _mm_max_epu8(vMax, d);
+
+        // somma dei quadrati: byte -> 16 bit, poi madd (d*d + d*d) -> 32 bit
+        __m128i lo = _mm_unpacklo_epi8(d, zero);
+        __m128i hi = _mm_unpackhi_epi8(d, zero);
+        vSomma = _mm_add_epi32(vSomma, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+
+        // errore massimo per pixel: max tra i byte di ogni lane a 32 bit
+        __m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+        m = _mm_max_epu8(m, _mm_srli_epi32(m, 16));
+        m = _mm_and_si128(m, maskByte);
+        int bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(m, vSoglia)));
+        oltre += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+
+        // ogni lane accumula al massimo 2*2*255^2 per iterazione: svuota prima dell'overflow
+        if (++blocchi == 8192)
+        {
+            unsigned int parz[4];
+            _mm_storeu_si128((__m128i*)parz, vSomma);
+            sommaQuadrati += (unsigned long long)parz[0] + parz[1] + parz[2] + parz[3];
+            vSomma = zero;
+            blocchi = 0;
+        }
+    }
+    unsigned int parz[4];
+    _mm_storeu_si128((__m128i*)parz, vSomma);
+    sommaQuadrati += (unsigned long long)parz[0] + parz[1] + parz[2] + parz[3];
+    unsigned char maxBytes[16];
+    _mm_storeu_si128((__m128i*)maxBytes, vMax);
+    for (int k = 0; k < 16; ++k)
+        if (maxBytes[k] > maxErr) maxErr = maxBytes[k];
+#endif
+
+    // coda scalare (e percorso completo senza SSE2)
+    for (; i < pixelCount; ++i)
+    {
+        int pixelMax = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            int d = std::abs((int)a[i * 4 + c] - (int)b[i * 4 + c]);
+            sommaQuadrati += (unsigned long long)(d * d);
+            if (d > pixelMax) pixelMax = d;
+        }
+        if (pixelMax > maxErr) maxErr = pixelMax;
+        if (pixelMax > soglia) oltre++;
+    }
+
+    r.maxError = maxErr;
+    r.pixelOltreSoglia = oltre;
+    r.rmse = pixelCount ? std::sqrt((double)sommaQuadrati / (pixelCount * 3.0)) : 0.0;
+    r.percentualeOltreSoglia = pixelCount ? 100.0 * oltre / pixelCount : 0.0;
+    return r;
+}
+
+// Heatmap RGB della differenza: nero = identico, poi blu -> verde -> giallo -> rosso.
+// La scala e' normalizzata su fondoScala (es. 64: differenze >= 64 sono rosso pieno).
+inline std::vector<unsigned char> diffHeatmapRGB(const unsigned char* a, const unsigned char* b, size_t pixelCount, int fondoScala = 64)
+{
+    std::vector<unsigned char> out(pixelCount * 3);
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        int d = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            int v = std::abs((int)a[i * 4 + c] - (int)b[i * 4 + c]);
+            if (v > d) d = v;
+        }
+        float t = d >= fondoScala ? 1.0f : (float)d / fondoScala;
+        float rr = 0.0f, gg = 0.0f, bb = 0.0f;
+        if (d > 0)
+        {
+            if (t < 0.33f)      { bb = 1.0f; gg = t / 0.33f; }
+            else if (t < 0.66f) { gg = 1.0f; rr = (t - 0.33f) / 0.33f; bb = 1.0f - rr; }
+            else                { rr = 1.0f; gg = 1.0f - (t - 0.66f) / 0.34f; }
+        }
+        out[i * 3 + 0] = (unsigned char)(rr * 255.0f);
+        out[i * 3 + 1] = (unsigned char)(gg * 255.0f);
+        out[i * 3 + 2] = (unsigned char)(bb * 255.0f);
+    }
+    return out;
+}
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Scrittura di immagini su disco per screenshot e rendering batch.
+// PNG (deflate con codici di Huffman fissi + LZ77) e OpenEXR scanline non compresso a 32 bit float.
+// I pixel sono attesi in ordine top-down, 8 bit per canale, 3 (RGB) o 4 (RGBA) componenti.
+
+namespace imageio
+{
+    // --- CRC32 (PNG) e Adler32 (zlib) ---
+    inline unsigned int crc32(const unsigned char* data, size_t len, unsigned int crc = 0)
+    {
+        // statica locale: l'inizializzazione e' thread-safe (i PNG si scrivono da piu' worker di readback.h)
+        struct Tabella {
+            unsigned int v[256];
+            Tabella()
+            {
+                for (unsigned int n = 0; n < 256; n++)
+                {
+                    unsigned int c = n;
+                    for (int k = 0; k < 8; k++)
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    v[n] = c;
+                }
+            }
+        };
+        static const Tabella tabella;
+        const unsigned int* table = tabella.v;
+        crc = ~crc;
+        for (size_t i = 0; i < len; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    inline unsigned int adler32(const unsigned char* data, size_t len)
+    {
+        unsigned int a = 1, b = 0;
+        while (len > 0)
+        {
+            size_t blocco = len < 5552 ? len : 5552;
+            len -= blocco;
+            while (blocco--)
+            {
+                a += *data++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    // --- Deflate (RFC 1951) con blocco unico a codici fissi ---
+    class BitWriter
+    {
+    public:
+        std::vector<unsigned char>& out;
+        unsigned int buffer = 0;
+        int count = 0;
+
+        BitWriter(std::vector<unsigned char>& o) : out(o) {}
+
+        void write(unsigned int bits, int n)
+        {
+            buffer |= bits << count;
+            count += n;
+            while (count >= 8)
+            {
+                out.push_back((unsigned char)(buffer & 0xFF));
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+        // i codici di Huffman vanno scritti dal bit piu' significativo
+        void writeReversed(unsigned int code, int n)
+        {
+            unsigned int r = 0;
+            for (int i = 0; i < n; i++)
+                r |= ((code >> i) & 1) << (n - 1 - i);
+            write(r, n);
+        }
+        void flush()
+        {
+            if (count > 0)
+                out.push_back((unsigned char)(buffer & 0xFF));
+            buffer = 0;
+            count = 0;
+        }
+    };
+
+    inline void writeLiteral(BitWriter& bw, int v)
+    {
+        if (v <= 143)      bw.writeReversed(0x30 + v, 8);
+        else if (v <= 255) bw.writeReversed(0x190 + (v - 144), 9);
+        else if (v <= 279) bw.writeReversed(v - 256, 7);
+        else               bw.writeReversed(0xC0 + (v - 280), 8);
+    }
+
+    inline void writeMatch(BitWriter& bw, int length, int distance)
+    {
+        static const int lenBase[] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+        static const int lenExtra[] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+        static const int distBase[] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+        static const int distExtra[] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+        int l = 28;
+        while (lenBase[l] > length) l--;
+        writeLiteral(bw, 257 + l);
+        if (lenExtra[l]) bw.write(length - lenBase[l], lenExtra[l]);
+
+        int d = 29;
+        while (distBase[d] > distance) d--;
+        bw.writeReversed(d, 5);
+        if (distExtra[d]) bw.write(distance - distBase[d], distExtra[d]);
+    }
+
+    // stream zlib (header + deflate + adler32)
+    inline std::vector<unsigned char> zlibCompress(const unsigned char* data, size_t len)
+    {
+        const int WINDOW = 32768, HASH_BITS = 15, MAX_CHAIN = 32, MIN_MATCH = 3, MAX_MATCH = 258;
+        std::vector<unsigned char> out;
+        out.reserve(len / 2 + 64);
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        BitWriter bw(out);
+        bw.write(1, 1); // BFINAL
+        bw.write(1, 2); // BTYPE = 01 (codici fissi)
+
+        std::vector<int> head(1 << HASH_BITS, -1);
+        std::vector<int> prev(WINDOW, -1);
+        auto hash = [&](size_t i) {
+            return ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & ((1 << HASH_BITS) - 1);
+        };
+
+        size_t i = 0;
+        while (i < len)
+        {
+            int bestLen = 0, bestDist = 0;
+            if (i + MIN_MATCH <= len)
+            {
+                int h = hash(i);
+                int cand = head[h];
+                int chain = 0;
+                size_t maxLen = len - i < (size_t)MAX_MATCH ? len - i : (size_t)MAX_MATCH;
+                while (cand >= 0 && (int)(i - cand) <= WINDOW && chain++ < MAX_CHAIN)
+                {
+                    size_t l = 0;
+                    while (l < maxLen && data[cand + l] == data[i + l]) l++;
+                    if ((int)l > bestLen)
+                    {
+                        bestLen = (int)l;
+                        bestDist = (int)(i - cand);
+                        if (l == maxLen) break;
+                    }
+                    cand = prev[cand % WINDOW];
+                }
+                prev[i % WINDOW] = head[h];
+                head[h] = (int)i;
+            }
+
+            if (bestLen >= MIN_MATCH)
+            {
+                writeMatch(bw, bestLen, bestDist);
+                // inserisce nella hash anche le posizioni coperte dal match
+                for (size_t k = i + 1; k < i + bestLen && k + MIN_MATCH <= len; k++)
+                {
+                    int h = hash(k);
+                    prev[k % WINDOW] = head[h];
+                    head[h] = (int)k;
+                }
+                i += bestLen;
+            }
+            else
+            {
+                writeLiteral(bw, data[i]);
+                i++;
+            }
+        }
+        writeLiteral(bw, 256); // fine blocco
+        bw.flush();
+
+        unsigned int a = adler32(data, len);
+        out.push_back((a >> 24) & 0xFF);
+        out.push_back((a >> 16) & 0xFF);
+        out.push_back((a >> 8) & 0xFF);
+        out.push_back(a & 0xFF);
+        return out;
+    }
+
+    // --- PNG ---
+    inline void putBE32(std::vector<unsigned char>& v, unsigned int x)
+    {
+        v.push_back((x >> 24) & 0xFF);
+        v.push_back((x >> 16) & 0xFF);
+        v.push_back((x >> 8) & 0xFF);
+        v.push_back(x & 0xFF);
+    }
+
+    inline void writeChunk(FILE* f, const char* type, const std::vector<unsigned char>& data)
+    {
+        std::vector<unsigned char> buf;
+        putBE32(buf, (unsigned int)data.size());
+        buf.insert(buf.end(), type, type + 4);
+        buf.insert(buf.end(), data.begin(), data.end());
+        unsigned int crc = crc32(&buf[4], buf.size() - 4);
+        putBE32(buf, crc);
+        fwrite(buf.data(), 1, buf.size(), f);
+    }
+
+    inline int paeth(int a, int b, int c)
+    {
+        int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        if (pa <= pb && pa <= pc) return a;
+        return pb <= pc ? b : c;
+    }
+
+    // scrive un PNG; per ogni riga sceglie il filtro con la minima somma dei residui (euristica di libpng)
+    inline bool writePNG(const std::string& path, int width, int height, int comp, const unsigned char* pixels)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            std::cout << "ERROR::IMAGE_IO:: impossibile scrivere " << path << std::endl;
+            return false;
+        }
+
+        size_t stride = (size_t)width * comp;
+        std::vector<unsigned char> filtered((stride + 1) * height);
+        std::vector<unsigned char> tmp(stride);
+        for (int y = 0; y < height; y++)
+        {
+            const unsigned char* row = pixels + y * stride;
+            const unsigned char* up = y > 0 ? row - stride : NULL;
+            unsigned char* dst = &filtered[y * (stride + 1)];
+            long bestSum = -1;
+            for (int type = 0; type < 5; type++)
+            {
+                long sum = 0;
+                for (size_t x = 0; x < stride; x++)
+                {
+                    int a = x >= (size_t)comp ? row[x - comp] : 0;
+                    int b = up ? up[x] : 0;
+                    int c = (up && x >= (size_t)comp) ? up[x - comp] : 0;
+                    int pred = 0;
+                    switch (type)
+                    {
+                    case 1: pred = a; break;
+                    case 2: pred = b; break;
+                    case 3: pred = (a + b) / 2; break;
+                    case 4: pred = paeth(a, b, c); break;
+                    }
+                    tmp[x] = (unsigned char)(row[x] - pred);
+                    sum += tmp[x] < 128 ? tmp[x] : 256 - tmp[x];
+                }
+                if (bestSum < 0 || sum < bestSum)
+                {
+                    bestSum = sum;
+                    dst[0] = (unsigned char)type;
+                    memcpy(dst + 1, tmp.data(), stride);
+                }
+            }
+        }
+
+        static const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+        fwrite(signature, 1, 8, f);
+
+        std::vector<unsigned char> ihdr;
+        putBE32(ihdr, width);
+        putBE32(ihdr, height);
+        ihdr.push_back(8);                      // bit depth
+        ihdr.push_back(comp == 4 ? 6 : 2);      // RGBA / RGB
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        ihdr.push_back(0);
+        writeChunk(f, "IHDR", ihdr);
+        writeChunk(f, "IDAT", zlibCompress(filtered.data(), filtered.size()));
+        writeChunk(f, "IEND", std::vector<unsigned char>());
+        fclose(f);
+        return true;
+    }
+
+    // --- OpenEXR (scanline, nessuna compressione, canali float) ---
+    inline void putAttr(std::vector<unsigned char>& h, const char* name, const char* type, const void* data, int size)
+    {
+        h.insert(h.end(), name, name + strlen(name) + 1);
+        h.insert(h.end(), type, type + strlen(type) + 1);
+        h.insert(h.end(), (const unsigned char*)&size, (const unsigned char*)&size + 4);
+        h.insert(h.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+    }
+
+    inline float srgbToLinear(unsigned char c)
+    {
+        float v = c / 255.0f;
+        return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+    }
+
+    // scrive un EXR lineare (i valori a 8 bit vengono decodificati da sRGB); formato little endian come da specifica
+    inline bool writeEXR(const std::string& path, int width, int height, int comp, const unsigned char* pixels)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            std::cout << "ERROR::IMAGE_IO:: impossibile scrivere " << path << std::endl;
+            return false;
+        }
+
+        // i canali devono essere in ordine alfabetico
+        const char* canali = comp == 4 ? "ABGR" : "BGR";
+        int nCanali = (int)strlen(canali);
+
+        std::vector<unsigned char> h;
+        const unsigned char magic[] = { 0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0 };
+        h.insert(h.end(), magic, magic + 8);
+
+        std::vector<unsigned char> chlist;
+        for (int c = 0; c < nCanali; c++)
+        {
+            chlist.push_back(canali[c]);
+            chlist.push_back(0);
+            int info[4] = { 2 /* FLOAT */, 0 /* pLinear + riservati */, 1, 1 };
+            chlist.insert(chlist.end(), (unsigned char*)info, (unsigned char*)info + sizeof(info));
+        }
+        chlist.push_back(0);
+        putAttr(h, "channels", "chlist", chlist.data(), (int)chlist.size());
+        unsigned char compression = 0, lineOrder = 0;
+        putAttr(h, "compression", "compression", &compression, 1);
+        int window[4] = { 0, 0, width - 1, height - 1 };
+        putAttr(h, "dataWindow", "box2i", window, 16);
+        putAttr(h, "displayWindow", "box2i", window, 16);
+        putAttr(h, "lineOrder", "lineOrder", &lineOrder, 1);
+        float aspect = 1.0f, center[2] = { 0.0f, 0.0f }, swWidth = 1.0f;
+        putAttr(h, "pixelAspectRatio", "float", &aspect, 4);
+        putAttr(h, "screenWindowCenter", "v2f", center, 8);
+        putAttr(h, "screenWindowWidth", "float", &swWidth, 4);
+        h.push_back(0);
+
+        // tabella degli offset: una scanline per blocco
+        int lineBytes = 8 + width * nCanali * 4;
+        unsigned long long offset = h.size() + (unsigned long long)height * 8;
+        for (int y = 0; y < height; y++)
+        {
+            h.insert(h.end(), (unsigned char*)&offset, (unsigned char*)&offset + 8);
+            offset += lineBytes;
+        }
+        fwrite(h.data(), 1, h.size(), f);
+
+        // lookup sRGB -> lineare
+        float lut[256];
+        for (int i = 0; i < 256; i++)
+            lut[i] = srgbToLinear((unsigned char)i);
+
+        std::vector<float> line(width * nCanali);
+        for (int y = 0; y < height; y++)
+        {
+            const unsigned char* row = pixels + (size_t)y * width * comp;
+            for (int c = 0; c < nCanali; c++)
+            {
+                int src = canali[c] == 'R' ? 0 : canali[c] == 'G' ? 1 : canali[c] == 'B' ? 2 : 3;
+                for (int x = 0; x < width; x++)
+                    line[c * width + x] = src == 3 ? row[x * comp + 3] / 255.0f : lut[row[x * comp + src]];
+            }
+            int dataSize = width * nCanali * 4;
+            fwrite(&y, 4, 1, f);
+            fwrite(&dataSize, 4, 1, f);
+            fwrite(line.data(), 4, line.size(), f);
+        }
+        fclose(f);
+        return true;
+    }
+
+    // sceglie il formato dall'estensione (.exr, altrimenti PNG)
+    inline bool writeImage(const std::string& path, int width, int height, int comp, const unsigned char* pixels)
+    {
+        size_t dot = path.find_last_of('.');
+        std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+        if (ext == "exr" || ext == "EXR")
+            return writeEXR(path, width, height, comp, pixels);
+        return writePNG(path, width, height, comp, pixels);
+    }
+}
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef MATERIAL_CACHE_H
+#define MATERIAL_CACHE_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/dds.h>
+#include <learnopengl/gloss_pack.h>
+#include <learnopengl/mipmap.h>
+#include <learnopengl/vfs.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+// Set di texture di un materiale del personaggio (diffuse, gloss, normal)
+struct MaterialSet {
+    std::string diffuse;
+    std::string gloss;
+    std::string normal;
+};
+
+// Texture decodificata in memoria ma non ancora caricata sulla GPU.
+// La decodifica puo' avvenire su qualsiasi thread, l'upload solo sul thread GL.
+struct DecodedTexture {
+    bool ok = false;
+    bool compressa = false;           // true: DDS cotto (BCn + mipmap), altrimenti pixel da stb_image
+    dds::Image dds;
+    std::vector<std::vector<unsigned char>> livelli;   // catena di mipmap costruita su CPU (0 = risoluzione piena)
+    int width = 0;
+    int height = 0;
+    int components = 0;               // canali dei livelli: 1 (grigio), 3 (RGB) o 4
+    bool alpha = false;               // l'alpha e' trasparenza (non gloss impacchettata): GL_CLAMP_TO_EDGE
+};
+
+// Preferisce il DDS cotto accanto alla sorgente (vedi tools/texcook), altrimenti decodifica l'immagine.
+// Con glossPath la gloss map viene impacchettata nell'alpha (vedi gloss_pack.h): dai DDS cotti se
+// entrambi esistono e sono compatibili, altrimenti dalle immagini sorgente.
+inline DecodedTexture decodeTexture(const std::string& path, const std::string& glossPath = "")
+{
+    DecodedTexture t;
+    bool gloss = !glossPath.empty();
+    dds::Image cottaGloss;
+    if (dds::read(dds::cookedPath(path), t.dds)
+        && (!gloss || (dds::read(dds::cookedPath(glossPath), cottaGloss) && glosspack::packBlocks(t.dds, cottaGloss))))
+    {
+        t.ok = t.compressa = true;
+        t.width = t.dds.width;
+        t.height = t.dds.height;
+        t.alpha = !gloss && t.dds.format == dds::BC3;
+        return t;
+    }
+    // canali della sorgente (come nel TextureStreamer); si passa a 4 solo per impacchettare la gloss nell'alpha
+    int n = 0;
+    vfs::imageInfo(path, &t.width, &t.height, &n);
+    t.components = gloss ? 4 : (n == 1 || n == 3 ? n : 4);
+    unsigned char* data = vfs::loadImage(path, &t.width, &t.height, &n, t.components);
+    if (!data)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return t;
+    }
+    t.alpha = n == 4 && !gloss;
+    if (gloss)
+        glosspack::packPixels(data, t.width, t.height, glossPath);
+    std::vector<unsigned char> livello0(data, data + (size_t)t.width * t.height * t.components);
+    stbi_image_free(data);
+    t.livelli = mipmap::buildChain(std::move(livello0), t.width, t.height, t.components, mipmap::tipoDaNome(path));
+    t.ok = true;
+    return t;
+}
+
+// Crea la texture GL (stessi parametri di loadTexture: le texture con alpha usano GL_CLAMP_TO_EDGE).
+// bytes riceve la memoria video stimata, mipmap comprese.
+inline unsigned int uploadTexture(const DecodedTexture& t, size_t& bytes)
+{
+    bytes = 0;
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    if (!t.ok)
+        return textureID;
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    if (t.compressa)
+    {
+        int w = t.width, h = t.height;
+        for (size_t level = 0; level < t.dds.levels.size(); ++level)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, dds::glFormat(t.dds.format), w, h, 0,
+                (GLsizei)t.dds.levels[level].size(), t.dds.levels[level].data());
+            bytes += t.dds.levels[level].size();
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)t.dds.levels.size() - 1);
+    }
+    else
+    {
+        GLenum format = t.components == 1 ? GL_RED : (t.components == 3 ? GL_RGB : GL_RGBA);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        int w = t.width, h = t.height;
+        for (size_t level = 0; level < t.livelli.size(); ++level)
+        {
+            glTexImage2D(GL_TEXTURE_2D, (GLint)level, format, w, h, 0, format, GL_UNSIGNED_BYTE, t.livelli[level].data());
+            bytes += t.livelli[level].size();
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)t.livelli.size() - 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, t.alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t.alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+// Residenza dei materiali del personaggio: un set viene caricato al primo utilizzo,
+// il successivo nell'ordine del tasto M viene decodificato in anticipo da un thread in background,
+// e quando la memoria video stimata supera il budget si scaricano i set usati meno di recente (LRU).
+// Con packGloss la gloss di ogni set finisce nell'alpha della diffuse e Textures::gloss resta 0.
+// Tutti i metodi vanno chiamati dal thread GL.
+class MaterialCache
+{
+public:
+    struct Textures {
+        unsigned int diffuse = 0;
+        unsigned int gloss = 0;
+        unsigned int normal = 0;
+    };
+    struct Stats {
+        int residenti = 0;
+        size_t bytesResidenti = 0;
+        size_t budget = 0;
+        unsigned long long hit = 0;        // cambi di materiale gia' residente (anche grazie al prefetch)
+        unsigned long long miss = 0;       // cambi che hanno richiesto un caricamento sincrono
+        unsigned long long prefetch = 0;   // set decodificati in background
+        unsigned long long evizioni = 0;
+    };
+
+    MaterialCache(const MaterialSet* sets, int count, size_t budgetBytes, bool packGloss = false)
+        : sorgenti(sets, sets + count), entries(count), packGloss(packGloss)
+    {
+        stats.budget = budgetBytes;
+        worker = std::thread(&MaterialCache::workerLoop, this);
+    }
+
+    ~MaterialCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+        for (int i = 0; i < (int)entries.size(); ++i)
+            if (entries[i].residente)
+                unload(i);
+    }
+
+    // Texture del set index, caricandolo subito se non e' residente
+    const Textures& acquire(int index)
+    {
+        Entry& e = entries[index];
+        e.ultimoUso = ++tick;
+        if (index != ultimoRichiesto)
+        {
+            ultimoRichiesto = index;
+            if (e.residente) stats.hit++;
+        }
+        if (e.residente)
+            return e.tex;
+
+        // miss: usa la decodifica in background se e' gia' partita, altrimenti decodifica qui
+        std::vector<DecodedTexture> decodificate;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (e.stato == InCoda)
+            {
+                for (std::deque<int>::iterator it = richieste.begin(); it != richieste.end(); ++it)
+                    if (*it == index) { richieste.erase(it); break; }
+                e.stato = Nessuno;
+            }
+            cvDone.wait(lock, [&e] { return e.stato != InDecodifica; });
+            if (e.stato == Decodificato)
+                decodificate = std::move(e.decodificate);
+            e.stato = Nessuno;
+        }
+        if (decodificate.empty())
+            decodificate = decodeSet(index);
+        stats.miss++;
+        upload(index, decodificate);
+        enforceBudget(index);
+        return e.tex;
+    }
+
+    // Accoda la decodifica in background del set index (no-op se gia' residente o in corso)
+    void prefetch(int index)
+    {
+        if (index < 0 || index >= (int)entries.size() || entries[index].residente)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (entries[index].stato != Nessuno)
+                return;
+            entries[index].stato = InCoda;
+            richieste.push_back(index);
+        }
+        cv.notify_one();
+    }
+
+    // Carica sulla GPU i set decodificati in background (una volta per frame)
+    void update()
+    {
+        for (int i = 0; i < (int)entries.size(); ++i)
+        {
+            std::vector<DecodedTexture> decodificate;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (entries[i].stato != Decodificato)
+                    continue;
+                decodificate = std::move(entries[i].decodificate);
+                entries[i].stato = Nessuno;
+            }
+            if (entries[i].residente)
+                continue;
+            upload(i, decodificate);
+            entries[i].ultimoUso = ++tick;
+            stats.prefetch++;
+            enforceBudget(i);
+        }
+    }
+
+    Stats getStats() const { return stats; }
+
+private:
+    enum Stato { Nessuno, InCoda, InDecodifica, Decodificato };
+    struct Entry {
+        bool residente = false;
+        Textures tex;
+        size_t bytes = 0;
+        unsigned long long ultimoUso = 0;
+        Stato stato = Nessuno;                     // stato della decodifica in background (protetto da mutex)
+        std::vector<DecodedTexture> decodificate;
+    };
+
+    std::vector<MaterialSet> sorgenti;
+    std::vector<Entry> entries;
+    bool packGloss;
+    unsigned long long tick = 0;
+    int ultimoRichiesto = -1;
+    Stats stats;
+
+    std::thread worker;
+    std::deque<int> richieste;
+    std::mutex mutex;
+    std::condition_variable cv;      // nuove richieste di prefetch
+    std::condition_variable cvDone;  // decodifica completata
+    bool stopping = false;
+
+    std::vector<DecodedTexture> decodeSet(int index)
+    {
+        // ordine: diffuse, normal, gloss (assente se impacchettata nella diffuse)
+        std::vector<DecodedTexture> t;
+        t.push_back(decodeTexture(sorgenti[index].diffuse, packGloss ? sorgenti[index].gloss : std::string()));
+        t.push_back(decodeTexture(sorgenti[index].normal));
+        if (!packGloss)
+            t.push_back(decodeTexture(sorgenti[index].gloss));
+        return t;
+    }
+
+    void upload(int index, const std::vector<DecodedTexture>& t)
+    {
+        Entry& e = entries[index];
+        size_t b0, b1, b2 = 0;
+        e.tex.diffuse = uploadTexture(t[0], b0);
+        e.tex.normal = uploadTexture(t[1], b1);
+        e.tex.gloss = t.size() > 2 ? uploadTexture(t[2], b2) : 0;
+        e.bytes = b0 + b1 + b2;
+        e.residente = true;
+        stats.residenti++;
+        stats.bytesResidenti += e.bytes;
+    }
+
+    void unload(int index)
+    {
+        Entry& e = entries[index];
+        unsigned int ids[3] = { e.tex.diffuse, e.tex.gloss, e.tex.normal };
+        glDeleteTextures(3, ids);
+        e.tex = Textures();
+        e.residente = false;
+        stats.residenti--;
+        stats.bytesResidenti -= e.bytes;
+        e.bytes = 0;
+    }
+
+    // Scarica i set meno recenti finche' si rientra nel budget; il set appena caricato
+    // e quello in uso non vengono mai scaricati
+    void enforceBudget(int protetto)
+    {
+        while (stats.bytesResidenti > stats.budget)
+        {
+            int vittima = -1;
+            for (int i = 0; i < (int)entries.size(); ++i)
+            {
+                if (!entries[i].residente || i == protetto || i == ultimoRichiesto)
+                    continue;
+                if (vittima < 0 || entries[i].ultimoUso < entries[vittima].ultimoUso)
+                    vittima = i;
+            }
+            if (vittima < 0)
+                break;
+            unload(vittima);
+            stats.evizioni++;
+        }
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !richieste.empty(); });
+                if (stopping)
+                    return;
+                index = richieste.front();
+                richieste.pop_front();
+                entries[index].stato = InDecodifica;
+            }
+            std::vector<DecodedTexture> t = decodeSet(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                entries[index].decodificate = std::move(t);
+                entries[index].stato = Decodificato;
+            }
+            cvDone.notify_all();
+        }
+    }
+};
+
+#endif
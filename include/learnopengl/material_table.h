@@ -0,0 +1,391 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/dds.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_streamer.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Funzioni e costanti di GL 4.3 assenti da glad (generato fino a 4.2): caricate a mano in TabellaMateriali::init
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#endif
+typedef void (APIENTRYP PFNCOPYIMAGESUBDATA)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+                                             GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+                                             GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth);
+
+// Tabella dei materiali per il multi-draw indirect (draw_indirect.h): le texture dei materiali vengono
+// copiate negli strati di GL_TEXTURE_2D_ARRAY raggruppati per dimensione, formato, numero di livelli e wrap,
+// e un SSBO (binding 1) descrive ogni materiale con array, strato e primo livello residente di diffuse,
+// normal e gloss. Lo shader sceglie il materiale dall'indice del disegno, quindi mesh con materiali diversi
+// finiscono nella stessa chiamata e le texture si legano una volta per pass, qualunque sia il numero di mesh.
+// - niente handle bindless: lo streamer (texture_streamer.h) ridefinisce i livelli e cambia BASE_LEVEL,
+//   mentre una texture resa residente come handle non puo' piu' essere modificata. Le texture sorgenti
+//   restano com'erano; aggiorna() copia nello strato (lato GPU, glCopyImageSubData) i livelli appena
+//   arrivati e lo shader non scende sotto il primo livello residente (textureLod con LOD limitato)
+// - gli array hanno storage immutabile con la catena completa: la memoria dei materiali in tabella
+//   raddoppia e non torna indietro quando lo streamer rilascia i livelli fini
+// - i materiali con texture che non entrano in un array (piu' di MAX_ARRAY formati, strati esauriti)
+//   restano fuori tabella e si disegnano legando le texture come prima
+class TabellaMateriali
+{
+public:
+    static const int MAX_ARRAY = 8;             // sampler2DArray dello shader (textureTabella[])
+    static const int PRIMA_UNITA = 8;           // unita' 0-2 materiale legato, 5-7 shadow map
+    static const unsigned int NESSUNO = 0xFFFFFFFFu;
+
+    // Texture di un materiale per ruolo; 0 = si usa la texture legata alle unita' 0-2
+    struct Terna {
+        unsigned int diffuse = 0, normal = 0, gloss = 0;
+    };
+
+    struct Stats {
+        int materiali = 0;               // materiali in tabella
+        int esclusi = 0;                 // materiali lasciati al percorso con le texture legate
+        int array = 0, strati = 0;
+        size_t bytes = 0;                // memoria video degli array
+        unsigned long long copie = 0;    // livelli copiati negli strati
+    };
+
+    // Texture usate dallo shader (diffuse1, normal1, specular1) di una mesh, come le lega Mesh::BindTextures
+    static Terna terna(const Mesh& m)
+    {
+        Terna t;
+        for (const Texture& tex : m.textures)
+        {
+            if (tex.type == "texture_diffuse" && !t.diffuse)
+                t.diffuse = tex.id;
+            else if (tex.type == "texture_normal" && !t.normal)
+                t.normal = tex.id;
+            else if (tex.type == "texture_specular" && !t.gloss)
+                t.gloss = tex.id;
+        }
+        return t;
+    }
+
+    // Richiede GL >= 4.3 (SSBO e glCopyImageSubData); da chiamare dopo DrawIndiretto::init
+    bool init(GLADloadproc carica)
+    {
+        if (GLVersion.major * 10 + GLVersion.minor < 43)
+            return false;
+        glCopyImageSubData_ = (PFNCOPYIMAGESUBDATA)carica("glCopyImageSubData");
+        if (!glCopyImageSubData_)
+        {
+            std::cout << "Tabella dei materiali non disponibile: glCopyImageSubData mancante" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Accoda un materiale; entra in tabella con costruisci()
+    void registra(const Terna& t)
+    {
+        if (t.diffuse || t.normal || t.gloss)
+            richiesti.push_back(t);
+    }
+
+    // Crea gli array e la tabella per i materiali registrati. Con streamer le texture da lui gestite
+    // vengono seguite livello per livello; le altre devono essere gia' complete.
+    void costruisci(TextureStreamer* streamer)
+    {
+        if (!glCopyImageSubData_)
+            return;
+        this->streamer = streamer;
+        GLint maxStrati = 256;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxStrati);
+
+        // formato di ogni texture e raggruppamento per array
+        std::map<Formato, std::vector<unsigned int>> gruppi;
+        std::map<unsigned int, Formato> formati;
+        for (const Terna& t : richiesti)
+            for (unsigned int id : { t.diffuse, t.normal, t.gloss })
+            {
+                Formato f;
+                if (id && !formati.count(id) && descrivi(id, f))
+                {
+                    formati[id] = f;
+                    gruppi[f].push_back(id);
+                }
+            }
+        // i gruppi piu' numerosi prendono gli array disponibili
+        std::vector<std::pair<Formato, std::vector<unsigned int>>> ordinati(gruppi.begin(), gruppi.end());
+        std::stable_sort(ordinati.begin(), ordinati.end(), [](const std::pair<Formato, std::vector<unsigned int>>& a,
+                                                              const std::pair<Formato, std::vector<unsigned int>>& b) {
+            return a.second.size() > b.second.size();
+        });
+        for (size_t g = 0; g < ordinati.size() && g < (size_t)MAX_ARRAY; ++g)
+        {
+            const Formato& f = ordinati[g].first;
+            std::vector<unsigned int>& ids = ordinati[g].second;
+            if (ids.size() > (size_t)maxStrati)
+                ids.resize(maxStrati);
+            ArrayTex a;
+            a.formato = f;
+            a.strati = (int)ids.size();
+            glGenTextures(1, &a.id);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, a.id);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, f.livelli, f.internalFormat, f.width, f.height, a.strati);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, f.wrap);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, f.wrap);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            for (int l = 0; l < f.livelli; ++l)
+                stats.bytes += bytesLivello(f, l) * a.strati;
+            for (int s = 0; s < a.strati; ++s)
+            {
+                Sorgente src;
+                src.id = ids[s];
+                src.array = (int)array.size();
+                src.strato = s;
+                src.copiatoDa = f.livelli;
+                perTexture[src.id] = (int)sorgenti.size();
+                sorgenti.push_back(src);
+            }
+            array.push_back(a);
+            stats.strati += a.strati;
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        // un materiale entra in tabella se tutte le sue texture hanno uno strato
+        for (const Terna& t : richiesti)
+        {
+            std::tuple<unsigned int, unsigned int, unsigned int> chiave(t.diffuse, t.normal, t.gloss);
+            if (perTerna.count(chiave))
+                continue;
+            bool ok = true;
+            for (unsigned int id : { t.diffuse, t.normal, t.gloss })
+                ok = ok && (id == 0 || perTexture.count(id));
+            if (!ok)
+            {
+                perTerna[chiave] = NESSUNO;
+                stats.esclusi++;
+                continue;
+            }
+            perTerna[chiave] = (unsigned int)terne.size();
+            terne.push_back(t);
+        }
+        richiesti.clear();
+        stats.materiali = (int)terne.size();
+        stats.array = (int)array.size();
+        if (terne.empty())
+            return;
+
+        glGenBuffers(1, &materialiBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialiBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, terne.size() * sizeof(MaterialeGpu), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        aggiorna();
+    }
+
+    bool attiva() const { return materialiBuffer != 0; }
+    Stats getStats() const { return stats; }
+
+    // Indice del materiale in tabella, NESSUNO se il materiale ne e' rimasto fuori
+    unsigned int trova(const Terna& t) const
+    {
+        std::map<std::tuple<unsigned int, unsigned int, unsigned int>, unsigned int>::const_iterator it =
+            perTerna.find(std::make_tuple(t.diffuse, t.normal, t.gloss));
+        return it == perTerna.end() ? NESSUNO : it->second;
+    }
+
+    // Copia negli strati i livelli arrivati dall'ultimo frame e riscrive la tabella se qualche
+    // primo livello residente e' cambiato (una volta per frame, dopo TextureStreamer::update)
+    void aggiorna()
+    {
+        bool cambiata = false;
+        for (Sorgente& s : sorgenti)
+        {
+            const Formato& f = array[s.array].formato;
+            int base = 0;
+            unsigned long long versione = 0;
+            TextureStreamer::Stato st;
+            if (streamer && streamer->stato(s.id, st))
+            {
+                base = st.base;
+                versione = st.versione;
+            }
+            if (s.copiate && versione == s.versione)
+                continue;
+            // i livelli fini gia' copiati restano validi anche se lo streamer li rilascia e li ricarica;
+            // la coda si ricopia sempre perche' lo streamer la sostituisce quando finisce la decodifica
+            for (int l = base; l < f.livelli; ++l)
+                if (l < s.copiatoDa || l == f.livelli - 1)
+                {
+                    glCopyImageSubData_(s.id, GL_TEXTURE_2D, l, 0, 0, 0,
+                                        array[s.array].id, GL_TEXTURE_2D_ARRAY, l, 0, 0, s.strato,
+                                        std::max(1, f.width >> l), std::max(1, f.height >> l), 1);
+                    stats.copie++;
+                }
+            cambiata = cambiata || !s.copiate || s.base != base;
+            s.copiatoDa = std::min(s.copiatoDa, base);
+            s.copiate = true;
+            s.versione = versione;
+            s.base = base;
+        }
+        if (cambiata)
+            scriviTabella();
+    }
+
+    // Lega gli array alle unita' PRIMA_UNITA... e la tabella al binding 1
+    void bind(Shader& shader) const
+    {
+        for (int i = 0; i < MAX_ARRAY; ++i)
+        {
+            glActiveTexture(GL_TEXTURE0 + PRIMA_UNITA + i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, i < (int)array.size() ? array[i].id : 0);
+            shader.setInt("textureTabella[" + std::to_string(i) + "]", PRIMA_UNITA + i);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, materialiBuffer);
+    }
+
+private:
+    struct Formato {
+        int width = 0, height = 0, livelli = 1;
+        GLenum internalFormat = GL_RGBA8;
+        GLint wrap = GL_REPEAT;
+
+        bool operator<(const Formato& o) const
+        {
+            return std::tie(width, height, livelli, internalFormat, wrap) < std::tie(o.width, o.height, o.livelli, o.internalFormat, o.wrap);
+        }
+    };
+    struct ArrayTex {
+        Formato formato;
+        unsigned int id = 0;
+        int strati = 0;
+    };
+    struct Sorgente {
+        unsigned int id = 0;
+        int array = 0, strato = 0;
+        int base = 0;                       // primo livello residente scritto nella tabella
+        int copiatoDa = 0;                  // livelli [copiatoDa, livelli) gia' copiati nello strato
+        bool copiate = false;
+        unsigned long long versione = 0;
+    };
+    // Layout std430 condiviso con progetto.fs (struct MaterialeTabella): per ruolo array, strato, primo livello
+    struct MaterialeGpu {
+        int ruoli[3][4];
+    };
+
+    PFNCOPYIMAGESUBDATA glCopyImageSubData_ = nullptr;
+    TextureStreamer* streamer = nullptr;
+    std::vector<Terna> richiesti, terne;
+    std::map<std::tuple<unsigned int, unsigned int, unsigned int>, unsigned int> perTerna;
+    std::vector<ArrayTex> array;
+    std::vector<Sorgente> sorgenti;
+    std::map<unsigned int, int> perTexture;   // texture sorgente -> indice in sorgenti
+    unsigned int materialiBuffer = 0;
+    Stats stats;
+
+    // Formato della texture: dallo streamer se la gestisce, altrimenti dai livelli definiti
+    bool descrivi(unsigned int id, Formato& f) const
+    {
+        TextureStreamer::Stato st;
+        glBindTexture(GL_TEXTURE_2D, id);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &f.wrap);
+        if (streamer && streamer->stato(id, st))
+        {
+            f.width = st.width;
+            f.height = st.height;
+            f.livelli = st.livelli;
+            f.internalFormat = st.internalFormat;
+        }
+        else
+        {
+            GLint w = 0, h = 0, formato = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &formato);
+            f.width = w;
+            f.height = h;
+            f.internalFormat = formatoDimensionato((GLenum)formato);
+            // la catena deve essere completa: ogni livello fino a 1x1 con la dimensione attesa
+            f.livelli = 1;
+            while ((w >> f.livelli) > 0 || (h >> f.livelli) > 0)
+                f.livelli++;
+            for (int l = 1; l < f.livelli && f.width > 0; ++l)
+            {
+                GLint lw = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_WIDTH, &lw);
+                if (lw != std::max(1, w >> l))
+                    f.width = 0;
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return f.width > 0 && f.height > 0 && f.internalFormat != GL_NONE;
+    }
+
+    // glTexStorage3D vuole un formato dimensionato; le texture caricate senza streamer usano GL_RED/GL_RGB/GL_RGBA
+    static GLenum formatoDimensionato(GLenum formato)
+    {
+        switch (formato)
+        {
+        case GL_RED:  return GL_R8;
+        case GL_RGB:  return GL_RGB8;
+        case GL_RGBA: return GL_RGBA8;
+        case GL_R8: case GL_RGB8: case GL_RGBA8:
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_RG_RGTC2:
+            return formato;
+        default:      return GL_NONE;   // formato non previsto: la texture resta fuori tabella
+        }
+    }
+
+    static size_t bytesLivello(const Formato& f, int l)
+    {
+        size_t w = std::max(1, f.width >> l), h = std::max(1, f.height >> l);
+        switch (f.internalFormat)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RED_RGTC1:
+            return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+            return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+        case GL_R8:
+            return w * h;
+        default:
+            return w * h * 4;
+        }
+    }
+
+    void scriviTabella()
+    {
+        std::vector<MaterialeGpu> dati(terne.size());
+        for (size_t m = 0; m < terne.size(); ++m)
+        {
+            unsigned int ids[3] = { terne[m].diffuse, terne[m].normal, terne[m].gloss };
+            for (int r = 0; r < 3; ++r)
+            {
+                int* ruolo = dati[m].ruoli[r];
+                ruolo[0] = -1;
+                ruolo[1] = ruolo[2] = ruolo[3] = 0;
+                if (!ids[r])
+                    continue;
+                const Sorgente& s = sorgenti[perTexture.at(ids[r])];
+                ruolo[0] = s.array;
+                ruolo[1] = s.strato;
+                ruolo[2] = s.base;
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialiBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, dati.size() * sizeof(MaterialeGpu), dati.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+};
+
+#endif
@@ -7,7 +7,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/mesh_arena.h>
+#include <learnopengl/mesh_lod.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 using namespace std;
@@ -43,21 +46,53 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
-
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    unsigned int VAO;   // the shared arena's VAO
+    // range of this mesh in the shared vertex/index arena (see mesh_arena.h)
+    unsigned int baseVertex, firstIndex;
+    // levels of detail: index range in the element buffer and error in model units (level 0 = indices)
+    vector<unsigned int> lodFirst, lodCount;
+    vector<float>        lodError;
+
+    // constructor; lods are simplified index buffers over the same vertices (see mesh_lod.h)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const vector<meshlod::Livello> &lods = vector<meshlod::Livello>())
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        lodFirst.push_back(0);
+        lodCount.push_back(static_cast<unsigned int>(indices.size()));
+        lodError.push_back(0.0f);
+        for (const meshlod::Livello &lod : lods)
+        {
+            lodFirst.push_back(lodFirst.back() + lodCount.back());
+            lodCount.push_back(static_cast<unsigned int>(lod.indici.size()));
+            lodError.push_back(lod.errore);
+        }
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(lods);
+    }
+
+    // number of triangles drawn at a given level of detail (clamped to the levels available)
+    unsigned int triangles(int lod = 0) const
+    {
+        return lodCount[std::min<size_t>(lod, lodCount.size() - 1)] / 3;
+    }
+
+    // render the mesh at the given level of detail
+    void Draw(Shader &shader, int lod = 0) 
+    {
+        BindTextures(shader);
+        glBindVertexArray(VAO);
+        DrawElements(lod);
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // binds the mesh textures to consecutive units and points the samplers at them
+    void BindTextures(Shader &shader) const
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -84,63 +119,29 @@ public:
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // issues the draw call only: the arena VAO (MeshArena<Vertex>::shared().bind()) must already be bound
+    void DrawElements(int lod = 0) const
+    {
+        size_t level = std::min<size_t>(lod, lodCount.size() - 1);
+        glDrawElementsBaseVertex(GL_TRIANGLES, lodCount[level], GL_UNSIGNED_INT,
+                                 (void*)((firstIndex + lodFirst[level]) * sizeof(unsigned int)), baseVertex);
     }
 
 private:
-    // render data 
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // copies vertices and all levels of detail into the shared arena
+    void setupMesh(const vector<meshlod::Livello> &lods)
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        // all levels of detail are stored one after the other, with indices relative to the first vertex
+        vector<unsigned int> allIndices(indices);
+        for (const meshlod::Livello &lod : lods)
+            allIndices.insert(allIndices.end(), lod.indici.begin(), lod.indici.end());
+        MeshArena<Vertex> &arena = MeshArena<Vertex>::shared();
+        MeshArena<Vertex>::Allocazione range = arena.aggiungi(vertices.data(), vertices.size(), allIndices.data(), allIndices.size());
+        baseVertex = range.baseVertex;
+        firstIndex = range.primoIndice;
+        VAO = arena.vao();
     }
 };
 #endif
@@ -0,0 +1,164 @@
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Arena condivisa di vertici e indici per tutte le mesh con il formato V (Vertex di mesh.h):
+// un solo VAO, un VBO e un EBO grandi, da cui ogni mesh riceve un intervallo. Le mesh si disegnano con
+// glDrawElementsBaseVertex (indici relativi alla mesh + baseVertex), quindi passare da una mesh all'altra,
+// anche di modelli diversi, non cambia VAO. I buffer crescono raddoppiando (copia lato GPU con
+// glCopyBufferSubData); l'arena non libera intervalli: i modelli restano caricati fino all'uscita.
+// Le scritture usano GL_COPY_WRITE_BUFFER, cosi' non toccano lo stato del VAO eventualmente legato.
+template <typename V>
+class MeshArena
+{
+public:
+    struct Allocazione {
+        unsigned int baseVertex = 0;
+        unsigned int primoIndice = 0;
+    };
+
+    struct Stats {
+        size_t mesh = 0;
+        size_t vertici = 0, indici = 0;
+        size_t capacitaVertici = 0, capacitaIndici = 0;
+        int ricrescite = 0;
+    };
+
+    // Arena della scena (richiede un contesto OpenGL corrente al primo uso)
+    static MeshArena& shared()
+    {
+        static MeshArena arena;
+        return arena;
+    }
+
+    // Copia vertici e indici (relativi al primo vertice) nell'arena
+    Allocazione aggiungi(const V* vertici, size_t nVertici, const unsigned int* indici, size_t nIndici)
+    {
+        if (VAO == 0)
+            crea();
+        riserva(nVertici, nIndici);
+        Allocazione a;
+        a.baseVertex = (unsigned int)stats.vertici;
+        a.primoIndice = (unsigned int)stats.indici;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, stats.vertici * sizeof(V), nVertici * sizeof(V), vertici);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, stats.indici * sizeof(unsigned int), nIndici * sizeof(unsigned int), indici);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        stats.vertici += nVertici;
+        stats.indici += nIndici;
+        stats.mesh++;
+        return a;
+    }
+
+    unsigned int vao() const { return VAO; }
+    void bind() const { glBindVertexArray(VAO); }
+    Stats getStats() const { return stats; }
+
+    // Collega VBO, EBO e attributi del formato V a un VAO (anche esterno, es. con attributi per istanza in piu').
+    // Da ripetere quando cambia getStats().ricrescite: i buffer vengono sostituiti quando crescono.
+    // Il VAO e il GL_ARRAY_BUFFER legati prima della chiamata vengono ripristinati: la crescita puo' avvenire
+    // dentro aggiungi() mentre il chiamante ha un altro VAO legato.
+    void configura(unsigned int vao) const
+    {
+        GLint vaoPrecedente = 0, vboPrecedente = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vaoPrecedente);
+        glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &vboPrecedente);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        // posizione, normale, coordinate texture, tangente, bitangente, id e pesi delle ossa
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, Bitangent));
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(V), (void*)offsetof(V, m_BoneIDs));
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(V), (void*)offsetof(V, m_Weights));
+        glBindVertexArray((GLuint)vaoPrecedente);
+        glBindBuffer(GL_ARRAY_BUFFER, (GLuint)vboPrecedente);
+    }
+
+private:
+    static const size_t VERTICI_INIZIALI = 1 << 16;
+    static const size_t INDICI_INIZIALI = 1 << 18;
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    Stats stats;
+
+    MeshArena() {}
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    void crea()
+    {
+        glGenVertexArrays(1, &VAO);
+        VBO = nuovoBuffer(VERTICI_INIZIALI * sizeof(V), 0, 0);
+        EBO = nuovoBuffer(INDICI_INIZIALI * sizeof(unsigned int), 0, 0);
+        stats.capacitaVertici = VERTICI_INIZIALI;
+        stats.capacitaIndici = INDICI_INIZIALI;
+        collega();
+    }
+
+    // Nuovo buffer di `bytes` con i primi `copia` byte presi da `vecchio` (che viene eliminato)
+    static unsigned int nuovoBuffer(size_t bytes, unsigned int vecchio, size_t copia)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+        if (vecchio)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, vecchio);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, copia);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &vecchio);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    void riserva(size_t nVertici, size_t nIndici)
+    {
+        bool cresciuto = false;
+        if (stats.vertici + nVertici > stats.capacitaVertici)
+        {
+            size_t capacita = std::max(stats.capacitaVertici * 2, stats.vertici + nVertici);
+            VBO = nuovoBuffer(capacita * sizeof(V), VBO, stats.vertici * sizeof(V));
+            stats.capacitaVertici = capacita;
+            cresciuto = true;
+        }
+        if (stats.indici + nIndici > stats.capacitaIndici)
+        {
+            size_t capacita = std::max(stats.capacitaIndici * 2, stats.indici + nIndici);
+            EBO = nuovoBuffer(capacita * sizeof(unsigned int), EBO, stats.indici * sizeof(unsigned int));
+            stats.capacitaIndici = capacita;
+            cresciuto = true;
+        }
+        if (cresciuto)
+        {
+            collega();
+            stats.ricrescite++;
+        }
+    }
+
+    // Il VAO memorizza i buffer legati: va riconfigurato quando VBO o EBO vengono sostituiti
+    void collega()
+    {
+        configura(VAO);
+    }
+};
+
+#endif
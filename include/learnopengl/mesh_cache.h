@@ -0,0 +1,228 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_lod.h>
+#include <learnopengl/vfs.h>
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Cache binaria delle mesh importate: accanto a ogni modello (stessa cartella, estensione .mesh) si salvano
+// vertici e indici gia' saldati e ordinati da mesh_opt.h, i livelli di dettaglio (mesh_lod.h) e i nomi
+// delle texture di ogni materiale.
+// Ai caricamenti successivi Model legge il .mesh (anche dal pacchetto o dalla lettura anticipata, via vfs)
+// invece di far ripartire Assimp e l'ottimizzazione. L'intestazione elenca i file sorgente letti da Assimp
+// (il modello e i suoi .mtl) con la loro data di modifica: il file e' valido finche' tutte coincidono con
+// quelle sul disco. VERSION cambia quando cambiano il formato, la struttura Vertex o l'ottimizzazione.
+namespace meshcache
+{
+    const unsigned int VERSION = 3;
+
+    // Texture di una mesh per tipo, come nomi relativi alla cartella del modello
+    struct Materiale {
+        std::vector<std::string> diffuse, specular, normal, height;
+    };
+
+    struct MeshCotta {
+        std::vector<Vertex> vertici;
+        std::vector<unsigned int> indici;
+        Materiale materiale;
+        std::vector<meshlod::Livello> lod;   // livelli semplificati, stessi vertici del livello 0
+    };
+
+    struct Header {
+        char magic[4];              // "TMSH"
+        unsigned int version;
+        unsigned int vertexSize;    // sizeof(Vertex) al momento della scrittura
+        unsigned int meshCount;
+        unsigned int sourceCount;   // seguono sourceCount x (lunghezza, percorso, mtime a 64 bit)
+    };
+
+    inline std::string cachePath(const std::string& modelPath)
+    {
+        size_t dot = modelPath.find_last_of('.');
+        size_t slash = modelPath.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return modelPath + ".mesh";
+        return modelPath.substr(0, dot) + ".mesh";
+    }
+
+    // Data di modifica di un file sul disco, -1 se non esiste
+    inline long long mtime(const std::string& path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 ? (long long)st.st_mtime : -1;
+    }
+
+    // La cache esiste, ha la versione corrente e ogni sorgente registrato ha ancora la stessa data di modifica;
+    // se il modello non e' sul disco (asset solo nel pacchetto) basta che la cache esista
+    inline bool aggiornata(const std::string& modelPath)
+    {
+        std::string cache = cachePath(modelPath);
+        if (mtime(modelPath) < 0)
+            return vfs::exists(cache);
+        FILE* f = fopen(cache.c_str(), "rb");
+        if (!f)
+            return false;
+        Header h;
+        bool ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, "TMSH", 4) == 0 && h.version == VERSION
+            && h.sourceCount > 0;
+        for (unsigned int i = 0; ok && i < h.sourceCount; i++)
+        {
+            unsigned int len;
+            long long t;
+            std::string nome;
+            ok = fread(&len, 4, 1, f) == 1 && len < 4096;
+            if (ok)
+            {
+                nome.resize(len);
+                ok = fread(&nome[0], 1, len, f) == len && fread(&t, 8, 1, f) == 1 && mtime(nome) == t;
+            }
+        }
+        fclose(f);
+        return ok;
+    }
+
+    // File che Model leggera' per un modello (utile per leggerlo in anticipo)
+    inline std::string fileToLoad(const std::string& modelPath)
+    {
+        return aggiornata(modelPath) ? cachePath(modelPath) : modelPath;
+    }
+
+    // sorgenti: file da cui la cache e' stata prodotta (VfsIOSystem::aperti()), controllati da aggiornata()
+    inline bool write(const std::string& path, const std::vector<MeshCotta>& meshes, const std::vector<std::string>& sorgenti)
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        Header h;
+        memcpy(h.magic, "TMSH", 4);
+        h.version = VERSION;
+        h.vertexSize = (unsigned int)sizeof(Vertex);
+        h.meshCount = (unsigned int)meshes.size();
+        h.sourceCount = (unsigned int)sorgenti.size();
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+        auto scriviU32 = [&](unsigned int v) { ok = ok && fwrite(&v, 4, 1, f) == 1; };
+        for (const std::string& s : sorgenti)
+        {
+            long long t = mtime(s);
+            scriviU32((unsigned int)s.size());
+            ok = ok && fwrite(s.data(), 1, s.size(), f) == s.size() && fwrite(&t, 8, 1, f) == 1;
+        }
+        auto scriviNomi = [&](const std::vector<std::string>& nomi) {
+            scriviU32((unsigned int)nomi.size());
+            for (const std::string& n : nomi)
+            {
+                scriviU32((unsigned int)n.size());
+                ok = ok && fwrite(n.data(), 1, n.size(), f) == n.size();
+            }
+        };
+        for (const MeshCotta& m : meshes)
+        {
+            scriviU32((unsigned int)m.vertici.size());
+            scriviU32((unsigned int)m.indici.size());
+            ok = ok && fwrite(m.vertici.data(), sizeof(Vertex), m.vertici.size(), f) == m.vertici.size();
+            ok = ok && fwrite(m.indici.data(), 4, m.indici.size(), f) == m.indici.size();
+            scriviNomi(m.materiale.diffuse);
+            scriviNomi(m.materiale.specular);
+            scriviNomi(m.materiale.normal);
+            scriviNomi(m.materiale.height);
+            scriviU32((unsigned int)m.lod.size());
+            for (const meshlod::Livello& l : m.lod)
+            {
+                ok = ok && fwrite(&l.errore, 4, 1, f) == 1;
+                scriviU32((unsigned int)l.indici.size());
+                ok = ok && fwrite(l.indici.data(), 4, l.indici.size(), f) == l.indici.size();
+            }
+        }
+        ok = fclose(f) == 0 && ok;
+        if (!ok)
+            remove(path.c_str());
+        return ok;
+    }
+
+    inline bool read(const std::string& path, std::vector<MeshCotta>& meshes)
+    {
+        vfs::File file;
+        if (!vfs::open(path, file))
+            return false;
+        const unsigned char* p = file.data;
+        const unsigned char* fine = file.data + file.size;
+        auto leggi = [&](void* dst, size_t n) {
+            if ((size_t)(fine - p) < n)
+                return false;
+            memcpy(dst, p, n);
+            p += n;
+            return true;
+        };
+        auto leggiNomi = [&](std::vector<std::string>& nomi) {
+            unsigned int count, len;
+            if (!leggi(&count, 4) || (size_t)(fine - p) / 4 < count)
+                return false;
+            nomi.resize(count);
+            for (std::string& s : nomi)
+            {
+                if (!leggi(&len, 4) || (size_t)(fine - p) < len)
+                    return false;
+                s.assign((const char*)p, len);
+                p += len;
+            }
+            return true;
+        };
+        Header h;
+        if (!leggi(&h, sizeof(h)) || memcmp(h.magic, "TMSH", 4) != 0 || h.version != VERSION || h.vertexSize != sizeof(Vertex))
+            return false;
+        for (unsigned int i = 0; i < h.sourceCount; i++)
+        {
+            unsigned int len;
+            if (!leggi(&len, 4) || (size_t)(fine - p) < (size_t)len + 8)
+                return false;
+            p += len + 8;
+        }
+        if ((size_t)(fine - p) / 24 < h.meshCount)   // ogni mesh occupa almeno 24 byte
+            return false;
+        meshes.assign(h.meshCount, MeshCotta());
+        for (MeshCotta& m : meshes)
+        {
+            unsigned int nv, ni;
+            if (!leggi(&nv, 4) || !leggi(&ni, 4)
+                || (size_t)(fine - p) / sizeof(Vertex) < nv)
+                return false;
+            m.vertici.resize(nv);
+            if (!leggi(m.vertici.data(), (size_t)nv * sizeof(Vertex)) || (size_t)(fine - p) / 4 < ni)
+                return false;
+            m.indici.resize(ni);
+            if (!leggi(m.indici.data(), (size_t)ni * 4))
+                return false;
+            for (unsigned int i : m.indici)
+                if (i >= nv)
+                    return false;
+            if (!leggiNomi(m.materiale.diffuse) || !leggiNomi(m.materiale.specular)
+                || !leggiNomi(m.materiale.normal) || !leggiNomi(m.materiale.height))
+                return false;
+            unsigned int nl;
+            if (!leggi(&nl, 4) || nl >= meshlod::MAX_LIVELLI)
+                return false;
+            m.lod.resize(nl);
+            for (meshlod::Livello& l : m.lod)
+            {
+                if (!leggi(&l.errore, 4) || !leggi(&ni, 4) || (size_t)(fine - p) / 4 < ni)
+                    return false;
+                l.indici.resize(ni);
+                if (!leggi(l.indici.data(), (size_t)ni * 4))
+                    return false;
+                for (unsigned int i : l.indici)
+                    if (i >= nv)
+                        return false;
+            }
+        }
+        return true;
+    }
+}
+
+#endif
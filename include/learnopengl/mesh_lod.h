@@ -0,0 +1,327 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh_opt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Livelli di dettaglio delle mesh, generati all'importazione e salvati nella cache (mesh_cache.h).
+// Semplificazione: collassi di lato guidati dalle quadriche d'errore (Garland-Heckbert 1997), con il vertice
+// rimosso che finisce su un vertice esistente: tutti i livelli condividono il vertex buffer del livello 0
+// e cambia solo l'index buffer. Restano fermi i vertici di bordo e quelli sulle cuciture UV/normali
+// (piu' vertici nella stessa posizione), cosi' i livelli non aprono crepe ne' spostano le coordinate texture.
+// Selezione: per ogni istanza e ogni pass si proietta l'errore geometrico di ogni livello in pixel e si
+// sceglie il livello piu' grossolano sotto la soglia, con isteresi per non alternare due livelli.
+namespace meshlod
+{
+    const int MAX_LIVELLI = 4;                          // livello 0 (mesh completa) + 3 semplificati
+    const float RAPPORTI[MAX_LIVELLI - 1] = { 0.5f, 0.25f, 0.125f };   // triangoli rispetto al livello 0
+    const size_t TRIANGOLI_MINIMI = 256;                // sotto questa soglia la mesh non viene semplificata
+
+    struct Livello {
+        std::vector<unsigned int> indici;
+        float errore = 0.0f;    // distanza stimata dalla superficie originale, in unita' del modello
+    };
+
+    // Quadrica simmetrica 4x4 (10 coefficienti) = somma dei quadrati delle distanze da un insieme di piani
+    struct Quadrica {
+        double a[10] = { 0 };
+
+        void piano(const glm::dvec3& n, double d)
+        {
+            a[0] += n.x * n.x; a[1] += n.x * n.y; a[2] += n.x * n.z; a[3] += n.x * d;
+            a[4] += n.y * n.y; a[5] += n.y * n.z; a[6] += n.y * d;
+            a[7] += n.z * n.z; a[8] += n.z * d;
+            a[9] += d * d;
+        }
+        void somma(const Quadrica& q)
+        {
+            for (int i = 0; i < 10; ++i)
+                a[i] += q.a[i];
+        }
+        double valuta(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+                     + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+                     + a[7] * z * z + 2 * a[8] * z + a[9];
+            return e > 0.0 ? e : 0.0;
+        }
+    };
+
+    // Genera fino a MAX_LIVELLI - 1 livelli (meno se la mesh e' piccola o smette di ridursi).
+    // Gli index buffer risultanti sono gia' ordinati per la cache dei vertici e l'overdraw.
+    template <typename V>
+    inline std::vector<Livello> genera(const std::vector<V>& vertici, const std::vector<unsigned int>& indici)
+    {
+        std::vector<Livello> livelli;
+        size_t nTri = indici.size() / 3, nV = vertici.size();
+        if (nTri < TRIANGOLI_MINIMI || indici.size() % 3 != 0)
+            return livelli;
+
+        // posizioni uniche: canonico[v] = primo vertice con la stessa posizione
+        struct HashPos {
+            size_t operator()(const glm::vec3& p) const
+            {
+                uint32_t b[3];
+                memcpy(b, &p, sizeof(b));
+                return ((size_t)b[0] * 73856093u) ^ ((size_t)b[1] * 19349663u) ^ ((size_t)b[2] * 83492791u);
+            }
+        };
+        std::unordered_map<glm::vec3, unsigned int, HashPos> posizioni(nV * 2);
+        std::vector<unsigned int> canonico(nV), copie(nV, 0);
+        for (unsigned int v = 0; v < nV; ++v)
+        {
+            canonico[v] = posizioni.emplace(vertici[v].Position, v).first->second;
+            copie[canonico[v]]++;
+        }
+
+        // vertici bloccati: cuciture (piu' copie nella stessa posizione), bordi e lati non manifold
+        std::vector<char> bloccato(nV, 0);
+        std::unordered_map<uint64_t, unsigned int> lati(indici.size() * 2);
+        for (size_t t = 0; t < nTri; ++t)
+            for (int c = 0; c < 3; ++c)
+            {
+                uint64_t a = canonico[indici[t * 3 + c]], b = canonico[indici[t * 3 + (c + 1) % 3]];
+                lati[a < b ? (a << 32 | b) : (b << 32 | a)]++;
+            }
+        for (const auto& l : lati)
+            if (l.second != 2)
+            {
+                bloccato[(unsigned int)(l.first >> 32)] = 1;
+                bloccato[(unsigned int)(l.first & 0xFFFFFFFFu)] = 1;
+            }
+        for (unsigned int v = 0; v < nV; ++v)
+            if (copie[canonico[v]] > 1 || bloccato[canonico[v]])
+                bloccato[v] = 1;
+
+        // quadriche dei piani dei triangoli, accumulate sulla posizione
+        std::vector<Quadrica> quadriche(nV);
+        std::vector<unsigned int> tri(indici);
+        std::vector<std::vector<unsigned int>> adiacenti(nV);
+        for (size_t t = 0; t < nTri; ++t)
+        {
+            glm::dvec3 a(vertici[tri[t * 3]].Position), b(vertici[tri[t * 3 + 1]].Position), c(vertici[tri[t * 3 + 2]].Position);
+            glm::dvec3 n = glm::cross(b - a, c - a);
+            double len = glm::length(n);
+            if (len > 0.0)
+            {
+                n /= len;
+                for (int k = 0; k < 3; ++k)
+                    quadriche[canonico[tri[t * 3 + k]]].piano(n, -glm::dot(n, a));
+            }
+            for (int k = 0; k < 3; ++k)
+                adiacenti[tri[t * 3 + k]].push_back((unsigned int)t);
+        }
+
+        std::vector<char> vivo(nTri, 1), rimosso(nV, 0);
+        std::vector<unsigned int> versione(nV, 0), destinazione(nV, 0);
+        size_t triVivi = nTri;
+
+        // Il collasso u -> v non deve ribaltare nessun triangolo di u che sopravvive
+        auto valido = [&](unsigned int u, unsigned int v) {
+            const glm::vec3& pv = vertici[v].Position;
+            for (unsigned int t : adiacenti[u])
+            {
+                if (!vivo[t])
+                    continue;
+                const unsigned int* f = &tri[t * 3];
+                if (f[0] == v || f[1] == v || f[2] == v)
+                    continue;
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    p[k] = vertici[f[k]].Position;
+                    q[k] = f[k] == u ? pv : p[k];
+                }
+                glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(n0, n1) <= 0.0f)
+                    return false;
+            }
+            return true;
+        };
+
+        struct Candidato {
+            double costo;
+            unsigned int vertice, versione;
+            bool operator<(const Candidato& o) const { return costo > o.costo; }   // min-heap
+        };
+        std::priority_queue<Candidato> coda;
+        auto valutaVertice = [&](unsigned int u) {
+            if (bloccato[u] || rimosso[u])
+                return;
+            double migliore = -1.0;
+            for (unsigned int t : adiacenti[u])
+                if (vivo[t])
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        unsigned int w = tri[t * 3 + k];
+                        if (w == u)
+                            continue;
+                        double costo = quadriche[u].valuta(vertici[w].Position);
+                        if ((migliore < 0.0 || costo < migliore) && valido(u, w))
+                        {
+                            migliore = costo;
+                            destinazione[u] = w;
+                        }
+                    }
+            if (migliore >= 0.0)
+                coda.push({ migliore, u, versione[u] });
+        };
+        for (unsigned int v = 0; v < nV; ++v)
+            valutaVertice(v);
+
+        auto istantanea = [&](double erroreMax) {
+            Livello l;
+            l.errore = (float)std::sqrt(erroreMax);
+            l.indici.reserve(triVivi * 3);
+            for (size_t t = 0; t < nTri; ++t)
+                if (vivo[t])
+                    l.indici.insert(l.indici.end(), tri.begin() + t * 3, tri.begin() + t * 3 + 3);
+            std::vector<size_t> cluster;
+            l.indici = meshopt::tipsify(l.indici, nV, meshopt::CACHE_VERTICI, cluster);
+            meshopt::ordinaOverdraw(l.indici, vertici, cluster);
+            livelli.push_back(std::move(l));
+        };
+
+        double erroreMax = 0.0;
+        std::vector<unsigned int> vicini;
+        while (livelli.size() < MAX_LIVELLI - 1 && !coda.empty())
+        {
+            Candidato c = coda.top();
+            coda.pop();
+            unsigned int u = c.vertice;
+            if (rimosso[u] || c.versione != versione[u])
+                continue;
+            unsigned int v = destinazione[u];
+
+            // collasso u -> v: i triangoli con entrambi spariscono, gli altri passano a v
+            std::vector<unsigned int> nuovi;
+            for (unsigned int t : adiacenti[v])
+                if (vivo[t])
+                    nuovi.push_back(t);
+            for (unsigned int t : adiacenti[u])
+            {
+                if (!vivo[t])
+                    continue;
+                unsigned int* f = &tri[t * 3];
+                if (f[0] == v || f[1] == v || f[2] == v)
+                {
+                    vivo[t] = 0;
+                    --triVivi;
+                    continue;
+                }
+                for (int k = 0; k < 3; ++k)
+                    if (f[k] == u)
+                        f[k] = v;
+                nuovi.push_back(t);
+            }
+            adiacenti[v].swap(nuovi);
+            std::vector<unsigned int>().swap(adiacenti[u]);
+            rimosso[u] = 1;
+            quadriche[canonico[v]].somma(quadriche[u]);
+            erroreMax = std::max(erroreMax, c.costo);
+
+            // i vicini di v cambiano costo o validita': nuova valutazione con versione aggiornata
+            vicini.clear();
+            for (unsigned int t : adiacenti[v])
+                for (int k = 0; k < 3; ++k)
+                    vicini.push_back(tri[t * 3 + k]);
+            std::sort(vicini.begin(), vicini.end());
+            vicini.erase(std::unique(vicini.begin(), vicini.end()), vicini.end());
+            for (unsigned int w : vicini)
+            {
+                versione[w]++;
+                valutaVertice(w);
+            }
+
+            if (triVivi <= (size_t)(nTri * RAPPORTI[livelli.size()]))
+                istantanea(erroreMax);
+        }
+        // semplificazione bloccata prima dell'obiettivo: si tiene il risultato se riduce ancora abbastanza
+        size_t precedenti = livelli.empty() ? nTri : livelli.back().indici.size() / 3;
+        if (livelli.size() < MAX_LIVELLI - 1 && triVivi * 5 < precedenti * 4)
+            istantanea(erroreMax);
+        return livelli;
+    }
+
+    // Punto di vista di un pass: proiezione prospettica (pixel per unita' a distanza 1) o ortografica
+    // (pixel per unita' costanti, come le shadow map), piu' lo spostamento di livello del pass.
+    struct Vista {
+        glm::vec3 occhio = glm::vec3(0.0f);
+        float pixelPerUnita = 1.0f;
+        bool ortografica = false;
+        int bias = 0;
+    };
+
+    // Pixel sullo schermo di un'unita' del modello per un'istanza con bounding box [minimo, massimo]
+    // in spazio modello: si usa il punto del box trasformato piu' vicino all'osservatore
+    inline float pixelPerUnitaModello(const glm::vec3& minimo, const glm::vec3& massimo, const glm::mat4& model, const Vista& vista)
+    {
+        float scala = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        if (vista.ortografica)
+            return vista.pixelPerUnita * scala;
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (int i = 0; i < 8; ++i)
+        {
+            glm::vec3 angolo((i & 1) ? massimo.x : minimo.x, (i & 2) ? massimo.y : minimo.y, (i & 4) ? massimo.z : minimo.z);
+            glm::vec3 p = glm::vec3(model * glm::vec4(angolo, 1.0f));
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        float distanza = glm::length(glm::clamp(vista.occhio, lo, hi) - vista.occhio);
+        return vista.pixelPerUnita * scala / std::max(distanza, 0.1f);
+    }
+
+    // Scelta del livello per istanza e pass. Con errori[i] crescenti (errori[0] = 0) si cerca il livello piu'
+    // grossolano il cui errore proiettato resta sotto sogliaPixel; per cambiare livello rispetto al frame
+    // precedente bisogna superare la soglia di un margine (isteresi) in una delle due direzioni.
+    class SelettoreLod
+    {
+    public:
+        float sogliaPixel = 1.0f;
+        float isteresi = 0.25f;
+        bool attivo = true;
+
+        int seleziona(const void* istanza, int passo, const std::vector<float>& errori, float pixelPerUnita, int bias)
+        {
+            int n = (int)errori.size();
+            if (!attivo || n <= 1)
+                return 0;
+            auto piuGrossolano = [&](float soglia) {
+                int l = 0;
+                while (l + 1 < n && errori[l + 1] * pixelPerUnita <= soglia)
+                    ++l;
+                return l;
+            };
+            int livello;
+            auto it = stato.find(std::make_pair(istanza, passo));
+            if (it == stato.end())
+                livello = piuGrossolano(sogliaPixel);
+            else
+                livello = std::min(std::max(it->second, piuGrossolano(sogliaPixel * (1.0f - isteresi))),
+                                   piuGrossolano(sogliaPixel * (1.0f + isteresi)));
+            stato[std::make_pair(istanza, passo)] = livello;
+            return std::min(std::max(livello + bias, 0), n - 1);
+        }
+
+        // Dimentica i livelli precedenti (salti di camera, job batch indipendenti)
+        void reset() { stato.clear(); }
+
+    private:
+        std::map<std::pair<const void*, int>, int> stato;
+    };
+}
+
+#endif
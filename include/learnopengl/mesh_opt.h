@@ -0,0 +1,264 @@
+#ifndef MESH_OPT_H
+#define MESH_OPT_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Ottimizzazione delle mesh all'importazione (il risultato finisce nella cache binaria, vedi mesh_cache.h):
+// 1. saldatura dei vertici identici bit a bit (gli OBJ arrivano da Assimp con un vertice per angolo di faccia)
+// 2. ordine dei triangoli per la cache post-transform dei vertici (Tipsify, Sander et al. 2007)
+// 3. ordine dei cluster prodotti da Tipsify per ridurre l'overdraw: prima quelli rivolti verso l'esterno,
+//    che tendono a coprire gli altri da qualunque punto di vista
+// 4. ordine dei vertici per primo utilizzo, cosi' il fetch dal vertex buffer e' quasi sequenziale
+// Il tipo di vertice deve avere un membro glm::vec3 Position e nessun byte di padding non inizializzato.
+namespace meshopt
+{
+    const int CACHE_VERTICI = 16;   // cache FIFO simulata per Tipsify e per le statistiche
+
+    struct Statistiche {
+        size_t verticiPrima = 0, verticiDopo = 0, triangoli = 0;
+        size_t missPrima = 0, missDopo = 0;   // trasformazioni di vertice con la cache simulata
+
+        float acmrPrima() const { return triangoli ? (float)missPrima / triangoli : 0.0f; }
+        float acmrDopo() const { return triangoli ? (float)missDopo / triangoli : 0.0f; }
+        float atvrPrima() const { return verticiPrima ? (float)missPrima / verticiPrima : 0.0f; }
+        float atvrDopo() const { return verticiDopo ? (float)missDopo / verticiDopo : 0.0f; }
+
+        void somma(const Statistiche& s)
+        {
+            verticiPrima += s.verticiPrima;
+            verticiDopo += s.verticiDopo;
+            triangoli += s.triangoli;
+            missPrima += s.missPrima;
+            missDopo += s.missDopo;
+        }
+    };
+
+    // Vertici trasformati con una cache FIFO di CACHE_VERTICI elementi:
+    // ACMR = miss / triangoli (minimo ~0.5), ATVR = miss / vertici (minimo 1.0)
+    inline size_t missCache(const std::vector<unsigned int>& indici, size_t nVertici)
+    {
+        std::vector<size_t> inserito(nVertici, 0);   // istante di ingresso in cache + 1 (0 = mai)
+        size_t miss = 0;
+        for (unsigned int v : indici)
+            if (inserito[v] == 0 || miss - inserito[v] >= (size_t)CACHE_VERTICI)
+            {
+                ++miss;
+                inserito[v] = miss;
+            }
+        return miss;
+    }
+
+    template <typename V>
+    inline void salda(std::vector<V>& vertici, std::vector<unsigned int>& indici)
+    {
+        struct Hash {
+            const std::vector<V>* v;
+            size_t operator()(unsigned int i) const
+            {
+                const unsigned char* p = (const unsigned char*)&(*v)[i];
+                size_t h = 14695981039346656037ull;
+                for (size_t k = 0; k < sizeof(V); ++k)
+                    h = (h ^ p[k]) * 1099511628211ull;
+                return h;
+            }
+        };
+        struct Uguale {
+            const std::vector<V>* v;
+            bool operator()(unsigned int a, unsigned int b) const { return memcmp(&(*v)[a], &(*v)[b], sizeof(V)) == 0; }
+        };
+        std::unordered_map<unsigned int, unsigned int, Hash, Uguale> visti(vertici.size() * 2, Hash{ &vertici }, Uguale{ &vertici });
+        std::vector<unsigned int> rimappa(vertici.size());
+        std::vector<V> unici;
+        unici.reserve(vertici.size());
+        for (unsigned int i = 0; i < vertici.size(); ++i)
+        {
+            auto r = visti.emplace(i, (unsigned int)unici.size());
+            if (r.second)
+                unici.push_back(vertici[i]);
+            rimappa[i] = r.first->second;
+        }
+        for (unsigned int& i : indici)
+            i = rimappa[i];
+        vertici.swap(unici);
+    }
+
+    // Tipsify: ordina i triangoli "a ventaglio" attorno a vertici ancora in cache. cluster riceve l'indice
+    // del primo triangolo di ogni gruppo iniziato con un salto (vertice morto), usato dall'ordine per l'overdraw.
+    inline std::vector<unsigned int> tipsify(const std::vector<unsigned int>& indici, size_t nVertici, int k, std::vector<size_t>& cluster)
+    {
+        size_t nTri = indici.size() / 3;
+        // adiacenza vertice -> triangoli (CSR)
+        std::vector<unsigned int> inizio(nVertici + 1, 0), vivi(nVertici, 0);
+        for (unsigned int v : indici)
+            vivi[v]++;
+        for (size_t v = 0; v < nVertici; ++v)
+            inizio[v + 1] = inizio[v] + vivi[v];
+        std::vector<unsigned int> adiacenti(indici.size()), riempiti(inizio.begin(), inizio.end() - 1);
+        for (size_t t = 0; t < nTri; ++t)
+            for (int c = 0; c < 3; ++c)
+                adiacenti[riempiti[indici[t * 3 + c]]++] = (unsigned int)t;
+
+        std::vector<int> tempo(nVertici, 0);
+        std::vector<char> emesso(nTri, 0);
+        std::vector<unsigned int> morti, out, candidati;
+        out.reserve(indici.size());
+        int s = k + 1;
+        size_t cursore = 0;
+        long long f = nVertici ? 0 : -1;
+        cluster.clear();
+        bool salto = true;
+        while (f >= 0)
+        {
+            if (salto)
+                cluster.push_back(out.size() / 3);
+            candidati.clear();
+            for (unsigned int a = inizio[f]; a < inizio[f + 1]; ++a)
+            {
+                unsigned int t = adiacenti[a];
+                if (emesso[t])
+                    continue;
+                for (int c = 0; c < 3; ++c)
+                {
+                    unsigned int v = indici[t * 3 + c];
+                    out.push_back(v);
+                    morti.push_back(v);
+                    candidati.push_back(v);
+                    vivi[v]--;
+                    if (s - tempo[v] > k)
+                        tempo[v] = s++;
+                }
+                emesso[t] = 1;
+            }
+            // prossimo ventaglio: il candidato che restera' in cache e ha piu' triangoli da emettere
+            long long n = -1;
+            int migliore = -1;
+            for (unsigned int v : candidati)
+                if (vivi[v] > 0)
+                {
+                    int p = 0;
+                    if (s - tempo[v] + 2 * (int)vivi[v] <= k)
+                        p = s - tempo[v];
+                    if (p > migliore)
+                    {
+                        migliore = p;
+                        n = v;
+                    }
+                }
+            salto = n < 0;
+            if (salto)
+            {
+                // vicolo cieco: un vertice recente ancora vivo, altrimenti il primo vivo in ordine
+                while (!morti.empty() && n < 0)
+                {
+                    unsigned int d = morti.back();
+                    morti.pop_back();
+                    if (vivi[d] > 0)
+                        n = d;
+                }
+                for (; n < 0 && cursore < nVertici; ++cursore)
+                    if (vivi[cursore] > 0)
+                        n = (long long)cursore;
+            }
+            f = n;
+        }
+        return out;
+    }
+
+    // Cluster ordinati per "potenziale di occlusione": dot(centro del cluster - centro della mesh, normale del cluster)
+    template <typename V>
+    inline void ordinaOverdraw(std::vector<unsigned int>& indici, const std::vector<V>& vertici, const std::vector<size_t>& cluster)
+    {
+        size_t nTri = indici.size() / 3;
+        if (cluster.size() < 2)
+            return;
+        struct Info { size_t primo, fine; float priorita; };
+        std::vector<Info> info;
+        glm::vec3 centroMesh(0.0f);
+        float areaMesh = 0.0f;
+        std::vector<glm::vec3> centri, normali;
+        std::vector<float> aree;
+        for (size_t c = 0; c < cluster.size(); ++c)
+        {
+            size_t fine = c + 1 < cluster.size() ? cluster[c + 1] : nTri;
+            glm::vec3 centro(0.0f), normale(0.0f);
+            float area = 0.0f;
+            for (size_t t = cluster[c]; t < fine; ++t)
+            {
+                const glm::vec3& a = vertici[indici[t * 3]].Position;
+                const glm::vec3& b = vertici[indici[t * 3 + 1]].Position;
+                const glm::vec3& d = vertici[indici[t * 3 + 2]].Position;
+                glm::vec3 n = glm::cross(b - a, d - a);
+                float at = glm::length(n) * 0.5f;
+                centro += (a + b + d) * (at / 3.0f);
+                normale += n;
+                area += at;
+            }
+            centroMesh += centro;
+            areaMesh += area;
+            centri.push_back(area > 0.0f ? centro / area : centro);
+            normali.push_back(normale);
+            aree.push_back(area);
+            info.push_back({ cluster[c], fine, 0.0f });
+        }
+        if (areaMesh > 0.0f)
+            centroMesh /= areaMesh;
+        for (size_t c = 0; c < info.size(); ++c)
+        {
+            float len = glm::length(normali[c]);
+            info[c].priorita = len > 0.0f ? glm::dot(centri[c] - centroMesh, normali[c] / len) : 0.0f;
+        }
+        std::stable_sort(info.begin(), info.end(), [](const Info& a, const Info& b) { return a.priorita > b.priorita; });
+        std::vector<unsigned int> out;
+        out.reserve(indici.size());
+        for (const Info& c : info)
+            out.insert(out.end(), indici.begin() + c.primo * 3, indici.begin() + c.fine * 3);
+        indici.swap(out);
+    }
+
+    // Vertici rinumerati nell'ordine in cui l'index buffer li usa la prima volta
+    template <typename V>
+    inline void ordinaFetch(std::vector<V>& vertici, std::vector<unsigned int>& indici)
+    {
+        const unsigned int NESSUNO = 0xFFFFFFFFu;
+        std::vector<unsigned int> rimappa(vertici.size(), NESSUNO);
+        std::vector<V> out;
+        out.reserve(vertici.size());
+        for (unsigned int& i : indici)
+        {
+            if (rimappa[i] == NESSUNO)
+            {
+                rimappa[i] = (unsigned int)out.size();
+                out.push_back(vertici[i]);
+            }
+            i = rimappa[i];
+        }
+        vertici.swap(out);   // i vertici non referenziati vengono scartati
+    }
+
+    template <typename V>
+    inline Statistiche ottimizza(std::vector<V>& vertici, std::vector<unsigned int>& indici)
+    {
+        Statistiche st;
+        st.verticiPrima = vertici.size();
+        st.triangoli = indici.size() / 3;
+        st.missPrima = missCache(indici, vertici.size());
+        if (indici.size() % 3 == 0 && !indici.empty())
+        {
+            salda(vertici, indici);
+            std::vector<size_t> cluster;
+            indici = tipsify(indici, vertici.size(), CACHE_VERTICI, cluster);
+            ordinaOverdraw(indici, vertici, cluster);
+            ordinaFetch(vertici, indici);
+        }
+        st.verticiDopo = vertici.size();
+        st.missDopo = missCache(indici, vertici.size());
+        return st;
+    }
+}
+
+#endif
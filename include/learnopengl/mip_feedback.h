@@ -0,0 +1,120 @@
+#ifndef MIP_FEEDBACK_H
+#define MIP_FEEDBACK_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Stima su CPU del livello di mipmap necessario a ogni superficie, usata per guidare lo streaming
+// delle texture (TextureStreamer::richiedi) senza leggere un feedback buffer dalla GPU.
+// Per ogni superficie si misura una volta la densita' UV (unita' UV per unita' di mondo, da area UV
+// e area geometrica dei triangoli); a ogni frame la si confronta con i pixel per unita' di mondo
+// nel punto del bounding box piu' vicino alla camera. La stima e' conservativa: tutta la superficie
+// riceve il livello necessario al suo punto piu' vicino.
+
+struct SuperficieMip {
+    glm::vec3 minimo = glm::vec3(0.0f);
+    glm::vec3 massimo = glm::vec3(0.0f);
+    float uvPerUnita = 0.0f;
+};
+
+// Misura di una lista di triangoli trasformata da m; pos(i) e uv(i) restituiscono gli attributi del vertice i
+template <typename Pos, typename UV>
+inline SuperficieMip misuraSuperficie(size_t nVertici, const unsigned int* indici, size_t nIndici, Pos pos, UV uv, const glm::mat4& m)
+{
+    SuperficieMip s;
+    if (nVertici == 0)
+        return s;
+    std::vector<glm::vec3> mondo(nVertici);
+    s.minimo = glm::vec3(1e30f);
+    s.massimo = glm::vec3(-1e30f);
+    for (size_t i = 0; i < nVertici; ++i)
+    {
+        mondo[i] = glm::vec3(m * glm::vec4(pos(i), 1.0f));
+        s.minimo = glm::min(s.minimo, mondo[i]);
+        s.massimo = glm::max(s.massimo, mondo[i]);
+    }
+    double areaMondo = 0.0, areaUV = 0.0;
+    for (size_t t = 0; t + 2 < nIndici; t += 3)
+    {
+        unsigned int a = indici[t], b = indici[t + 1], c = indici[t + 2];
+        areaMondo += 0.5 * glm::length(glm::cross(mondo[b] - mondo[a], mondo[c] - mondo[a]));
+        glm::vec2 e1 = uv(b) - uv(a), e2 = uv(c) - uv(a);
+        areaUV += 0.5 * std::fabs(e1.x * e2.y - e1.y * e2.x);
+    }
+    s.uvPerUnita = areaMondo > 0.0 ? (float)std::sqrt(areaUV / areaMondo) : 0.0f;
+    return s;
+}
+
+// Mesh caricata con Assimp (spazio modello)
+inline SuperficieMip misuraMesh(const Mesh& mesh, const glm::mat4& m = glm::mat4(1.0f))
+{
+    const std::vector<Vertex>& v = mesh.vertices;
+    return misuraSuperficie(v.size(), mesh.indices.data(), mesh.indices.size(),
+        [&v](size_t i) { return v[i].Position; }, [&v](size_t i) { return v[i].TexCoords; }, m);
+}
+
+// Vertici interleaved come planeVertices/wallVertices: posizione in [0..2], UV in [6..7], stride in float
+inline SuperficieMip misuraQuad(const float* vertici, size_t nVertici, size_t stride, const unsigned int* indici, size_t nIndici, const glm::mat4& m)
+{
+    return misuraSuperficie(nVertici, indici, nIndici,
+        [=](size_t i) { return glm::vec3(vertici[i * stride], vertici[i * stride + 1], vertici[i * stride + 2]); },
+        [=](size_t i) { return glm::vec2(vertici[i * stride + 6], vertici[i * stride + 7]); }, m);
+}
+
+// Porta una superficie misurata in spazio modello nello spazio mondo (scala uniforme)
+inline SuperficieMip trasforma(const SuperficieMip& locale, const glm::mat4& m)
+{
+    SuperficieMip s;
+    s.minimo = glm::vec3(1e30f);
+    s.massimo = glm::vec3(-1e30f);
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 angolo((i & 1) ? locale.massimo.x : locale.minimo.x,
+                         (i & 2) ? locale.massimo.y : locale.minimo.y,
+                         (i & 4) ? locale.massimo.z : locale.minimo.z);
+        glm::vec3 p = glm::vec3(m * glm::vec4(angolo, 1.0f));
+        s.minimo = glm::min(s.minimo, p);
+        s.massimo = glm::max(s.massimo, p);
+    }
+    float scala = glm::length(glm::vec3(m[0]));
+    s.uvPerUnita = scala > 0.0f ? locale.uvPerUnita / scala : 0.0f;
+    return s;
+}
+
+// false se il bounding box e' interamente fuori da uno dei piani del frustum di viewProj
+inline bool visibile(const SuperficieMip& s, const glm::mat4& viewProj)
+{
+    glm::vec4 clip[8];
+    for (int i = 0; i < 8; ++i)
+        clip[i] = viewProj * glm::vec4((i & 1) ? s.massimo.x : s.minimo.x,
+                                       (i & 2) ? s.massimo.y : s.minimo.y,
+                                       (i & 4) ? s.massimo.z : s.minimo.z, 1.0f);
+    for (int asse = 0; asse < 3; ++asse)
+    {
+        bool fuoriMin = true, fuoriMax = true;
+        for (int i = 0; i < 8; ++i)
+        {
+            fuoriMin = fuoriMin && clip[i][asse] < -clip[i].w;
+            fuoriMax = fuoriMax && clip[i][asse] > clip[i].w;
+        }
+        if (fuoriMin || fuoriMax)
+            return false;
+    }
+    return true;
+}
+
+// Unita' UV coperte da un pixel dello schermo nel punto della superficie piu' vicino alla camera
+inline float uvPerPixel(const SuperficieMip& s, const glm::vec3& camera, float fovYGradi, int altezzaSchermo)
+{
+    glm::vec3 vicino = glm::clamp(camera, s.minimo, s.massimo);
+    float distanza = std::max(glm::length(camera - vicino), 0.1f);
+    float pixelPerUnita = altezzaSchermo / (2.0f * distanza * std::tan(glm::radians(fovYGradi) * 0.5f));
+    return s.uvPerUnita / pixelPerUnita;
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIPMAP_SSE2 1
+#endif
+
+// Generazione delle mipmap su CPU, al posto di glGenerateMipmap:
+// - Colore: media 2x2 in spazio lineare (le texture diffuse sono sRGB), alpha lineare
+// - Lineare: media 2x2 diretta (gloss, roughness)
+// - Normale: media 2x2 dei vettori e rinormalizzazione, cosi' il dettaglio delle normal map non si appiattisce
+// Tutti i tipi passano per una rappresentazione lineare a 14 bit (4 campioni sommati stanno in 16 bit),
+// la media 2x2 usa SSE2 per 1, 3 e 4 canali; le righe di output sono divise in bande sul ThreadPool condiviso.
+namespace mipmap
+{
+    enum Tipo { Colore, Lineare, Normale };
+
+    // Tipo dedotto dal nome del file (convenzioni Poliigon / Renderpeople del progetto)
+    inline Tipo tipoDaNome(const std::string& path)
+    {
+        std::string n = path;
+        std::transform(n.begin(), n.end(), n.begin(), ::tolower);
+        size_t slash = n.find_last_of("/\\");
+        if (slash != std::string::npos)
+            n = n.substr(slash + 1);
+        if (n.find("norm") != std::string::npos)
+            return Normale;
+        if (n.find("gloss") != std::string::npos || n.find("rough") != std::string::npos || n.find("spec") != std::string::npos)
+            return Lineare;
+        return Colore;
+    }
+
+    const int MAX14 = 16383;
+
+    struct Tabelle {
+        unsigned short srgbA14[256];     // sRGB 8 bit -> lineare 14 bit
+        unsigned short linA14[256];      // lineare 8 bit -> 14 bit
+        unsigned char a14Srgb[MAX14 + 1];
+        unsigned char a14Lin[MAX14 + 1];
+        Tabelle()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                double c = i / 255.0;
+                double l = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+                srgbA14[i] = (unsigned short)std::lround(l * MAX14);
+                linA14[i] = (unsigned short)((i * MAX14 + 127) / 255);
+            }
+            for (int v = 0; v <= MAX14; ++v)
+            {
+                double l = (double)v / MAX14;
+                double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+                a14Srgb[v] = (unsigned char)std::lround(std::min(std::max(c, 0.0), 1.0) * 255.0);
+                a14Lin[v] = (unsigned char)((v * 255 + MAX14 / 2) / MAX14);
+            }
+        }
+    };
+
+    inline const Tabelle& tabelle()
+    {
+        static Tabelle t;
+        return t;
+    }
+
+    // Media 2x2 di due righe a 14 bit (n pixel sorgente, c canali) -> nw pixel a 14 bit
+    inline void mediaRighe(const unsigned short* r0, const unsigned short* r1, int w, int c, unsigned short* out, int nw)
+    {
+        int x = 0;
+#ifdef MIPMAP_SSE2
+        const __m128i due = _mm_set1_epi16(2);
+        if (c == 4)
+        {
+            // 4 pixel sorgente (16 valori) -> 2 pixel di output per iterazione
+            for (; 2 * x + 3 < w && x + 1 < nw; x += 2)
+            {
+                __m128i a = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0 + 8 * x)), _mm_loadu_si128((const __m128i*)(r1 + 8 * x)));
+                __m128i b = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0 + 8 * x + 8)), _mm_loadu_si128((const __m128i*)(r1 + 8 * x + 8)));
+                a = _mm_add_epi16(a, _mm_srli_si128(a, 8));   // pixel 0 + pixel 1 nelle 4 lane basse
+                b = _mm_add_epi16(b, _mm_srli_si128(b, 8));
+                __m128i s = _mm_unpacklo_epi64(a, b);
+                s = _mm_srli_epi16(_mm_add_epi16(s, due), 2);
+                _mm_storeu_si128((__m128i*)(out + 4 * x), s);
+            }
+        }
+        else if (c == 3)
+        {
+            // 2 pixel sorgente (6 valori, letti come 8) -> 1 pixel di output; la scrittura di 4 valori
+            // sconfina nel pixel successivo, che viene riscritto al passo dopo (per questo x + 1 < nw)
+            for (; 6 * x + 8 <= 3 * w && x + 1 < nw; ++x)
+            {
+                __m128i a = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0 + 6 * x)), _mm_loadu_si128((const __m128i*)(r1 + 6 * x)));
+                __m128i s = _mm_add_epi16(a, _mm_srli_si128(a, 6));   // pixel 0 + pixel 1 nelle 3 lane basse
+                s = _mm_srli_epi16(_mm_add_epi16(s, due), 2);
+                _mm_storel_epi64((__m128i*)(out + 3 * x), s);
+            }
+        }
+        else if (c == 1)
+        {
+            // 16 pixel sorgente -> 8 di output; madd somma le coppie adiacenti (somma verticale <= 32766, ok con segno)
+            const __m128i uno = _mm_set1_epi16(1);
+            const __m128i due32 = _mm_set1_epi32(2);
+            for (; 2 * x + 15 < w && x + 7 < nw; x += 8)
+            {
+                __m128i a = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0 + 2 * x)), _mm_loadu_si128((const __m128i*)(r1 + 2 * x)));
+                __m128i b = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0 + 2 * x + 8)), _mm_loadu_si128((const __m128i*)(r1 + 2 * x + 8)));
+                a = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(a, uno), due32), 2);
+                b = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(b, uno), due32), 2);
+                _mm_storeu_si128((__m128i*)(out + x), _mm_packs_epi32(a, b));
+            }
+        }
+#endif
+        // coda scalare (ultima colonna replicata se w e' dispari)
+        for (; x < nw; ++x)
+        {
+            int x0 = std::min(2 * x, w - 1) * c, x1 = std::min(2 * x + 1, w - 1) * c;
+            for (int k = 0; k < c; ++k)
+                out[x * c + k] = (unsigned short)((r0[x0 + k] + r0[x1 + k] + r1[x0 + k] + r1[x1 + k] + 2) >> 2);
+        }
+    }
+
+    // Livello successivo della catena (dimensioni max(1, w/2) x max(1, h/2))
+    inline std::vector<unsigned char> halve(const unsigned char* src, int w, int h, int c, Tipo tipo)
+    {
+        const Tabelle& t = tabelle();
+        int nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+        std::vector<unsigned char> dst((size_t)nw * nh * c);
+
+        // tabelle di ingresso/uscita per canale: il colore e' sRGB tranne l'alpha
+        const unsigned short* in[4];
+        const unsigned char* outT[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            bool srgb = tipo == Colore && !(c == 4 && k == 3) && !(c == 2 && k == 1);
+            in[k] = srgb ? t.srgbA14 : t.linA14;
+            outT[k] = srgb ? t.a14Srgb : t.a14Lin;
+        }
+
+        auto banda = [&](int y0, int y1) {
+            std::vector<unsigned short> r0((size_t)w * c), r1((size_t)w * c), out((size_t)nw * c);
+            for (int y = y0; y < y1; ++y)
+            {
+                const unsigned char* s0 = src + (size_t)std::min(2 * y, h - 1) * w * c;
+                const unsigned char* s1 = src + (size_t)std::min(2 * y + 1, h - 1) * w * c;
+                for (int k = 0; k < c; ++k)
+                {
+                    const unsigned short* tab = in[k];
+                    for (int i = k; i < w * c; i += c)
+                    {
+                        r0[i] = tab[s0[i]];
+                        r1[i] = tab[s1[i]];
+                    }
+                }
+                mediaRighe(r0.data(), r1.data(), w, c, out.data(), nw);
+
+                unsigned char* d = &dst[(size_t)y * nw * c];
+                if (tipo == Normale && c >= 3)
+                {
+                    for (int x = 0; x < nw; ++x)
+                    {
+                        unsigned short* p = &out[(size_t)x * c];
+                        float n[3];
+                        for (int k = 0; k < 3; ++k)
+                            n[k] = p[k] * (2.0f / MAX14) - 1.0f;
+                        float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                        if (len > 1e-6f)
+                            for (int k = 0; k < 3; ++k)
+                                p[k] = (unsigned short)std::lround((n[k] / len + 1.0f) * 0.5f * MAX14);
+                    }
+                }
+                for (int k = 0; k < c; ++k)
+                {
+                    const unsigned char* tab = outT[k];
+                    for (int i = k; i < nw * c; i += c)
+                        d[i] = tab[out[i]];
+                }
+            }
+        };
+
+        // bande di righe in parallelo solo quando il livello e' abbastanza grande da ripagare la sincronizzazione
+        const int righePerBanda = 64;
+        int bande = (nh + righePerBanda - 1) / righePerBanda;
+        if ((size_t)nw * nh < 256 * 256 || bande < 2)
+            banda(0, nh);
+        else
+            ThreadPool::shared().parallelFor(bande, [&](int b) {
+                banda(b * righePerBanda, std::min(nh, (b + 1) * righePerBanda));
+            });
+        return dst;
+    }
+
+    // Catena di mipmap a partire dal livello 0 (incluso in posizione 0), fino a 1x1
+    inline std::vector<std::vector<unsigned char>> buildChain(std::vector<unsigned char> livello0, int w, int h, int c, Tipo tipo)
+    {
+        std::vector<std::vector<unsigned char>> livelli;
+        livelli.push_back(std::move(livello0));
+        while (w > 1 || h > 1)
+        {
+            livelli.push_back(halve(livelli.back().data(), w, h, c, tipo));
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+        return livelli;
+    }
+}
+
+#endif
@@ -12,6 +12,15 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/dds.h>
+#include <learnopengl/gloss_pack.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_lod.h>
+#include <learnopengl/mesh_opt.h>
+#include <learnopengl/mipmap.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/vfs.h>
+#include <learnopengl/vfs_assimp.h>
 
 #include <string>
 #include <fstream>
@@ -21,7 +30,12 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, const string &glossPath = "");
+// when set, TextureFromFile returns immediately and the texture is streamed in progressively (low mips first)
+TextureStreamer* textureStreamer = nullptr;
+// when set, a mesh's specular (gloss) map is packed into the alpha of its diffuse map instead of being bound on its own
+// (see gloss_pack.h); the shader must then be compiled with GLOSS_IN_DIFFUSE_ALPHA
+bool glossPacking = false;
 
 class Model 
 {
@@ -31,6 +45,9 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // model-space bounding box and, per level of detail, the largest error of any mesh (level 0 = 0)
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+    vector<float> lodErrors;
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
@@ -38,35 +55,119 @@ public:
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // draws the model, and thus all its meshes, at the given level of detail.
+    // All meshes live in the shared arena: one VAO bind, then a base-vertex draw per mesh.
+    void Draw(Shader &shader, int lod = 0)
     {
+        MeshArena<Vertex>::shared().bind();
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        {
+            meshes[i].BindTextures(shader);
+            meshes[i].DrawElements(lod);
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // triangles drawn by Draw at the given level of detail
+    size_t triangles(int lod = 0) const
+    {
+        size_t count = 0;
+        for (const Mesh &mesh : meshes)
+            count += mesh.triangles(lod);
+        return count;
     }
     
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // loads a model from its binary mesh cache when it is up to date, otherwise imports it with ASSIMP,
+    // optimizes the meshes (see mesh_opt.h) and writes the cache. Stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<meshcache::MeshCotta> cooked;
+        vector<string> sources;
+        bool fromCache = meshcache::aggiornata(path) && meshcache::read(meshcache::cachePath(path), cooked);
+        if (!fromCache)
+        {
+            cooked.clear();
+            // read file via ASSIMP
+            Assimp::Importer importer;
+            // model and material files are read through the asset VFS (pack or loose files);
+            // the importer owns the handler, which also records the files it opened for the cache
+            VfsIOSystem* io = new VfsIOSystem();
+            importer.SetIOHandler(io);
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+            // the prefetched buffers were kept across Assimp's repeated opens: free them now
+            for (const string& file : io->aperti())
+                vfs::rilascia(file);
+            // check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return;
+            }
+            // process ASSIMP's root node recursively
+            processNode(scene->mRootNode, scene, cooked);
+            sources = io->aperti();
+        }
+
+        // start reading every texture of the model in one asynchronous batch: while the meshes are
+        // optimized and uploaded the reads complete, and TextureFromFile picks the buffers up from the VFS
+        vector<string> files;
+        for (const meshcache::MeshCotta& m : cooked)
+            for (const vector<string>* list : { &m.materiale.diffuse, &m.materiale.specular, &m.materiale.normal, &m.materiale.height })
+                for (const string& name : *list)
+                    files.push_back(dds::fileToLoad(directory + '/' + name));
+        vfs::prefetch(files);
+
+        if (!fromCache)
+        {
+            // weld duplicates and reorder for the post-transform cache, overdraw and vertex fetch
+            meshopt::Statistiche total;
+            for (meshcache::MeshCotta& m : cooked)
+                total.somma(meshopt::ottimizza(m.vertici, m.indici));
+            cout << "Mesh optimization " << path << ": " << total.verticiPrima << " -> " << total.verticiDopo << " vertices, ACMR "
+                 << total.acmrPrima() << " -> " << total.acmrDopo() << ", ATVR " << total.atvrPrima() << " -> " << total.atvrDopo() << endl;
+            // simplified levels of detail, sharing the optimized vertices
+            size_t lodTriangles[meshlod::MAX_LIVELLI] = { 0 };
+            for (meshcache::MeshCotta& m : cooked)
+            {
+                m.lod = meshlod::genera(m.vertici, m.indici);
+                for (size_t l = 0; l < meshlod::MAX_LIVELLI; l++)
+                    lodTriangles[l] += (l == 0 || m.lod.empty() ? m.indici : m.lod[std::min(l, m.lod.size()) - 1].indici).size() / 3;
+            }
+            cout << "Mesh LODs " << path << ":";
+            for (int l = 0; l < meshlod::MAX_LIVELLI; l++)
+                cout << " " << lodTriangles[l];
+            cout << " triangles" << endl;
+            if (!meshcache::write(meshcache::cachePath(path), cooked, sources))
+                cout << "ERROR::MESH_CACHE:: cannot write " << meshcache::cachePath(path) << endl;
+        }
+
+        boundsMin = glm::vec3(1e30f);
+        boundsMax = glm::vec3(-1e30f);
+        for (meshcache::MeshCotta& m : cooked)
+        {
+            for (const Vertex& v : m.vertici)
+            {
+                boundsMin = glm::min(boundsMin, v.Position);
+                boundsMax = glm::max(boundsMax, v.Position);
+            }
+            meshes.push_back(Mesh(m.vertici, m.indici, loadMeshTextures(m.materiale), m.lod));
+            lodErrors.resize(std::max(lodErrors.size(), meshes.back().lodError.size()), 0.0f);
+        }
+        // a mesh with fewer levels keeps drawing its last one, whose error is the one that counts
+        for (const Mesh& mesh : meshes)
+            for (size_t l = 0; l < lodErrors.size(); l++)
+                lodErrors[l] = std::max(lodErrors[l], mesh.lodError[std::min(l, mesh.lodError.size() - 1)]);
+        if (meshes.empty())
+            boundsMin = boundsMax = glm::vec3(0.0f);
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    void processNode(aiNode *node, const aiScene *scene, vector<meshcache::MeshCotta> &out)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -74,27 +175,30 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            out.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, out);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // converts an ASSIMP mesh into vertex/index arrays plus the names of its material textures (no GL work)
+    meshcache::MeshCotta processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        meshcache::MeshCotta cooked;
+        vector<Vertex> &vertices = cooked.vertici;
+        vector<unsigned int> &indices = cooked.indici;
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
             Vertex vertex;
+            // zero everything (bone data included): vertices are welded and cached byte by byte
+            memset(&vertex, 0, sizeof(vertex));
             glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -142,8 +246,23 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);        
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
+        // process materials: only the texture names are kept here, loading happens in loadMeshTextures
+        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        const aiTextureType types[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT };
+        vector<string>* lists[] = { &cooked.materiale.diffuse, &cooked.materiale.specular, &cooked.materiale.normal, &cooked.materiale.height };
+        for (int t = 0; t < 4; t++)
+            for (unsigned int i = 0; i < material->GetTextureCount(types[t]); i++)
+            {
+                aiString str;
+                material->GetTexture(types[t], i, &str);
+                lists[t]->push_back(str.C_Str());
+            }
+        return cooked;
+    }
+
+    vector<Texture> loadMeshTextures(const meshcache::Materiale &material)
+    {
+        vector<Texture> textures;
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
         // Same applies to other texture as the following list summarizes:
@@ -151,37 +270,44 @@ private:
         // specular: texture_specularN
         // normal: texture_normalN
 
+        // with gloss packing the first specular map goes into the diffuse alpha and is not loaded on its own
+        string glossPath;
+        if (glossPacking && !material.specular.empty() && !material.diffuse.empty())
+            glossPath = material.specular[0];
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<Texture> diffuseMaps = loadMaterialTextures(material.diffuse, "texture_diffuse", glossPath);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        if (glossPath.empty())
+        {
+            vector<Texture> specularMaps = loadMaterialTextures(material.specular, "texture_specular");
+            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        }
+        // 3. normal maps (stored by the OBJ importer as height maps)
+        std::vector<Texture> normalMaps = loadMaterialTextures(material.normal, "texture_normal");
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        // 4. height maps (stored by the OBJ importer as ambient maps)
+        std::vector<Texture> heightMaps = loadMaterialTextures(material.height, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return textures;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // glossPath, when not empty, is packed into the alpha of the first texture (the diffuse map).
+    vector<Texture> loadMaterialTextures(const vector<string> &names, string typeName, const string &glossPath = "")
     {
         vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        for(unsigned int i = 0; i < names.size(); i++)
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
+            string gloss = i == 0 ? glossPath : string();
+            // a packed texture is a different texture from the plain diffuse: it gets its own cache key
+            string key = gloss.empty() ? names[i] : names[i] + "+" + gloss;
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
             bool skip = false;
             for(unsigned int j = 0; j < textures_loaded.size(); j++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if(textures_loaded[j].path == key)
                 {
                     textures.push_back(textures_loaded[j]);
                     skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
@@ -191,9 +317,9 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                texture.id = TextureFromFile(names[i].c_str(), this->directory, false, gloss);
                 texture.type = typeName;
-                texture.path = str.C_Str();
+                texture.path = key;
                 textures.push_back(texture);
                 textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
             }
@@ -203,36 +329,66 @@ private:
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, const string &glossPath)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    string glossFile = glossPath.empty() ? string() : directory + '/' + glossPath;
+
+    if (textureStreamer)
+        return textureStreamer->request(filename, false, glossFile);
+
+    // prefer the cooked DDS (BCn + precomputed mips) when tools/texcook has produced one
+    if (glossFile.empty())
+    {
+        unsigned int cooked = dds::loadTexture(dds::cookedPath(filename));
+        if (cooked)
+            return cooked;
+    }
+    else
+    {
+        // both cooked: diffuse and gloss blocks are merged into BC3 without re-encoding
+        dds::Image diffuse, gloss;
+        if (dds::read(dds::cookedPath(filename), diffuse) && dds::read(dds::cookedPath(glossFile), gloss)
+            && glosspack::packBlocks(diffuse, gloss))
+            return dds::createTexture(diffuse, false);
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    vfs::imageInfo(filename, &width, &height, &nrComponents);
+    // RGB stays 3 channels; 4 only for sources with alpha or when the gloss map is packed into it
+    int channels = !glossFile.empty() ? 4 : (nrComponents == 1 || nrComponents == 3 ? nrComponents : 4);
+    unsigned char *data = vfs::loadImage(filename, &width, &height, &nrComponents, channels);
     if (data)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+        if (!glossFile.empty())
+            glosspack::packPixels(data, width, height, glossFile);
+        // mip chain built on the CPU (sRGB-aware, normal maps renormalised) instead of glGenerateMipmap
+        std::vector<std::vector<unsigned char>> levels = mipmap::buildChain(
+            std::vector<unsigned char>(data, data + (size_t)width * height * channels),
+            width, height, channels, mipmap::tipoDaNome(filename));
+        stbi_image_free(data);
+        GLenum format = channels == 1 ? GL_RED : (channels == 3 ? GL_RGB : GL_RGBA);
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+            glTexImage2D(GL_TEXTURE_2D, (GLint)level, format, width, height, 0, format, GL_UNSIGNED_BYTE, levels[level].data());
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
     }
     else
     {
@@ -0,0 +1,95 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+
+// Render target fuori schermo: FBO con colore RGBA8 (texture, leggibile) e depth/stencil (renderbuffer).
+// Usato dalla modalita' headless al posto del default framebuffer della finestra.
+struct OffscreenTarget
+{
+    unsigned int FBO = 0;
+    unsigned int colorTex = 0;
+    unsigned int depthRBO = 0;
+    int width = 0;
+    int height = 0;
+
+    // crea (o ricrea) il target alla dimensione richiesta; ritorna false se l'FBO non e' completo
+    bool create(int w, int h)
+    {
+        destroy();
+        width = w;
+        height = h;
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        glGenTextures(1, &colorTex);
+        glBindTexture(GL_TEXTURE_2D, colorTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!complete)
+            std::cout << "ERROR::OFFSCREEN:: framebuffer " << width << "x" << height << " non completo" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    void destroy()
+    {
+        if (depthRBO) glDeleteRenderbuffers(1, &depthRBO);
+        if (colorTex) glDeleteTextures(1, &colorTex);
+        if (FBO) glDeleteFramebuffers(1, &FBO);
+        FBO = colorTex = depthRBO = 0;
+    }
+};
+
+// Crea un contesto OpenGL senza display per la modalita' headless.
+// Ordine di tentativi: piattaforma NULL di GLFW con OSMesa (nessun display ne' GPU richiesti),
+// poi finestra nascosta con contesto EGL, poi finestra nascosta con l'API nativa.
+// La finestra restituita non viene mai mostrata: si disegna solo dentro un OffscreenTarget.
+// major/minor: versione del profilo core richiesta
+inline GLFWwindow* createHeadlessContext(int major = 3, int minor = 3)
+{
+    struct Tentativo { int platform; int contextApi; const char* nome; };
+    const Tentativo tentativi[] = {
+        { GLFW_PLATFORM_NULL, GLFW_OSMESA_CONTEXT_API, "OSMesa" },
+        { GLFW_ANY_PLATFORM,  GLFW_EGL_CONTEXT_API,    "EGL" },
+        { GLFW_ANY_PLATFORM,  GLFW_NATIVE_CONTEXT_API, "nativo (finestra nascosta)" }
+    };
+
+    for (const Tentativo& t : tentativi)
+    {
+        glfwInitHint(GLFW_PLATFORM, t.platform);
+        if (!glfwInit())
+            continue;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, t.contextApi);
+
+        // la dimensione della finestra e' irrilevante, il rendering avviene nell'FBO
+        GLFWwindow* window = glfwCreateWindow(16, 16, "headless", NULL, NULL);
+        if (window)
+        {
+            std::cout << "Contesto headless creato: " << t.nome << std::endl;
+            return window;
+        }
+        glfwTerminate();
+    }
+    std::cout << "Failed to create headless OpenGL context" << std::endl;
+    return NULL;
+}
+
+#endif
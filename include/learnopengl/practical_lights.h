@@ -0,0 +1,105 @@
+#ifndef PRACTICAL_LIGHTS_H
+#define PRACTICAL_LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Luci pratiche dello studio (lampade visibili in scena): luci puntiformi in spazio mondo con raggio d'azione,
+// lette dal percorso forward (progetto.fs) e da quello deferred (deferred.fs) attraverso lo stesso uniform
+// block LuciPratiche (std140, binding BINDING). Le posizioni sono una griglia sotto il soffitto dello studio,
+// cosi' il numero di luci si puo' far crescere per confrontare i due percorsi con la stessa scena.
+class LuciPratiche
+{
+public:
+    static const int MAX = 256;             // dimensione degli array nel blocco (deve coincidere con gli shader)
+    static const int BINDING = 1;           // binding 0: blocco Oggetto (stream_buffer.h)
+
+    struct Luce {
+        glm::vec3 posizione;
+        float raggio;
+        glm::vec3 colore;
+    };
+
+    void init()
+    {
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Blocco), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo);
+        genera(0);
+    }
+
+    // Collega il blocco LuciPratiche di uno shader al binding (se lo shader lo usa)
+    static void collega(unsigned int programma)
+    {
+        unsigned int indice = glGetUniformBlockIndex(programma, "LuciPratiche");
+        if (indice != GL_INVALID_INDEX)
+            glUniformBlockBinding(programma, indice, BINDING);
+    }
+
+    // n luci in griglia sotto il soffitto (x in [-8.5, 8.5], z in [-3.5, 6.5], y = 2.6): piu' luci sono piu'
+    // fitte, con raggio e intensita' ridotti perche' l'illuminazione complessiva resti simile
+    void genera(int n)
+    {
+        n = std::max(0, std::min(n, MAX));
+        luci.clear();
+        if (n > 0)
+        {
+            const float minX = -8.5f, maxX = 8.5f, minZ = -3.5f, maxZ = 6.5f;
+            int colonne = std::max(1, (int)std::ceil(std::sqrt(n * (maxX - minX) / (maxZ - minZ))));
+            int righe = (n + colonne - 1) / colonne;
+            float passoX = (maxX - minX) / colonne, passoZ = (maxZ - minZ) / righe;
+            float raggio = glm::clamp(2.0f * std::max(passoX, passoZ), 1.5f, 4.0f);
+            float intensita = 0.5f * std::sqrt(std::min(1.0f, 8.0f / n));
+            for (int i = 0; i < n; ++i)
+            {
+                Luce l;
+                l.posizione = glm::vec3(minX + passoX * (i % colonne + 0.5f), 2.6f, minZ + passoZ * (i / colonne + 0.5f));
+                l.raggio = raggio;
+                // tungsteno con piccole variazioni di temperatura da una lampada all'altra
+                float t = (float)((i * 7919) % 101) / 100.0f;
+                l.colore = intensita * glm::mix(glm::vec3(1.0f, 0.78f, 0.55f), glm::vec3(1.0f, 0.9f, 0.8f), t);
+                luci.push_back(l);
+            }
+        }
+        carica();
+    }
+
+    int numero() const { return (int)luci.size(); }
+    const std::vector<Luce>& elenco() const { return luci; }
+
+private:
+    // layout std140 del blocco LuciPratiche negli shader
+    struct Blocco {
+        glm::vec4 posizioneRaggio[MAX];
+        glm::vec4 colore[MAX];
+        int numero;
+        int pad[3];
+    };
+
+    unsigned int ubo = 0;
+    std::vector<Luce> luci;
+
+    void carica()
+    {
+        if (!ubo)
+            return;
+        Blocco b = {};
+        for (size_t i = 0; i < luci.size(); ++i)
+        {
+            b.posizioneRaggio[i] = glm::vec4(luci[i].posizione, luci[i].raggio);
+            b.colore[i] = glm::vec4(luci[i].colore, 1.0f);
+        }
+        b.numero = (int)luci.size();
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Blocco), &b);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+#endif
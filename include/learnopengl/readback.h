@@ -0,0 +1,276 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/image_io.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+
+// Lettura asincrona del framebuffer tramite un anello di pixel buffer object.
+// capture() accoda un glReadPixels verso un PBO e un fence, senza attendere la GPU;
+// poll() (chiamato una volta per frame) copia i PBO gia' completati e li passa ai thread
+// di codifica, che ribaltano le righe e scrivono PNG/EXR con image_io.
+// Il mapping avviene sul thread GL (il contesto non e' condiviso con i worker),
+// ma e' solo una memcpy di un buffer gia' pronto. Con l'anello pieno capture() aspetta la GPU solo se
+// richiesto (batch, headless); altrimenti il frame viene scartato con un avviso.
+class AsyncReadback
+{
+public:
+    struct Stats {
+        unsigned long long catturati = 0;   // glReadPixels accodati
+        unsigned long long scritti = 0;     // immagini codificate su disco
+        unsigned long long scartati = 0;    // frame persi perche' i worker o la GPU erano in ritardo
+        unsigned long long falliti = 0;     // immagini perse per map del PBO o scrittura falliti
+        unsigned long long attese = 0;      // volte in cui capture() ha dovuto aspettare un fence
+        unsigned long long bytes = 0;       // byte letti dalla GPU
+    };
+
+    // ringSize: numero di PBO in volo; encoders: thread di codifica;
+    // maxInCoda: immagini in attesa di codifica oltre le quali si scarta (o si aspetta, vedi capture)
+    AsyncReadback(int ringSize = 3, int encoders = 2, int maxInCoda = 8)
+        : slots(ringSize), maxPending(maxInCoda)
+    {
+        for (Slot& s : slots)
+            glGenBuffers(1, &s.pbo);
+        for (int i = 0; i < encoders; ++i)
+            workers.emplace_back(&AsyncReadback::workerLoop, this);
+    }
+
+    ~AsyncReadback()
+    {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+        for (Slot& s : slots)
+        {
+            if (s.fence) glDeleteSync(s.fence);
+            glDeleteBuffers(1, &s.pbo);
+        }
+    }
+
+    // Accoda la lettura del color attachment 0 di fbo (0 = back buffer) verso path.
+    // Se i worker o la GPU sono in ritardo: con attendi=false il frame viene scartato (false), altrimenti si aspetta.
+    bool capture(unsigned int fbo, int width, int height, const std::string& path, bool attendi = false)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if ((int)queue.size() >= maxPending)
+            {
+                if (!attendi)
+                    return scarta(path, "codifica in ritardo");
+                cvDone.wait(lock, [this] { return (int)queue.size() < maxPending; });
+            }
+        }
+
+        Slot& slot = slots[next];
+        if (slot.fence)
+        {
+            // anello pieno: il PBO piu' vecchio deve essere consumato prima di riusarlo
+            if (!attendi && !collect(slot, false))
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return scarta(path, "anello PBO pieno");
+            }
+            if (slot.fence)
+            {
+                stats.attese++;
+                collect(slot, true);
+            }
+        }
+        avvisato = false;
+
+        size_t size = (size_t)width * height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (slot.capacity != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            slot.capacity = size;
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        if (fbo == 0)
+            glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.width = width;
+        slot.height = height;
+        slot.path = path;
+        next = (next + 1) % slots.size();
+
+        stats.catturati++;
+        stats.bytes += size;
+        return true;
+    }
+
+    // Raccoglie senza bloccare i PBO i cui fence sono gia' segnalati
+    void poll()
+    {
+        // in ordine di cattura, cosi' le immagini arrivano ai worker nello stesso ordine
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            Slot& slot = slots[(next + i) % slots.size()];
+            if (slot.fence && !collect(slot, false))
+                break;
+        }
+    }
+
+    // Attende tutte le letture in volo e la codifica di tutte le immagini accodate
+    void flush()
+    {
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            Slot& slot = slots[(next + i) % slots.size()];
+            if (slot.fence)
+                collect(slot, true);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cvDone.wait(lock, [this] { return queue.empty() && busy == 0; });
+    }
+
+    Stats getStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+private:
+    struct Slot {
+        unsigned int pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = 0;
+        int width = 0;
+        int height = 0;
+        std::string path;
+    };
+    struct Job {
+        std::vector<unsigned char> pixels; // RGBA, righe dal basso verso l'alto
+        int width;
+        int height;
+        std::string path;
+    };
+
+    std::vector<Slot> slots;
+    size_t next = 0;
+    int maxPending;
+
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable cv;      // nuovi job per i worker
+    std::condition_variable cvDone;  // job completati
+    int busy = 0;
+    bool stopping = false;
+    bool avvisato = false;           // avviso gia' stampato per la serie di frame scartati in corso
+    Stats stats;
+
+    // Conta un frame scartato (con mutex gia' preso); l'avviso si stampa una volta per serie di scarti
+    bool scarta(const std::string& path, const char* motivo)
+    {
+        stats.scartati++;
+        if (!avvisato)
+            std::cout << "ERROR::READBACK:: cattura scartata (" << motivo << "): " << path << std::endl;
+        avvisato = true;
+        return false;
+    }
+
+    // se il fence e' segnalato (o wait=true) copia il PBO e lo accoda ai worker
+    bool collect(Slot& slot, bool wait)
+    {
+        GLenum r = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+        while (wait && r == GL_TIMEOUT_EXPIRED)
+            r = glClientWaitSync(slot.fence, 0, 1000000000ull);
+        if (r == GL_TIMEOUT_EXPIRED || r == GL_WAIT_FAILED)
+            return false;
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        Job job;
+        job.width = slot.width;
+        job.height = slot.height;
+        job.path = slot.path;
+        job.pixels.resize((size_t)slot.width * slot.height * 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.pixels.size(), GL_MAP_READ_BIT);
+        if (ptr)
+        {
+            memcpy(job.pixels.data(), ptr, job.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!ptr)
+        {
+            std::cout << "ERROR::READBACK:: map del PBO fallito per " << slot.path << std::endl;
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.falliti++;
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(job));
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    void workerLoop()
+    {
+        std::vector<unsigned char> rgb;
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+                busy++;
+            }
+
+            // RGBA bottom-up -> RGB top-down
+            rgb.resize((size_t)job.width * job.height * 3);
+            for (int y = 0; y < job.height; ++y)
+            {
+                const unsigned char* src = &job.pixels[(size_t)(job.height - 1 - y) * job.width * 4];
+                unsigned char* dst = &rgb[(size_t)y * job.width * 3];
+                for (int x = 0; x < job.width; ++x)
+                {
+                    dst[x * 3 + 0] = src[x * 4 + 0];
+                    dst[x * 3 + 1] = src[x * 4 + 1];
+                    dst[x * 3 + 2] = src[x * 4 + 2];
+                }
+            }
+            bool ok = imageio::writeImage(job.path, job.width, job.height, 3, rgb.data());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+                if (ok)
+                    stats.scritti++;
+                else
+                    stats.falliti++;
+            }
+            cvDone.notify_all();
+        }
+    }
+};
+
+#endif
@@ -4,6 +4,9 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/vfs.h>
+
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -14,48 +17,30 @@ class Shader
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // defines (e.g. "#define FOO\n") is inserted after the #version line of every stage, to build permutations;
+    // if defines starts with its own #version line, that line replaces the one in the files
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* defines = nullptr)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        // read through the asset VFS: from the mounted pack if present, otherwise from disk
+        bool ok = vfs::readText(vertexPath, vertexCode) && vfs::readText(fragmentPath, fragmentCode);
+        // if geometry shader path is present, also load a geometry shader
+        if (ok && geometryPath != nullptr)
+            ok = vfs::readText(geometryPath, geometryCode);
+        if (!ok)
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << ", " << fragmentPath
+                      << (geometryPath ? std::string(", ") + geometryPath : std::string()) << std::endl;
         }
-        catch (std::ifstream::failure& e)
+        if (defines)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            addDefines(vertexCode, defines);
+            addDefines(fragmentCode, defines);
+            addDefines(geometryCode, defines);
         }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
@@ -162,6 +147,34 @@ public:
     }
 
 private:
+    // inserts defines right after the #version directive (which must stay the first statement),
+    // or in place of it when defines carries its own #version line
+    // ------------------------------------------------------------------------
+    static void addDefines(std::string& code, const char* defines)
+    {
+        if (code.empty())
+            return;
+        size_t pos = code.find("#version");
+        if (pos != std::string::npos && strncmp(defines, "#version", 8) == 0)
+        {
+            size_t end = code.find('\n', pos);
+            code.erase(pos, end == std::string::npos ? std::string::npos : end + 1 - pos);
+        }
+        else if (pos != std::string::npos)
+        {
+            pos = code.find('\n', pos);
+            if (pos == std::string::npos)
+            {
+                code += '\n';
+                pos = code.size() - 1;
+            }
+            pos++;
+        }
+        else
+            pos = 0;
+        code.insert(pos, defines);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,299 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Simulazione a passo fisso su un thread dedicato, separata dal rendering: a ogni tick (1 / hz secondi)
+// applica l'input raccolto dal thread principale alla camera (WASD, mouse, zoom), la vincola alle mura
+// della stanza e avanza il tempo di animazione, poi pubblica un'istantanea immutabile dello stato.
+// Le istantanee sono doppie (precedente + corrente, scambiate sotto un mutex tenuto solo per copiarle):
+// il thread di rendering interpola tra le due con alfa = (adesso - tempo della corrente) / passo, quindi
+// disegna lo stato con circa un tick di ritardo ma senza scatti, qualunque sia il frame rate.
+// Il costo per frame sul thread di rendering resta una copia e un'interpolazione anche se la simulazione cresce.
+// Se il thread resta indietro di piu' di MAX_RECUPERO tick (es. finestra trascinata, debugger) si riallinea
+// all'orologio invece di recuperare i tick persi, che vengono contati in Stats::saltati.
+// Senza tasti premuti, movimenti di mouse / scroll da applicare e animazioni in corso, dopo un tick che non ha
+// cambiato lo stato il thread si ferma su una variabile di condizione; l'input lo risveglia e il ciclo riparte
+// da quell'istante, senza contare la pausa come tick saltati.
+class Simulazione
+{
+public:
+    static const int MAX_RECUPERO = 5;
+
+    struct Istantanea {
+        unsigned long long tick = 0;
+        double tempo = 0.0;                 // secondi simulati, orologio dell'animazione
+        glm::vec3 posizione = glm::vec3(0.0f);
+        float yaw = YAW;
+        float pitch = PITCH;
+        float zoom = ZOOM;
+    };
+
+    struct Stats {
+        double hz = 0.0;
+        unsigned long long tick = 0;
+        unsigned long long saltati = 0;     // tick persi per ritardo del thread
+        double msTick = 0.0;                // costo medio di un tick
+        unsigned long long pause = 0;       // volte in cui il thread si e' fermato in attesa di input
+        bool inPausa = false;
+    };
+
+    // Input del thread principale: tasti tenuti premuti (stato) e movimento del mouse / scroll (accumulati
+    // tra due tick)
+    struct Input {
+        bool avanti = false, indietro = false, sinistra = false, destra = false;
+    };
+
+    ~Simulazione() { ferma(); }
+
+    // Avvia il thread partendo dallo stato della camera; minimo / massimo: mura della stanza
+    void avvia(const Camera& iniziale, glm::vec3 minimo, glm::vec3 massimo, double hz = 120.0)
+    {
+        ferma();
+        camera = iniziale;
+        limiteMin = minimo;
+        limiteMax = massimo;
+        passo = 1.0 / std::max(1.0, hz);
+        stats = Stats();
+        stats.hz = 1.0 / passo;
+        tempo = 0.0;
+        inizio = orologio::now();
+        precedente = corrente = interpolata = istantanea(0);
+        inEsecuzione = true;
+        thread = std::thread(&Simulazione::ciclo, this);
+    }
+
+    void ferma()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            inEsecuzione = false;
+        }
+        cvInput.notify_one();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    bool attiva() const { return thread.joinable(); }
+
+    void impostaInput(const Input& i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            input = i;
+        }
+        cvInput.notify_one();
+    }
+
+    void aggiungiMouse(float dx, float dy)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            mouseX += dx;
+            mouseY += dy;
+        }
+        cvInput.notify_one();
+    }
+
+    void aggiungiScroll(float dy)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            scroll += dy;
+        }
+        cvInput.notify_one();
+    }
+
+    // Numero di animazioni in corso: finche' e' maggiore di zero il thread non si ferma anche senza input
+    void impostaAnimazioni(int n)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            animazioni = n;
+        }
+        cvInput.notify_one();
+    }
+
+    // Stato interpolato all'istante attuale tra le ultime due istantanee
+    Istantanea interpola() const
+    {
+        std::lock_guard<std::mutex> lock(mutexIstantanee);
+        const Istantanea& a = precedente;
+        const Istantanea& b = corrente;
+        double adesso = std::chrono::duration<double>(orologio::now() - inizio).count();
+        float alfa = (float)std::min(1.0, std::max(0.0, (adesso - b.tempo) / passo));
+        Istantanea r = b;
+        r.tempo = a.tempo + (b.tempo - a.tempo) * alfa;
+        r.posizione = glm::mix(a.posizione, b.posizione, alfa);
+        r.yaw = a.yaw + (b.yaw - a.yaw) * alfa;
+        r.pitch = a.pitch + (b.pitch - a.pitch) * alfa;
+        r.zoom = a.zoom + (b.zoom - a.zoom) * alfa;
+        interpolata = r;
+        return r;
+    }
+
+    // true se c'e' input non ancora consumato o l'ultimo stato interpolato non e' ancora l'istantanea corrente:
+    // l'immagine sta ancora cambiando (usato dal ridisegno a eventi)
+    bool inMovimento() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            if (mouseX != 0.0f || mouseY != 0.0f || scroll != 0.0f)
+                return true;
+        }
+        std::lock_guard<std::mutex> lock(mutexIstantanee);
+        return !uguali(interpolata, corrente);
+    }
+
+    Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mutexIstantanee);
+        return stats;
+    }
+
+private:
+    typedef std::chrono::steady_clock orologio;
+
+    // stato del thread di simulazione
+    Camera camera;
+    glm::vec3 limiteMin = glm::vec3(0.0f), limiteMax = glm::vec3(0.0f);
+    double passo = 1.0 / 120.0;
+    double tempo = 0.0;
+    orologio::time_point inizio;
+    std::thread thread;
+    std::atomic<bool> inEsecuzione{ false };
+
+    // input, scritto dal thread principale
+    mutable std::mutex mutexInput;
+    std::condition_variable cvInput;
+    Input input;
+    float mouseX = 0.0f, mouseY = 0.0f, scroll = 0.0f;
+    int animazioni = 0;
+
+    // istantanee pubblicate
+    mutable std::mutex mutexIstantanee;
+    Istantanea precedente, corrente;
+    mutable Istantanea interpolata;         // ultimo stato restituito da interpola()
+    Stats stats;
+
+    void ciclo()
+    {
+        unsigned long long tick = 0;
+        auto prossimo = inizio;
+        const auto durataPasso = std::chrono::duration_cast<orologio::duration>(std::chrono::duration<double>(passo));
+        while (inEsecuzione)
+        {
+            prossimo += durataPasso;
+            auto adesso = orologio::now();
+            if (adesso - prossimo > durataPasso * (long long)MAX_RECUPERO)
+            {
+                // troppo indietro: i tick persi non si recuperano, il tempo simulato riparte dall'orologio
+                unsigned long long persi = (unsigned long long)((adesso - prossimo) / durataPasso);
+                prossimo += durataPasso * (long long)persi;
+                tick += persi;
+                std::lock_guard<std::mutex> lock(mutexIstantanee);
+                stats.saltati += persi;
+            }
+            std::this_thread::sleep_until(prossimo);
+
+            auto t0 = orologio::now();
+            passoSimulazione();
+            tick++;
+            // il tempo dell'istantanea e' quello programmato del tick, non quello in cui il thread si e' svegliato
+            tempo = std::chrono::duration<double>(prossimo - inizio).count();
+            Istantanea nuova = istantanea(tick);
+            double ms = std::chrono::duration<double, std::milli>(orologio::now() - t0).count();
+
+            bool fermo;
+            {
+                std::lock_guard<std::mutex> lock(mutexIstantanee);
+                fermo = uguali(corrente, nuova);
+                precedente = corrente;
+                corrente = nuova;
+                stats.tick = tick;
+                stats.msTick = stats.msTick == 0.0 ? ms : stats.msTick + 0.05 * (ms - stats.msTick);
+            }
+            if (fermo && attendiInput())
+                prossimo = orologio::now();   // la pausa non conta come tick da recuperare
+        }
+    }
+
+    bool inattivo() const
+    {
+        return !input.avanti && !input.indietro && !input.sinistra && !input.destra
+            && mouseX == 0.0f && mouseY == 0.0f && scroll == 0.0f && animazioni == 0;
+    }
+
+    // Si ferma finche' non arriva input (o ferma()); false se non c'era motivo di fermarsi
+    bool attendiInput()
+    {
+        std::unique_lock<std::mutex> lock(mutexInput);
+        if (!inEsecuzione || !inattivo())
+            return false;
+        {
+            std::lock_guard<std::mutex> lockStats(mutexIstantanee);
+            stats.pause++;
+            stats.inPausa = true;
+        }
+        cvInput.wait(lock, [this] { return !inEsecuzione || !inattivo(); });
+        std::lock_guard<std::mutex> lockStats(mutexIstantanee);
+        stats.inPausa = false;
+        return true;
+    }
+
+    static bool uguali(const Istantanea& a, const Istantanea& b)
+    {
+        return a.posizione == b.posizione && a.yaw == b.yaw && a.pitch == b.pitch && a.zoom == b.zoom;
+    }
+
+    void passoSimulazione()
+    {
+        Input i;
+        float dx, dy, dz;
+        {
+            std::lock_guard<std::mutex> lock(mutexInput);
+            i = input;
+            dx = mouseX;
+            dy = mouseY;
+            dz = scroll;
+            mouseX = mouseY = scroll = 0.0f;
+        }
+        float dt = (float)passo;
+        if (i.avanti)
+            camera.ProcessKeyboard(FORWARD, dt);
+        if (i.indietro)
+            camera.ProcessKeyboard(BACKWARD, dt);
+        if (i.sinistra)
+            camera.ProcessKeyboard(LEFT, dt);
+        if (i.destra)
+            camera.ProcessKeyboard(RIGHT, dt);
+        if (dx != 0.0f || dy != 0.0f)
+            camera.ProcessMouseMovement(dx, dy);
+        if (dz != 0.0f)
+            camera.ProcessMouseScroll(dz);
+        camera.Position = glm::clamp(camera.Position, limiteMin, limiteMax);
+    }
+
+    Istantanea istantanea(unsigned long long tick) const
+    {
+        Istantanea s;
+        s.tick = tick;
+        s.tempo = tempo;
+        s.posizione = camera.Position;
+        s.yaw = camera.Yaw;
+        s.pitch = camera.Pitch;
+        s.zoom = camera.Zoom;
+        return s;
+    }
+};
+
+#endif
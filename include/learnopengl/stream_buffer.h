@@ -0,0 +1,184 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// Costanti e funzioni di GL 4.4 / ARB_buffer_storage assenti da glad (generato fino a 4.2)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNBUFFERSTORAGE)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// Buffer circolare per i dati che cambiano a ogni frame (matrici per oggetto e simili): FRAME_IN_VOLO
+// segmenti, uno per frame. Ogni scrittura e' una memcpy nella memoria mappata e restituisce l'offset da
+// legare (glBindBufferRange); a fine frame un fence protegge il segmento, che viene riusato FRAME_IN_VOLO
+// frame dopo aspettando il fence solo se la GPU e' ancora indietro.
+// - con glBufferStorage (GL 4.4 o ARB_buffer_storage) il buffer resta mappato per sempre
+//   (MAP_PERSISTENT | MAP_COHERENT): nessuna chiamata GL per scrittura
+// - altrimenti ogni scrittura mappa il suo intervallo con MAP_UNSYNCHRONIZED: la sincronizzazione
+//   la danno gli stessi fence
+// Se un frame supera il segmento il buffer viene sostituito da uno grande il doppio: le scritture
+// gia' fatte restano nel vecchio buffer, che il driver libera quando la GPU ha finito di leggerlo.
+class BufferCircolare
+{
+public:
+    static const int FRAME_IN_VOLO = 3;
+
+    struct Stats {
+        bool persistente = false;
+        size_t bytesSegmento = 0;             // capacita' di un frame
+        size_t bytesFrame = 0;                // scritti nell'ultimo frame completato
+        unsigned long long attese = 0;        // frame iniziati aspettando un fence non ancora segnalato
+        double msAttesa = 0.0;                // tempo totale passato ad aspettare
+        int ricrescite = 0;
+    };
+
+    // allineamento: offset minimo tra due scritture (es. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+    bool init(GLADloadproc carica, size_t bytesPerFrame, size_t allineamento)
+    {
+        this->allineamento = std::max<size_t>(allineamento, 16);
+        if (GLVersion.major * 10 + GLVersion.minor >= 44 || estensione("GL_ARB_buffer_storage"))
+            glBufferStorage_ = (PFNBUFFERSTORAGE)carica("glBufferStorage");
+        stats.persistente = glBufferStorage_ != nullptr;
+        crea(bytesPerFrame);
+        return true;
+    }
+
+    unsigned int buffer() const { return id; }
+    Stats getStats() const { return stats; }
+
+    // Passa al segmento successivo, aspettando che la GPU abbia finito il frame che lo usava
+    void iniziaFrame()
+    {
+        segmento = (segmento + 1) % FRAME_IN_VOLO;
+        GLsync& f = fence[segmento];
+        if (f)
+        {
+            if (glClientWaitSync(f, 0, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                auto inizio = std::chrono::high_resolution_clock::now();
+                while (glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                    ;
+                stats.attese++;
+                stats.msAttesa += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inizio).count();
+            }
+            glDeleteSync(f);
+            f = 0;
+        }
+        testa = segmento * stats.bytesSegmento;
+        scrittiFrame = 0;
+    }
+
+    // Protegge con un fence le scritture del frame
+    void fineFrame()
+    {
+        if (fence[segmento])
+            glDeleteSync(fence[segmento]);
+        fence[segmento] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stats.bytesFrame = scrittiFrame;
+    }
+
+    // Copia bytes nel segmento del frame; restituisce l'offset nel buffer()
+    size_t scrivi(const void* dati, size_t bytes)
+    {
+        size_t offset = (testa + allineamento - 1) / allineamento * allineamento;
+        if (offset + bytes > (segmento + 1) * stats.bytesSegmento)
+        {
+            crea(std::max(stats.bytesSegmento * 2, bytes + allineamento));
+            stats.ricrescite++;
+            offset = 0;
+        }
+        if (mappa)
+            memcpy(mappa + offset, dati, bytes);
+        else
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+            void* p = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if (p)
+            {
+                memcpy(p, dati, bytes);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            }
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        testa = offset + bytes;
+        scrittiFrame += bytes;
+        return offset;
+    }
+
+private:
+    PFNBUFFERSTORAGE glBufferStorage_ = nullptr;
+    unsigned int id = 0;
+    unsigned char* mappa = nullptr;
+    size_t allineamento = 256;
+    size_t testa = 0, scrittiFrame = 0;
+    int segmento = 0;
+    GLsync fence[FRAME_IN_VOLO] = {};
+    Stats stats;
+
+    static bool estensione(const char* nome)
+    {
+        GLint n = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for (GLint i = 0; i < n; ++i)
+        {
+            const char* e = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (e && strcmp(e, nome) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // (Ri)crea il buffer con segmenti da bytesPerFrame; i fence del buffer precedente non servono piu'
+    void crea(size_t bytesPerFrame)
+    {
+        bytesPerFrame = (bytesPerFrame + allineamento - 1) / allineamento * allineamento;
+        if (id)
+        {
+            // eliminare un buffer mappato lo smappa; la GPU puo' ancora leggere i comandi gia' inviati
+            glDeleteBuffers(1, &id);
+            mappa = nullptr;
+        }
+        for (GLsync& f : fence)
+            if (f)
+            {
+                glDeleteSync(f);
+                f = 0;
+            }
+        size_t bytes = bytesPerFrame * FRAME_IN_VOLO;
+        glGenBuffers(1, &id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        if (glBufferStorage_)
+        {
+            GLbitfield flag = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage_(GL_COPY_WRITE_BUFFER, bytes, NULL, flag);
+            mappa = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, flag);
+            if (!mappa)
+            {
+                std::cout << "ERROR::STREAM_BUFFER:: mappatura persistente fallita, uso la mappatura per scrittura" << std::endl;
+                glBufferStorage_ = nullptr;
+                stats.persistente = false;
+                glDeleteBuffers(1, &id);
+                glGenBuffers(1, &id);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+            }
+        }
+        if (!mappa)
+            glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        stats.bytesSegmento = bytesPerFrame;
+        segmento = 0;
+        testa = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,585 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/dds.h>
+#include <learnopengl/gloss_pack.h>
+#include <learnopengl/mipmap.h>
+#include <learnopengl/vfs.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <unordered_map>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Streaming progressivo delle texture: request() crea subito la texture e rende visibili solo i livelli
+// di mipmap piu' piccoli; i livelli maggiori vengono decodificati in background e caricati con PBO a blocchi
+// di righe entro un budget di byte per frame. GL_TEXTURE_BASE_LEVEL scende man mano che i livelli arrivano.
+// Con un DDS cotto (tools/texcook) la coda della catena viene letta e caricata subito dal file;
+// per JPG/PNG la texture parte da un livello 1x1 neutro finche' la decodifica non e' pronta.
+//
+// Con il feedback attivo (setFeedback) ogni texture scende solo fino al livello richiesto nel frame
+// precedente con richiedi() (stima della densita' UV su schermo, vedi mip_feedback.h); i livelli non piu'
+// richiesti vengono rilasciati dopo FRAME_RILASCIO frame. Per poter restituire memoria i livelli sono
+// specificati uno per uno (storage mutabile, non glTexStorage2D): un livello rilasciato viene ridefinito 0x0,
+// cosi' il nome GL della texture resta lo stesso e chi la usa non deve rimappare l'handle.
+// Tutti i metodi vanno chiamati dal thread GL.
+class TextureStreamer
+{
+public:
+    struct Stats {
+        int inStreaming = 0;                  // texture non ancora al livello obiettivo
+        size_t bytesResidenti = 0;            // memoria video dei livelli allocati
+        unsigned long long richieste = 0;
+        unsigned long long livelliCaricati = 0;
+        unsigned long long livelliRilasciati = 0;
+        unsigned long long bytesCaricati = 0;
+    };
+
+    // Livelli visibili di una texture (vedi stato())
+    struct Stato {
+        int width = 0, height = 0, livelli = 1;
+        int base = 0;                         // primo livello definito (GL_TEXTURE_BASE_LEVEL)
+        GLenum internalFormat = GL_RGBA8;
+        unsigned long long versione = 0;      // cambia quando cambiano i livelli visibili o il loro contenuto
+    };
+
+    // decoders: thread di decodifica; bytesPerFrame: byte massimi caricati per update();
+    // pboRing: PBO in volo (ognuno grande al massimo bytesPerFrame / 2)
+    TextureStreamer(int decoders = 2, size_t bytesPerFrame = 8 * 1024 * 1024, int pboRing = 3)
+        : budgetFrame(bytesPerFrame), pbo(pboRing)
+    {
+        chunk = std::max<size_t>(budgetFrame / 2, 64 * 1024);
+        for (Pbo& p : pbo)
+            glGenBuffers(1, &p.buffer);
+        for (int i = 0; i < decoders; ++i)
+            workers.emplace_back(&TextureStreamer::workerLoop, this);
+    }
+
+    ~TextureStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+        for (Pbo& p : pbo)
+        {
+            if (p.fence) glDeleteSync(p.fence);
+            glDeleteBuffers(1, &p.buffer);
+        }
+        for (Streamed* s : attive)
+            delete s;
+    }
+
+    // Crea la texture e ne avvia lo streaming; stessi parametri di wrap/filtro di loadTexture().
+    // Con glossPath la gloss map viene impacchettata nell'alpha a ogni livello (vedi gloss_pack.h).
+    unsigned int request(const std::string& path, bool clampIfAlpha = false, const std::string& glossPath = "")
+    {
+        stats.richieste++;
+        Streamed* s = new Streamed();
+        s->path = path;
+        s->glossPath = glossPath;
+        s->tipo = mipmap::tipoDaNome(path);
+        glGenTextures(1, &s->id);
+        glBindTexture(GL_TEXTURE_2D, s->id);
+
+        dds::Image tail, tailGloss;
+        std::string cotto = dds::cookedPath(path);
+        bool gloss = !glossPath.empty();
+        bool alpha;
+        if (dds::readLevels(cotto, 0, 0, tail, &s->ddsBlob)
+            && (!gloss || (dds::readLevels(dds::cookedPath(glossPath), 0, 0, tailGloss, &s->glossBlob)
+                           && glosspack::compatibili(tail, tailGloss))))
+        {
+            s->compressa = true;
+            s->ddsPath = cotto;
+            if (gloss)
+                s->glossDdsPath = dds::cookedPath(glossPath);
+            s->width = tail.width;
+            s->height = tail.height;
+            s->livelli = (int)tail.levels.size();
+            // coda: i livelli fino a TAIL_DIM pixel, letti e caricati subito
+            s->coda = 0;
+            while (s->coda < s->livelli - 1 && std::max(levelW(*s, s->coda), levelH(*s, s->coda)) > TAIL_DIM)
+                s->coda++;
+            if (!readDds(*s, s->coda, s->livelli, tail))
+                return abort(s);
+            // con la gloss impacchettata il formato e' BC3 anche se la diffuse cotta e' BC1
+            s->internalFormat = dds::glFormat(tail.format);
+            s->ddsFormat = tail.format;
+            for (int l = s->coda; l < s->livelli; ++l)
+                glCompressedTexImage2D(GL_TEXTURE_2D, l, s->internalFormat, levelW(*s, l), levelH(*s, l), 0,
+                    (GLsizei)tail.levels[l].size(), tail.levels[l].data());
+            alpha = !gloss && tail.format == dds::BC3;
+        }
+        else
+        {
+            // DDS non utilizzabili (es. gloss incompatibile): non serve tenerli in memoria
+            s->ddsBlob.reset();
+            s->glossBlob.reset();
+            int components;
+            if (!vfs::imageInfo(path, &s->width, &s->height, &components))
+            {
+                std::cout << "Texture failed to load at path: " << path << std::endl;
+                return abort(s);
+            }
+            // RGB resta a 3 canali: si passa a 4 solo per impacchettare la gloss nell'alpha
+            s->canali = gloss ? 4 : (components == 1 || components == 3 ? components : 4);
+            s->internalFormat = s->canali == 1 ? GL_R8 : (s->canali == 3 ? GL_RGB8 : GL_RGBA8);
+            s->livelli = 1;
+            while ((s->width >> s->livelli) > 0 || (s->height >> s->livelli) > 0)
+                s->livelli++;
+            // livello 1x1 provvisorio: grigio medio, o normale piatta per le normal map
+            s->coda = s->livelli - 1;
+            s->provvisoria = true;
+            std::string nome = path;
+            std::transform(nome.begin(), nome.end(), nome.begin(), ::tolower);
+            bool normale = nome.find("norm") != std::string::npos;
+            unsigned char neutro[4] = { 128, 128, (unsigned char)(normale ? 255 : 128), (unsigned char)(gloss ? 128 : 255) };
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, s->coda, s->internalFormat, 1, 1, 0, pixelFormat(*s), GL_UNSIGNED_BYTE, neutro);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            alpha = components == 4 && !gloss;
+        }
+        s->base = s->coda;
+        s->obiettivo = feedback ? s->coda : 0;
+        s->ultimoBisognoFine = frame;
+        s->dati.resize(s->livelli);
+
+        bool clamp = clampIfAlpha && alpha;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, s->base);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, s->livelli - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        attive.push_back(s);
+        perId[s->id] = s;
+        return s->id;
+    }
+
+    // Attiva/disattiva lo streaming guidato da richiedi(); senza feedback ogni texture arriva al livello 0
+    void setFeedback(bool attivo)
+    {
+        feedback = attivo;
+        for (Streamed* s : attive)
+            s->ultimoBisognoFine = frame;
+    }
+
+    // Feedback del frame corrente: la texture id e' campionata con un'impronta di uvPerPixel unita' UV
+    // per pixel dello schermo. Il livello necessario e' log2(dimensione * uvPerPixel); vale il minimo del frame.
+    void richiedi(unsigned int id, float uvPerPixel)
+    {
+        std::unordered_map<unsigned int, Streamed*>::iterator it = perId.find(id);
+        if (it == perId.end())
+            return;
+        Streamed* s = it->second;
+        float texel = uvPerPixel * std::max(s->width, s->height);
+        int livello = texel > 1.0f ? (int)std::floor(std::log2(texel)) : 0;
+        s->richiesta = std::min(s->richiesta, std::min(livello, s->coda));
+    }
+
+    // Aggiorna gli obiettivi, rilascia i livelli non piu' necessari e carica quelli decodificati
+    // entro il budget del frame (una volta per frame, prima del rendering)
+    void update()
+    {
+        frame++;
+        size_t budget = budgetFrame;
+        bool ringPieno = false;
+        for (Streamed* s : attive)
+        {
+            aggiornaObiettivo(*s);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (s->inDecodifica)
+                    continue;
+            }
+            glBindTexture(GL_TEXTURE_2D, s->id);
+            if (s->obiettivo > s->base || (s->righeCaricate > 0 && s->obiettivo >= s->base))
+                rilascia(*s, s->obiettivo);
+            if (s->provvisoria && !s->dati[s->coda].empty())
+            {
+                // la coda vera sostituisce il livello 1x1 neutro
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexSubImage2D(GL_TEXTURE_2D, s->coda, 0, 0, 1, 1, pixelFormat(*s), GL_UNSIGNED_BYTE, s->dati[s->coda].data());
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                std::vector<unsigned char>().swap(s->dati[s->coda]);
+                s->provvisoria = false;
+                s->versione++;
+            }
+            if (s->fallita)
+                continue;
+            bool servonoDati = s->obiettivo < s->base && s->dati[s->base - 1].empty();
+            if (servonoDati || s->provvisoria)
+            {
+                accoda(*s);
+                continue;
+            }
+            if (s->obiettivo < s->base && !ringPieno && budget > 0)
+                ringPieno = !uploadSome(*s, budget);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Attende che tutte le texture abbiano raggiunto il livello obiettivo
+    void finish()
+    {
+        for (;;)
+        {
+            update();
+            bool finito = true;
+            for (Streamed* s : attive)
+                finito = finito && (s->fallita || (s->base <= s->obiettivo && !s->provvisoria));
+            if (finito)
+                return;
+            glFlush(); // i fence dei PBO si segnalano solo dopo il flush dei comandi
+            std::this_thread::yield();
+        }
+    }
+
+    Stats getStats()
+    {
+        Stats st = stats;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Streamed* s : attive)
+        {
+            if (!s->fallita && (s->base > s->obiettivo || s->inDecodifica))
+                st.inStreaming++;
+            for (int l = s->base; l < s->livelli; ++l)
+                st.bytesResidenti += levelBytes(*s, l);
+            if (s->righeCaricate > 0)
+                st.bytesResidenti += levelBytes(*s, s->base - 1);
+        }
+        return st;
+    }
+
+    // Formato e livelli visibili di una texture creata da request(); false se non e' gestita dallo streamer.
+    // Chi copia la texture altrove (material_table.h) confronta la versione.
+    bool stato(unsigned int id, Stato& st) const
+    {
+        std::unordered_map<unsigned int, Streamed*>::const_iterator it = perId.find(id);
+        if (it == perId.end())
+            return false;
+        const Streamed& s = *it->second;
+        st.width = s.width;
+        st.height = s.height;
+        st.livelli = s.livelli;
+        st.base = s.base;
+        st.internalFormat = s.internalFormat;
+        st.versione = s.versione;
+        return true;
+    }
+
+private:
+    static const int TAIL_DIM = 64;
+    static const int FRAME_RILASCIO = 120;   // frame senza richieste prima di rilasciare i livelli fini
+
+    struct Streamed {
+        unsigned int id = 0;
+        std::string path;
+        std::string ddsPath;
+        std::string glossPath;   // gloss da impacchettare nell'alpha (vuoto se nessuna)
+        std::string glossDdsPath;
+        bool compressa = false;
+        dds::Format ddsFormat = dds::BC1;
+        GLenum internalFormat = GL_RGBA8;
+        int canali = 4;
+        mipmap::Tipo tipo = mipmap::Colore;   // filtro delle mipmap costruite su CPU
+        int width = 0;
+        int height = 0;
+        int livelli = 1;
+        int coda = 0;            // primo livello della coda, sempre residente
+        bool provvisoria = false; // la coda e' ancora il livello 1x1 neutro
+        int base = 0;            // livello piu' grande gia' visibile
+        int obiettivo = 0;       // livello da raggiungere (o a cui tornare rilasciando)
+        int righeCaricate = 0;   // righe (o righe di blocchi 4x4) gia' caricate del livello base - 1
+        int richiesta = INT_MAX; // minimo livello richiesto da richiedi() dall'ultimo update()
+        unsigned long long versione = 0;
+        unsigned long long ultimoBisognoFine = 0;
+        bool fallita = false;
+        // stato della decodifica (protetto da mutex mentre inDecodifica e' true)
+        bool inDecodifica = false;
+        int decDa = 0, decA = 0;
+        std::vector<std::vector<unsigned char>> dati; // dati CPU per livello, liberati dopo l'upload
+        // DDS cotti gia' in memoria (pacchetto o lettura anticipata), aperti e decompressi una sola volta;
+        // li usa solo chi decodifica la texture (request, poi un decoder alla volta)
+        mutable std::shared_ptr<vfs::File> ddsBlob, glossBlob;
+    };
+    struct Pbo {
+        unsigned int buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = 0;
+    };
+
+    size_t budgetFrame;
+    size_t chunk;
+    std::vector<Pbo> pbo;
+    size_t nextPbo = 0;
+    std::vector<Streamed*> attive;
+    std::unordered_map<unsigned int, Streamed*> perId;
+    bool feedback = false;
+    unsigned long long frame = 0;
+    Stats stats;
+
+    std::vector<std::thread> workers;
+    std::deque<Streamed*> richieste;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    static int levelW(const Streamed& s, int l) { return std::max(1, s.width >> l); }
+    static int levelH(const Streamed& s, int l) { return std::max(1, s.height >> l); }
+    static GLenum pixelFormat(const Streamed& s) { return s.canali == 1 ? GL_RED : (s.canali == 3 ? GL_RGB : GL_RGBA); }
+    static size_t levelBytes(const Streamed& s, int l)
+    {
+        if (s.compressa)
+            return dds::levelSize(s.ddsFormat, levelW(s, l), levelH(s, l));
+        return (size_t)levelW(s, l) * levelH(s, l) * s.canali;
+    }
+
+    unsigned int abort(Streamed* s)
+    {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        unsigned int id = s->id;
+        delete s;
+        return id;
+    }
+
+    void aggiornaObiettivo(Streamed& s)
+    {
+        int richiesta = s.richiesta;
+        s.richiesta = INT_MAX;
+        if (!feedback)
+        {
+            s.obiettivo = 0;
+            return;
+        }
+        if (richiesta <= s.obiettivo)
+        {
+            // servono livelli piu' fini: subito
+            s.obiettivo = richiesta;
+            s.ultimoBisognoFine = frame;
+        }
+        else if (frame - s.ultimoBisognoFine > FRAME_RILASCIO)
+        {
+            // piu' grossolani (o texture non visibile): solo dopo un po', per non oscillare
+            s.obiettivo = richiesta == INT_MAX ? s.coda : richiesta;
+        }
+    }
+
+    // Rilascia i livelli sotto nuovaBase (ridefiniti 0x0) e l'eventuale livello caricato a meta'
+    void rilascia(Streamed& s, int nuovaBase)
+    {
+        int primo = s.righeCaricate > 0 ? s.base - 1 : s.base;
+        for (int l = primo; l < nuovaBase; ++l)
+        {
+            glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            if (l >= s.base)
+                stats.livelliRilasciati++;
+        }
+        for (int l = 0; l < nuovaBase; ++l)
+            std::vector<unsigned char>().swap(s.dati[l]);
+        s.righeCaricate = 0;
+        s.base = std::max(s.base, nuovaBase);
+        s.versione++;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, s.base);
+    }
+
+    // Chiede ai worker i livelli [obiettivo, base) (piu' la coda se e' ancora provvisoria)
+    void accoda(Streamed& s)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            s.inDecodifica = true;
+            s.decDa = std::min(s.obiettivo, s.base);
+            s.decA = s.base;
+            richieste.push_back(&s);
+        }
+        cv.notify_one();
+    }
+
+    // Carica blocchi di righe dei livelli decodificati sotto base finche' c'e' budget.
+    // Ritorna false se nessun PBO e' libero.
+    bool uploadSome(Streamed& s, size_t& budget)
+    {
+        while (s.base > s.obiettivo && budget > 0 && !s.dati[s.base - 1].empty())
+        {
+            int l = s.base - 1;
+            const std::vector<unsigned char>& dati = s.dati[l];
+            int w = levelW(s, l), h = levelH(s, l);
+            // righe di pixel, o righe di blocchi 4x4 per i formati compressi
+            int righe = s.compressa ? (h + 3) / 4 : h;
+            size_t bytesRiga = dati.size() / righe;
+            int n = (int)std::min<size_t>(righe - s.righeCaricate, std::max<size_t>(1, std::min(budget, chunk) / bytesRiga));
+            size_t bytes = n * bytesRiga;
+
+            Pbo& p = pbo[nextPbo];
+            if (p.fence)
+            {
+                GLenum r = glClientWaitSync(p.fence, 0, 0);
+                if (r == GL_TIMEOUT_EXPIRED)
+                    return false;
+                glDeleteSync(p.fence);
+                p.fence = 0;
+            }
+            if (s.righeCaricate == 0)
+            {
+                // primo blocco: alloca il livello
+                if (s.compressa)
+                    glCompressedTexImage2D(GL_TEXTURE_2D, l, s.internalFormat, w, h, 0, (GLsizei)dati.size(), NULL);
+                else
+                    glTexImage2D(GL_TEXTURE_2D, l, s.internalFormat, w, h, 0, pixelFormat(s), GL_UNSIGNED_BYTE, NULL);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, p.buffer);
+            size_t capacita = std::max(bytes, chunk);
+            if (p.capacity < capacita)
+                p.capacity = capacita;
+            // orphaning: il driver non deve aspettare l'upload precedente che usava lo stesso buffer
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, p.capacity, NULL, GL_STREAM_DRAW);
+            void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (!ptr)
+            {
+                std::cout << "ERROR::STREAMER:: map del PBO fallito per " << s.path << std::endl;
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                return false;
+            }
+            memcpy(ptr, dati.data() + s.righeCaricate * bytesRiga, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            if (s.compressa)
+            {
+                int y = s.righeCaricate * 4;
+                int altezza = std::min(n * 4, h - y);
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, l, 0, y, w, altezza, s.internalFormat, (GLsizei)bytes, 0);
+            }
+            else
+            {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexSubImage2D(GL_TEXTURE_2D, l, 0, s.righeCaricate, w, n, pixelFormat(s), GL_UNSIGNED_BYTE, 0);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            nextPbo = (nextPbo + 1) % pbo.size();
+
+            s.righeCaricate += n;
+            budget -= std::min(budget, bytes);
+            stats.bytesCaricati += bytes;
+            if (s.righeCaricate == righe)
+            {
+                // livello completo: diventa visibile
+                s.base = l;
+                s.righeCaricate = 0;
+                std::vector<unsigned char>().swap(s.dati[l]);
+                s.versione++;
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, s.base);
+                stats.livelliCaricati++;
+            }
+        }
+        return true;
+    }
+
+    // Legge i livelli [da, a) del DDS cotto, con la gloss impacchettata se richiesta
+    static bool readDds(const Streamed& s, int da, int a, dds::Image& img)
+    {
+        if (!dds::readLevels(s.ddsPath, da, a, img, &s.ddsBlob))
+        {
+            std::cout << "ERROR::STREAMER:: lettura fallita: " << s.ddsPath << std::endl;
+            return false;
+        }
+        if (s.glossDdsPath.empty())
+            return true;
+        dds::Image gloss;
+        if (!dds::readLevels(s.glossDdsPath, da, a, gloss, &s.glossBlob) || !glosspack::packBlocks(img, gloss))
+        {
+            std::cout << "ERROR::STREAMER:: gloss non impacchettabile: " << s.glossDdsPath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Decodifica i livelli [da, a) di una texture (e la coda se provvisoria); ritorna false se fallisce
+    bool decode(const Streamed& s, int da, int a, bool coda, std::vector<std::vector<unsigned char>>& out)
+    {
+        out.assign(s.livelli, std::vector<unsigned char>());
+        if (s.compressa)
+        {
+            dds::Image img;
+            if (!readDds(s, da, a, img))
+                return false;
+            for (int l = da; l < a; ++l)
+                out[l].swap(img.levels[l]);
+            return true;
+        }
+
+        int w, h, n;
+        unsigned char* data = vfs::loadImage(s.path, &w, &h, &n, s.canali);
+        if (!data)
+        {
+            std::cout << "Texture failed to load at path: " << s.path << std::endl;
+            return false;
+        }
+        if (!s.glossPath.empty())
+            glosspack::packPixels(data, w, h, s.glossPath);
+        // la catena si costruisce sempre da 0; si tengono solo i livelli richiesti
+        int ultimo = coda ? s.coda : a - 1;
+        std::vector<unsigned char> livello(data, data + (size_t)w * h * s.canali);
+        stbi_image_free(data);
+        for (int l = 0; l <= ultimo; ++l)
+        {
+            if (l > 0)
+                livello = mipmap::halve(livello.data(), levelW(s, l - 1), levelH(s, l - 1), s.canali, s.tipo);
+            if ((l >= da && l < a) || (coda && l == s.coda))
+                out[l] = livello;
+        }
+        return true;
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            Streamed* s;
+            int da, a;
+            bool coda;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !richieste.empty(); });
+                if (stopping)
+                    return;
+                s = richieste.front();
+                richieste.pop_front();
+                da = s->decDa;
+                a = s->decA;
+                coda = s->provvisoria;
+            }
+            std::vector<std::vector<unsigned char>> dati;
+            bool ok = decode(*s, da, a, coda, dati);
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t l = 0; l < dati.size(); ++l)
+                if (!dati[l].empty())
+                    s->dati[l].swap(dati[l]);
+            // se la decodifica fallisce la texture resta ai livelli gia' caricati
+            s->fallita = !ok;
+            s->inDecodifica = false;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,368 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Grafo di lavori con dipendenze, eseguito da ThreadPool::esegui. Un nodo parte quando tutti i nodi da cui
+// dipende sono completati; le dipendenze devono essere nodi aggiunti prima (il grafo e' aciclico per
+// costruzione e, senza worker, si esegue nell'ordine di inserimento). Lo stesso grafo si puo' rieseguire
+// a ogni frame: i contatori si ripristinano all'avvio.
+class GrafoLavori
+{
+public:
+    int aggiungi(std::function<void()> fn, std::initializer_list<int> dipendenze = {})
+    {
+        int indice = (int)nodi.size();
+        nodi.emplace_back();
+        Nodo& n = nodi.back();
+        n.fn = std::move(fn);
+        for (int d : dipendenze)
+        {
+            if (d < 0 || d >= indice)
+            {
+                std::cout << "ERROR::GRAFO_LAVORI:: dipendenza " << d << " non valida per il nodo " << indice << std::endl;
+                continue;
+            }
+            nodi[d].successori.push_back(indice);
+            n.dipendenze++;
+        }
+        return indice;
+    }
+
+    int size() const { return (int)nodi.size(); }
+
+private:
+    friend class ThreadPool;
+
+    struct Nodo {
+        std::function<void()> fn;
+        std::vector<int> successori;
+        int dipendenze = 0;
+        std::atomic<int> mancanti{ 0 };
+    };
+
+    std::deque<Nodo> nodi;      // deque: i nodi (con atomic) non si spostano quando se ne aggiungono altri
+};
+
+// Pool di thread condiviso per i lavori paralleli su CPU (mipmap, decodifiche, lavori per frame), con
+// work stealing:
+// - ogni worker ha la propria coda: vi accoda i lavori che genera e li riprende dal fondo (LIFO, dati ancora
+//   in cache); i thread esterni al pool (thread principale, decoder) usano una coda condivisa
+// - un thread senza lavoro ruba dalla testa delle code degli altri (FIFO, i blocchi piu' grandi e piu' vecchi)
+// - i worker senza niente da rubare dormono su una condition variable, svegliati solo se qualcuno dorme
+// parallelFor(n, fn) divide gli indici in blocchi ed esegue fn(0..n-1) sui worker e sul thread chiamante;
+// esegui(grafo) esegue un GrafoLavori rispettando le dipendenze. Entrambi ritornano a lavoro completato.
+// Chi aspetta esegue solo lavori del proprio gruppo (parallelFor o grafo): le chiamate annidate e quelle
+// concorrenti da piu' thread non vanno in stallo, e un chiamante che tiene un lock non esegue lavori altrui
+// che potrebbero chiederlo.
+// getStats() riporta lavori eseguiti, furti e tempo di inattivita' dei worker dall'ultimo azzeraStats().
+class ThreadPool
+{
+public:
+    struct Stats {
+        int thread = 0;                     // worker + thread chiamante
+        unsigned long long lavori = 0;      // blocchi e nodi eseguiti
+        unsigned long long furti = 0;       // lavori presi dalla coda di un altro thread
+        double msInattivo = 0.0;            // somma sui worker del tempo passato ad aspettare lavoro
+        double percentualeInattivo = 0.0;   // msInattivo rispetto al tempo trascorso * numero di worker
+    };
+
+    explicit ThreadPool(unsigned int threads = std::max(1u, std::thread::hardware_concurrency()) - 1)
+    {
+        // una coda per worker piu' quella condivisa dei thread esterni (l'ultima)
+        for (unsigned int i = 0; i <= threads; ++i)
+            code.emplace_back(new Coda());
+        inizioStats = orologio::now();
+        for (unsigned int i = 0; i < threads; ++i)
+            workers.emplace_back(&ThreadPool::workerLoop, this, (int)i);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutexSonno);
+            stopping = true;
+        }
+        cvSonno.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+    }
+
+    // Pool globale, creato al primo utilizzo
+    static ThreadPool& shared()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    int size() const { return (int)workers.size() + 1; }
+
+    // fn(i) per i in [0, count); grana = indici per blocco (0: circa quattro blocchi per thread)
+    void parallelFor(int count, const std::function<void(int)>& fn, int grana = 0)
+    {
+        if (count <= 0)
+            return;
+        if (grana <= 0)
+            grana = std::max(1, count / (size() * 4));
+        if (count <= grana || workers.empty())
+        {
+            for (int i = 0; i < count; ++i)
+                fn(i);
+            return;
+        }
+        int blocchi = (count + grana - 1) / grana;
+        Gruppo gruppo(blocchi);
+        for (int b = 0; b < blocchi; ++b)
+        {
+            int inizio = b * grana, fine = std::min(count, inizio + grana);
+            accoda([&fn, inizio, fine]() {
+                for (int i = inizio; i < fine; ++i)
+                    fn(i);
+            }, &gruppo);
+        }
+        attendi(gruppo);
+    }
+
+    // Esegue il grafo e ritorna quando tutti i nodi sono completati
+    void esegui(GrafoLavori& grafo)
+    {
+        if (grafo.nodi.empty())
+            return;
+        if (workers.empty())
+        {
+            for (GrafoLavori::Nodo& n : grafo.nodi)
+                n.fn();
+            return;
+        }
+        for (GrafoLavori::Nodo& n : grafo.nodi)
+            n.mancanti = n.dipendenze;
+        Gruppo gruppo((int)grafo.nodi.size());
+        for (int i = 0; i < grafo.size(); ++i)
+            if (grafo.nodi[i].dipendenze == 0)
+                accodaNodo(grafo, i, &gruppo);
+        attendi(gruppo);
+    }
+
+    Stats getStats() const
+    {
+        Stats s;
+        s.thread = size();
+        long long ns = 0;
+        for (const std::unique_ptr<Coda>& c : code)
+        {
+            s.lavori += c->eseguiti;
+            s.furti += c->furti;
+            ns += c->nsInattivo;
+        }
+        s.msInattivo = ns / 1.0e6;
+        double ms = std::chrono::duration<double, std::milli>(orologio::now() - inizioStats).count();
+        if (!workers.empty() && ms > 0.0)
+            s.percentualeInattivo = std::min(100.0, 100.0 * s.msInattivo / (ms * workers.size()));
+        return s;
+    }
+
+    void azzeraStats()
+    {
+        for (std::unique_ptr<Coda>& c : code)
+        {
+            c->eseguiti = 0;
+            c->furti = 0;
+            c->nsInattivo = 0;
+        }
+        inizioStats = orologio::now();
+    }
+
+private:
+    typedef std::chrono::steady_clock orologio;
+
+    // Lavori di un parallelFor o di un grafo: chi aspetta esegue solo questi. I contatori cambiano sotto il
+    // mutex, cosi' chi aspetta non distrugge il gruppo mentre l'ultimo lavoro lo sta ancora usando.
+    struct Gruppo {
+        explicit Gruppo(int n) : rimanenti(n) {}
+        int rimanenti;
+        int accodati = 0;                   // nodi di un grafo accodati dopo l'avvio
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    struct Lavoro {
+        std::function<void()> fn;
+        Gruppo* gruppo = nullptr;
+    };
+
+    struct Coda {
+        std::mutex mutex;
+        std::deque<Lavoro> lavori;
+        std::atomic<unsigned long long> eseguiti{ 0 };
+        std::atomic<unsigned long long> furti{ 0 };
+        std::atomic<long long> nsInattivo{ 0 };
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Coda>> code;
+    std::atomic<int> inCoda{ 0 };           // lavori accodati e non ancora presi
+    std::atomic<int> dormienti{ 0 };
+    std::mutex mutexSonno;
+    std::condition_variable cvSonno;
+    bool stopping = false;
+    orologio::time_point inizioStats;
+
+    // Indice del worker del thread corrente in questo pool, -1 per i thread esterni
+    static int& indiceLocale() { static thread_local int indice = -1; return indice; }
+    static const ThreadPool*& poolLocale() { static thread_local const ThreadPool* pool = nullptr; return pool; }
+    int indiceCorrente() const { return poolLocale() == this ? indiceLocale() : -1; }
+    Coda& codaPropria(int indice) { return *code[indice >= 0 ? indice : (int)code.size() - 1]; }
+
+    void accoda(std::function<void()> fn, Gruppo* gruppo)
+    {
+        {
+            Coda& c = codaPropria(indiceCorrente());
+            std::lock_guard<std::mutex> lock(c.mutex);
+            c.lavori.push_back(Lavoro{ std::move(fn), gruppo });
+        }
+        inCoda++;
+        // un worker che dorme ha incrementato dormienti prima di ricontrollare inCoda sotto mutexSonno:
+        // o vede il nuovo lavoro o riceve la notifica
+        if (dormienti > 0)
+        {
+            std::lock_guard<std::mutex> lock(mutexSonno);
+            cvSonno.notify_one();
+        }
+    }
+
+    void accodaNodo(GrafoLavori& grafo, int i, Gruppo* gruppo)
+    {
+        accoda([this, &grafo, i, gruppo]() {
+            GrafoLavori::Nodo& n = grafo.nodi[i];
+            n.fn();
+            for (int s : n.successori)
+                if (--grafo.nodi[s].mancanti == 0)
+                    accodaNodo(grafo, s, gruppo);
+        }, gruppo);
+        // sveglia chi aspetta il grafo: c'e' un nodo in piu' da eseguire
+        std::lock_guard<std::mutex> lock(gruppo->mutex);
+        gruppo->accodati++;
+        gruppo->cv.notify_all();
+    }
+
+    // Prende un lavoro (del gruppo richiesto, o qualunque se nullptr): prima dal fondo della propria coda,
+    // poi dalla testa delle altre
+    bool prendi(int indice, const Gruppo* gruppo, Lavoro& lavoro, bool& rubato)
+    {
+        if (inCoda <= 0)
+            return false;
+        int n = (int)code.size();
+        int propria = indice >= 0 ? indice : n - 1;
+        for (int k = 0; k < n; ++k)
+        {
+            int v = (propria + k) % n;
+            Coda& c = *code[v];
+            std::lock_guard<std::mutex> lock(c.mutex);
+            if (c.lavori.empty())
+                continue;
+            bool daFondo = v == propria;
+            if (gruppo == nullptr)
+            {
+                if (daFondo) { lavoro = std::move(c.lavori.back()); c.lavori.pop_back(); }
+                else { lavoro = std::move(c.lavori.front()); c.lavori.pop_front(); }
+            }
+            else
+            {
+                auto trovato = c.lavori.end();
+                if (daFondo)
+                {
+                    for (auto it = c.lavori.end(); it != c.lavori.begin();)
+                        if ((--it)->gruppo == gruppo) { trovato = it; break; }
+                }
+                else
+                    trovato = std::find_if(c.lavori.begin(), c.lavori.end(), [gruppo](const Lavoro& l) { return l.gruppo == gruppo; });
+                if (trovato == c.lavori.end())
+                    continue;
+                lavoro = std::move(*trovato);
+                c.lavori.erase(trovato);
+            }
+            inCoda--;
+            rubato = !daFondo;
+            return true;
+        }
+        return false;
+    }
+
+    void esegui(int indice, Lavoro& lavoro, bool rubato)
+    {
+        lavoro.fn();
+        Coda& c = codaPropria(indice);
+        c.eseguiti++;
+        if (rubato)
+            c.furti++;
+        Gruppo* g = lavoro.gruppo;
+        std::lock_guard<std::mutex> lock(g->mutex);
+        if (--g->rimanenti == 0)
+            g->cv.notify_all();
+    }
+
+    // Il chiamante lavora sui lavori del gruppo finche' ce ne sono in coda, poi dorme finche' il gruppo e'
+    // completato o un grafo accoda nuovi nodi
+    void attendi(Gruppo& gruppo)
+    {
+        int indice = indiceCorrente();
+        for (;;)
+        {
+            int visti;
+            {
+                std::lock_guard<std::mutex> lock(gruppo.mutex);
+                if (gruppo.rimanenti == 0)
+                    return;
+                visti = gruppo.accodati;
+            }
+            Lavoro lavoro;
+            bool rubato = false;
+            if (prendi(indice, &gruppo, lavoro, rubato))
+            {
+                esegui(indice, lavoro, rubato);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(gruppo.mutex);
+            gruppo.cv.wait(lock, [&gruppo, visti] { return gruppo.rimanenti == 0 || gruppo.accodati != visti; });
+        }
+    }
+
+    void workerLoop(int indice)
+    {
+        indiceLocale() = indice;
+        poolLocale() = this;
+        for (;;)
+        {
+            Lavoro lavoro;
+            bool rubato = false;
+            if (prendi(indice, nullptr, lavoro, rubato))
+            {
+                esegui(indice, lavoro, rubato);
+                continue;
+            }
+            auto t0 = orologio::now();
+            {
+                std::unique_lock<std::mutex> lock(mutexSonno);
+                dormienti++;
+                cvSonno.wait(lock, [this] { return stopping || inCoda > 0; });
+                dormienti--;
+                if (stopping)
+                    return;
+            }
+            code[indice]->nsInattivo += std::chrono::duration_cast<std::chrono::nanoseconds>(orologio::now() - t0).count();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,528 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <stb_image.h>
+
+#include <learnopengl/async_io.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// File system virtuale degli asset: se e' montato un pacchetto (tools/assetpack) i file vengono letti
+// dalla sua mappatura in memoria, altrimenti dal disco come prima. Model (via Assimp, vfs_assimp.h),
+// le texture (stb_image e DDS) e Shader passano tutti da qui.
+//
+// Formato del pacchetto (little endian):
+//   PackHeader | blob allineati a PACK_ALIGN | PackEntry[count] ordinate per hash | nomi terminati da '\0'
+// Ogni blob e' il file originale o la sua versione compressa LZ4 (formato a blocchi). L'indice e' cercato
+// per hash FNV-1a del percorso normalizzato (minuscolo, '/' come separatore, senza "./" e "..").
+// Il pacchetto intero viene mappato e fatto leggere in anticipo dal sistema operativo: all'avvio
+// si passa da centinaia di aperture di file piccoli a poche letture sequenziali grandi.
+// I file sciolti possono essere letti in anticipo con prefetch(): le letture partono tutte insieme
+// su AsyncIO (io_uring o thread) e open() consegna il buffer appena arrivato, senza rileggere il disco.
+namespace vfs
+{
+    const unsigned int PACK_VERSION = 1;
+    const size_t PACK_ALIGN = 4096;
+    enum Codec { Nessuno = 0, LZ4 = 1 };
+
+    struct PackHeader {
+        char magic[4];                 // "TPAK"
+        unsigned int version;
+        unsigned int count;
+        unsigned int reserved;
+        unsigned long long tocOffset;
+        unsigned long long namesOffset;
+    };
+    struct PackEntry {
+        unsigned long long hash;
+        unsigned long long offset;
+        unsigned long long size;       // byte nel pacchetto
+        unsigned long long originalSize;
+        unsigned int codec;
+        unsigned int nameOffset;
+    };
+
+    inline std::string normalizza(const std::string& path)
+    {
+        std::vector<std::string> parti;
+        std::string parte;
+        for (size_t i = 0; i <= path.size(); ++i)
+        {
+            char c = i < path.size() ? path[i] : '/';
+            if (c == '/' || c == '\\')
+            {
+                if (parte == "..")
+                {
+                    if (!parti.empty() && parti.back() != "..")
+                        parti.pop_back();
+                    else
+                        parti.push_back(parte);
+                }
+                else if (!parte.empty() && parte != ".")
+                    parti.push_back(parte);
+                parte.clear();
+            }
+            else
+                parte += (char)std::tolower((unsigned char)c);
+        }
+        std::string out;
+        for (size_t i = 0; i < parti.size(); ++i)
+            out += (i ? "/" : "") + parti[i];
+        return out;
+    }
+
+    inline unsigned long long hash(const std::string& normalizzato)
+    {
+        unsigned long long h = 14695981039346656037ull;
+        for (unsigned char c : normalizzato)
+            h = (h ^ c) * 1099511628211ull;
+        return h;
+    }
+
+    // Decompressione di un blocco LZ4 (sequenze token / letterali / offset / lunghezza match)
+    inline bool lz4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+    {
+        const unsigned char* ip = src;
+        const unsigned char* iend = src + srcSize;
+        unsigned char* op = dst;
+        unsigned char* oend = dst + dstSize;
+        while (ip < iend)
+        {
+            unsigned int token = *ip++;
+            size_t letterali = token >> 4;
+            if (letterali == 15)
+            {
+                unsigned char b;
+                do {
+                    if (ip >= iend) return false;
+                    b = *ip++;
+                    letterali += b;
+                } while (b == 255);
+            }
+            if ((size_t)(iend - ip) < letterali || (size_t)(oend - op) < letterali)
+                return false;
+            memcpy(op, ip, letterali);
+            op += letterali;
+            ip += letterali;
+            if (ip >= iend)
+                break; // l'ultima sequenza ha solo letterali
+            if (iend - ip < 2)
+                return false;
+            size_t offset = ip[0] | ((size_t)ip[1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > (size_t)(op - dst))
+                return false;
+            size_t lunghezza = token & 15;
+            if (lunghezza == 15)
+            {
+                unsigned char b;
+                do {
+                    if (ip >= iend) return false;
+                    b = *ip++;
+                    lunghezza += b;
+                } while (b == 255);
+            }
+            lunghezza += 4;
+            if ((size_t)(oend - op) < lunghezza)
+                return false;
+            const unsigned char* match = op - offset;
+            if (offset >= lunghezza)
+                memcpy(op, match, lunghezza);
+            else
+                for (size_t i = 0; i < lunghezza; ++i) // sovrapposto: ripete il pattern
+                    op[i] = match[i];
+            op += lunghezza;
+        }
+        return op == oend;
+    }
+
+    // Contenuto di un file: puntatore nella mappatura (zero copie), buffer letto in anticipo o buffer proprio
+    struct File {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        std::vector<unsigned char> owned;
+        std::shared_ptr<std::vector<unsigned char>> shared;
+    };
+
+    struct Stats {
+        unsigned int entries = 0;
+        size_t bytesPacchetto = 0;
+        unsigned long long dalPacchetto = 0;   // aperture servite dal pacchetto
+        unsigned long long dalDisco = 0;       // aperture servite da file sciolti
+        unsigned long long inAnticipo = 0;     // aperture servite da una lettura anticipata (prefetch)
+    };
+
+    // Pacchetto montato (uno solo). Dopo mount() e' di sola lettura: le ricerche sono sicure da piu' thread.
+    class Pack
+    {
+    public:
+        ~Pack() { close(); }
+
+        bool open(const std::string& path)
+        {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER dim;
+            if (!GetFileSizeEx(file, &dim) || dim.QuadPart == 0)
+                return false;
+            size = (size_t)dim.QuadPart;
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!mapping)
+                return false;
+            base = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!base)
+                return false;
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+            WIN32_MEMORY_RANGE_ENTRY range = { (PVOID)base, size };
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+                return false;
+            size = (size_t)st.st_size;
+            void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+                return false;
+            base = (const unsigned char*)p;
+            // lettura anticipata dell'intero pacchetto in blocchi grandi
+            madvise(p, size, MADV_WILLNEED);
+#endif
+            return validate();
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (base) UnmapViewOfFile(base);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = NULL;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (base) munmap((void*)base, size);
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#endif
+            base = nullptr;
+            size = 0;
+            toc = nullptr;
+            count = 0;
+        }
+
+        const PackEntry* find(const std::string& path) const
+        {
+            std::string n = normalizza(path);
+            unsigned long long h = hash(n);
+            const PackEntry* fine = toc + count;
+            const PackEntry* e = std::lower_bound(toc, fine, h,
+                [](const PackEntry& a, unsigned long long v) { return a.hash < v; });
+            for (; e != fine && e->hash == h; ++e)
+                if (n == nomi + e->nameOffset)
+                    return e;
+            return nullptr;
+        }
+
+        bool read(const PackEntry& e, File& f) const
+        {
+            const unsigned char* blob = base + e.offset;
+            if (e.codec == Nessuno)
+            {
+                f.data = blob;
+                f.size = (size_t)e.size;
+                return true;
+            }
+            f.owned.resize((size_t)e.originalSize);
+            if (!lz4Decompress(blob, (size_t)e.size, f.owned.data(), f.owned.size()))
+                return false;
+            f.data = f.owned.data();
+            f.size = f.owned.size();
+            return true;
+        }
+
+        unsigned int entries() const { return count; }
+        size_t bytes() const { return size; }
+
+    private:
+        const unsigned char* base = nullptr;
+        size_t size = 0;
+        const PackEntry* toc = nullptr;
+        const char* nomi = nullptr;
+        unsigned int count = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#else
+        int fd = -1;
+#endif
+
+        bool validate()
+        {
+            if (size < sizeof(PackHeader))
+                return false;
+            PackHeader h;
+            memcpy(&h, base, sizeof(h));
+            if (memcmp(h.magic, "TPAK", 4) != 0 || h.version != PACK_VERSION)
+                return false;
+            if (h.tocOffset % alignof(PackEntry) != 0 || h.tocOffset + (unsigned long long)h.count * sizeof(PackEntry) > size
+                || h.namesOffset > size || base[size - 1] != '\0')
+                return false;
+            toc = (const PackEntry*)(base + h.tocOffset);
+            nomi = (const char*)(base + h.namesOffset);
+            count = h.count;
+            for (unsigned int i = 0; i < count; ++i)
+                if (toc[i].offset + toc[i].size > size || h.namesOffset + toc[i].nameOffset >= size)
+                    return false;
+            return true;
+        }
+    };
+
+    inline Pack*& packMontato()
+    {
+        static Pack* pack = nullptr;
+        return pack;
+    }
+
+    inline std::atomic<unsigned long long>& contatore(int i)
+    {
+        static std::atomic<unsigned long long> c[3];
+        return c[i];
+    }
+
+    // Monta il pacchetto; va chiamato prima di caricare gli asset, prima di avviare thread che leggono file
+    inline bool mount(const std::string& packPath)
+    {
+        Pack* p = new Pack();
+        if (!p->open(packPath))
+        {
+            std::cout << "ERROR::VFS:: pacchetto non valido o non leggibile: " << packPath << std::endl;
+            delete p;
+            return false;
+        }
+        delete packMontato();
+        packMontato() = p;
+        return true;
+    }
+
+    inline void unmount()
+    {
+        delete packMontato();
+        packMontato() = nullptr;
+    }
+
+    inline bool inPack(const std::string& path)
+    {
+        return packMontato() && packMontato()->find(path);
+    }
+
+    // Letture anticipate dei file sciolti, per percorso normalizzato; dati resta nullo finche' la lettura
+    // e' in corso (pronto == false) o se e' fallita
+    struct Anticipato {
+        bool pronto = false;
+        AsyncIO::Buffer dati;
+    };
+    struct Anticipati {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::unordered_map<std::string, Anticipato> voci;
+    };
+    inline Anticipati& anticipati()
+    {
+        static Anticipati a;
+        return a;
+    }
+
+    // Avvia in un unico gruppo la lettura asincrona dei file (quelli nel pacchetto sono gia' mappati).
+    // Ogni buffer resta in memoria fino alla prima open() del file.
+    inline void prefetch(const std::vector<std::string>& paths)
+    {
+        Anticipati& a = anticipati();
+        std::vector<std::string> daLeggere;
+        {
+            std::lock_guard<std::mutex> lock(a.mutex);
+            for (const std::string& p : paths)
+                if (!inPack(p) && a.voci.emplace(normalizza(p), Anticipato()).second)
+                    daLeggere.push_back(p);
+        }
+        AsyncIO::shared().submit(daLeggere, [](const std::string& path, const AsyncIO::Buffer& dati) {
+            Anticipati& a = anticipati();
+            {
+                std::lock_guard<std::mutex> lock(a.mutex);
+                auto it = a.voci.find(normalizza(path));
+                if (it != a.voci.end())
+                {
+                    it->second.pronto = true;
+                    it->second.dati = dati;
+                }
+            }
+            a.cv.notify_all();
+        });
+    }
+
+    // Buffer letto in anticipo, aspettando la fine della lettura se e' ancora in corso.
+    // consuma == false lo lascia in memoria per una open() successiva (es. imageInfo prima di loadImage).
+    inline bool daAnticipato(const std::string& path, File& f, bool consuma)
+    {
+        Anticipati& a = anticipati();
+        std::unique_lock<std::mutex> lock(a.mutex);
+        if (a.voci.empty())
+            return false;
+        std::string n = normalizza(path);
+        if (a.voci.count(n) == 0)
+            return false;
+        // la mappa puo' cambiare durante l'attesa: la voce si ricerca ogni volta
+        a.cv.wait(lock, [&] {
+            auto j = a.voci.find(n);
+            return j == a.voci.end() || j->second.pronto;
+        });
+        auto it = a.voci.find(n);
+        if (it == a.voci.end())
+            return false;
+        AsyncIO::Buffer dati = it->second.dati;
+        if (consuma || !dati)
+            a.voci.erase(it);
+        if (!dati)
+            return false;
+        f.shared = dati;
+        f.data = dati->data();
+        f.size = dati->size();
+        contatore(2)++;
+        return true;
+    }
+
+    // Libera il buffer letto in anticipo per un file aperto con consuma == false (es. dopo l'import Assimp,
+    // che apre lo stesso file piu' volte). Non fa nulla se il file non era stato letto in anticipo.
+    inline void rilascia(const std::string& path)
+    {
+        Anticipati& a = anticipati();
+        std::lock_guard<std::mutex> lock(a.mutex);
+        auto it = a.voci.find(normalizza(path));
+        // una lettura ancora in corso resta: la callback di prefetch la troverebbe altrimenti mancante
+        if (it != a.voci.end() && it->second.pronto)
+            a.voci.erase(it);
+    }
+
+    // Il file e' gia' in memoria (pacchetto o lettura anticipata): conviene leggerlo intero
+    inline bool inMemoria(const std::string& path)
+    {
+        if (inPack(path))
+            return true;
+        Anticipati& a = anticipati();
+        std::lock_guard<std::mutex> lock(a.mutex);
+        return !a.voci.empty() && a.voci.count(normalizza(path)) > 0;
+    }
+
+    // Legge un file dal pacchetto, da una lettura anticipata o, se assente, dal disco
+    inline bool open(const std::string& path, File& f, bool consuma = true)
+    {
+        if (Pack* p = packMontato())
+            if (const PackEntry* e = p->find(path))
+            {
+                contatore(0)++;
+                if (p->read(*e, f))
+                    return true;
+                std::cout << "ERROR::VFS:: voce corrotta nel pacchetto: " << path << std::endl;
+                return false;
+            }
+        if (daAnticipato(path, f, consuma))
+            return true;
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        fseek(file, 0, SEEK_END);
+        long len = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        f.owned.resize(len > 0 ? (size_t)len : 0);
+        size_t letti = fread(f.owned.data(), 1, f.owned.size(), file);
+        fclose(file);
+        if (letti != f.owned.size())
+            return false;
+        f.data = f.owned.data();
+        f.size = f.owned.size();
+        contatore(1)++;
+        return true;
+    }
+
+    inline bool exists(const std::string& path)
+    {
+        if (inPack(path))
+            return true;
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file)
+            fclose(file);
+        return file != nullptr;
+    }
+
+    inline bool readText(const std::string& path, std::string& text)
+    {
+        File f;
+        if (!open(path, f))
+            return false;
+        text.assign((const char*)f.data, f.size);
+        return true;
+    }
+
+    // Equivalenti di stbi_load / stbi_info che passano dal pacchetto
+    inline unsigned char* loadImage(const std::string& path, int* w, int* h, int* n, int req)
+    {
+        File f;
+        if (!open(path, f))
+            return nullptr;
+        return stbi_load_from_memory(f.data, (int)f.size, w, h, n, req);
+    }
+
+    inline bool imageInfo(const std::string& path, int* w, int* h, int* n)
+    {
+        if (!inMemoria(path))
+            return stbi_info(path.c_str(), w, h, n) != 0;
+        File f;
+        return open(path, f, false) && stbi_info_from_memory(f.data, (int)f.size, w, h, n) != 0;
+    }
+
+    inline Stats getStats()
+    {
+        Stats s;
+        if (Pack* p = packMontato())
+        {
+            s.entries = p->entries();
+            s.bytesPacchetto = p->bytes();
+        }
+        s.dalPacchetto = contatore(0);
+        s.dalDisco = contatore(1);
+        s.inAnticipo = contatore(2);
+        return s;
+    }
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef VFS_ASSIMP_H
+#define VFS_ASSIMP_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Adattatore di I/O per Assimp: i modelli e i loro .mtl vengono letti tramite vfs (pacchetto o disco).
+// Uso: importer.SetIOHandler(new VfsIOSystem()); l'Importer ne prende possesso.
+// Assimp apre lo stesso file piu' volte (riconoscimento del formato, poi lettura): le letture anticipate non
+// vengono consumate all'apertura, il chiamante le libera con vfs::rilascia() per ogni file di aperti().
+class VfsIOStream : public Assimp::IOStream
+{
+public:
+    // file punta nella mappatura del pacchetto o in un buffer condiviso: lo stream non copia i dati
+    explicit VfsIOStream(vfs::File&& f) : file(std::move(f)) {}
+
+    size_t Read(void* buffer, size_t size, size_t count) override
+    {
+        if (size == 0)
+            return 0;
+        size_t n = std::min(count, (file.size - pos) / size);
+        memcpy(buffer, file.data + pos, n * size);
+        pos += n * size;
+        return n;
+    }
+
+    size_t Write(const void*, size_t, size_t) override { return 0; }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override
+    {
+        size_t nuova;
+        switch (origin)
+        {
+        case aiOrigin_SET: nuova = offset; break;
+        case aiOrigin_CUR: nuova = pos + offset; break;
+        // offset negativo rispetto alla fine, passato come size_t: la somma modulo 2^N lo riporta dentro il file
+        // (come fseek(SEEK_END) in DefaultIOStream); un offset positivo finisce oltre la fine e fallisce
+        default:           nuova = file.size + offset; break;
+        }
+        if (nuova > file.size)
+            return aiReturn_FAILURE;
+        pos = nuova;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override { return pos; }
+    size_t FileSize() const override { return file.size; }
+    void Flush() override {}
+
+private:
+    vfs::File file;
+    size_t pos = 0;
+};
+
+// Tiene l'elenco dei file aperti con successo (il modello e i suoi .mtl): mesh_cache.h li registra come
+// sorgenti della cache.
+// Le voci non compresse del pacchetto e le letture anticipate si servono senza copie; i file sciolti e le voci
+// compresse si leggono (o decomprimono) per intero una sola volta e il buffer e' condiviso dalle aperture
+// successive dello stesso file durante l'import.
+class VfsIOSystem : public Assimp::IOSystem
+{
+public:
+    bool Exists(const char* path) const override { return vfs::exists(path); }
+    char getOsSeparator() const override { return '/'; }
+
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override
+    {
+        if (strchr(mode, 'w') || strchr(mode, 'a'))
+            return nullptr;
+        vfs::File f;
+        std::string n = vfs::normalizza(path);
+        auto it = letti.find(n);
+        if (it != letti.end())
+        {
+            f.shared = it->second;
+        }
+        else
+        {
+            if (!vfs::open(path, f, false))
+                return nullptr;
+            if (!f.owned.empty())
+            {
+                f.shared = std::make_shared<std::vector<unsigned char>>(std::move(f.owned));
+                letti[n] = f.shared;
+            }
+            if (std::find(file.begin(), file.end(), path) == file.end())
+                file.push_back(path);
+        }
+        if (f.shared)
+        {
+            f.data = f.shared->data();
+            f.size = f.shared->size();
+        }
+        return new VfsIOStream(std::move(f));
+    }
+
+    void Close(Assimp::IOStream* stream) override { delete stream; }
+
+    const std::vector<std::string>& aperti() const { return file; }
+
+private:
+    std::vector<std::string> file;
+    std::unordered_map<std::string, std::shared_ptr<std::vector<unsigned char>>> letti;   // copie proprie gia' lette, per percorso normalizzato
+};
+
+#endif
@@ -16,14 +16,67 @@ in VS_OUT {
     vec3 TangentLuceSxDir;
     vec3 TangentLuceSxConeDir;
     vec4 FragPosLuceSxSpace;
+    vec3 WorldPos;
+    mat3 TBN;
 } fs_in;
 
+#ifdef GBUFFER
+// Geometry pass del percorso deferred (gbuffer.h): niente illuminazione, solo albedo + gloss e normale
+// in spazio mondo con codifica ottaedrica; le luci le calcola deferred.fs una volta per pixel
+layout (location = 0) out vec4 gAlbedoGloss;
+layout (location = 1) out vec2 gNormale;
+
+vec2 segno(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Proietta la normale sull'ottaedro |x|+|y|+|z| = 1 e ripiega l'emisfero inferiore: risultato in [0, 1]
+vec2 codificaOttaedrica(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * segno(n.xy);
+    return e * 0.5 + 0.5;
+}
+#else
 out vec4 FragColor;
 
-// Texture diffuse (colore), normal map, gloss e shadow map
+// Luci pratiche (practical_lights.h): luci puntiformi in spazio mondo, stessa funzione in deferred.fs
+layout (std140) uniform LuciPratiche {
+    vec4 luciPosRaggio[256];    // posizione, raggio d'azione
+    vec4 luciColore[256];
+    int numLuci;
+};
+uniform vec3 viewPos;
+
+vec3 luciPratiche(vec3 pos, vec3 normal, vec3 viewDir, vec3 color, float shininess)
+{
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < numLuci; ++i)
+    {
+        vec3 l = luciPosRaggio[i].xyz - pos;
+        float d2 = dot(l, l);
+        float r2 = luciPosRaggio[i].w * luciPosRaggio[i].w;
+        if (d2 >= r2)
+            continue;
+        float att = 1.0 - d2 / r2;
+        att *= att;
+        l *= inversesqrt(d2);
+        float diff = max(dot(l, normal), 0.0);
+        float spec = pow(max(dot(normal, normalize(l + viewDir)), 0.0), shininess);
+        result += att * luciColore[i].rgb * (diff * color + vec3(0.2) * spec);
+    }
+    return result;
+}
+#endif
+
+// Texture diffuse (colore), normal map, gloss e shadow map.
+// Permutazione GLOSS_IN_DIFFUSE_ALPHA: la gloss e' impacchettata nell'alpha della diffuse (un fetch in meno)
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_normal1;
+#ifndef GLOSS_IN_DIFFUSE_ALPHA
 uniform sampler2D texture_specular1;
+#endif
 // --- LUCE DX ---
 uniform sampler2D shadowMapLuceDx;
 uniform mat4 luceDxSpaceMatrix;
@@ -38,6 +91,58 @@ uniform mat4 luceCentroSpaceMatrix;
 
 uniform float intensitaLuciLaterali;
 
+#ifdef DISEGNO_INDIRETTO
+// Tabella dei materiali (material_table.h): per ogni ruolo (diffuse, normal, gloss) l'array di texture,
+// lo strato e il primo livello residente; array < 0 = si usa la texture legata, come senza tabella
+flat in uint materialeTabella;
+struct MaterialeTabella {
+    ivec4 ruoli[3];
+};
+layout (std430, binding = 1) readonly buffer Materiali {
+    MaterialeTabella materiali[];
+};
+uniform sampler2DArray textureTabella[8];
+
+// LOD calcolato dalle derivate e limitato al primo livello residente (i livelli piu' fini dello strato
+// possono non essere ancora arrivati dallo streaming)
+vec4 campionaArray(sampler2DArray s, vec3 uvStrato, float base, vec2 dx, vec2 dy)
+{
+    vec2 dim = vec2(textureSize(s, 0).xy);
+    float rho = max(dot(dx * dim, dx * dim), dot(dy * dim, dy * dim));
+    return textureLod(s, uvStrato, max(0.5 * log2(rho), base));
+}
+
+vec4 campionaMateriale(sampler2D legata, int ruolo, vec2 uv)
+{
+    vec2 dx = dFdx(uv);
+    vec2 dy = dFdy(uv);
+    if (materialeTabella != 0xFFFFFFFFu)
+    {
+        ivec4 r = materiali[materialeTabella].ruoli[ruolo];
+        vec3 c = vec3(uv, float(r.y));
+        float base = float(r.z);
+        // indici costanti: gli array di sampler non si possono indicizzare con un valore per disegno
+        switch (r.x)
+        {
+        case 0: return campionaArray(textureTabella[0], c, base, dx, dy);
+        case 1: return campionaArray(textureTabella[1], c, base, dx, dy);
+        case 2: return campionaArray(textureTabella[2], c, base, dx, dy);
+        case 3: return campionaArray(textureTabella[3], c, base, dx, dy);
+        case 4: return campionaArray(textureTabella[4], c, base, dx, dy);
+        case 5: return campionaArray(textureTabella[5], c, base, dx, dy);
+        case 6: return campionaArray(textureTabella[6], c, base, dx, dy);
+        case 7: return campionaArray(textureTabella[7], c, base, dx, dy);
+        }
+    }
+    return textureGrad(legata, uv, dx, dy);
+}
+#else
+vec4 campionaMateriale(sampler2D legata, int ruolo, vec2 uv)
+{
+    return texture(legata, uv);
+}
+#endif
+
 
 float ShadowCalculation(vec4 fragPosLightSpace, sampler2D shadowMap)
 {
@@ -64,11 +169,22 @@ float ShadowCalculation(vec4 fragPosLightSpace, sampler2D shadowMap)
 
 void main()
 {
-    vec3 normal = texture(texture_normal1, fs_in.TexCoords).rgb;
-    normal = normalize(normal * 2.0 - 1.0);
-    vec3 color = texture(texture_diffuse1, fs_in.TexCoords).rgb;
+    // Solo XY dalla normal map: Z viene ricostruita (le normal map cotte in BC5 non hanno il canale B)
+    vec2 normalXY = campionaMateriale(texture_normal1, 1, fs_in.TexCoords).rg * 2.0 - 1.0;
+    vec3 normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
+#ifdef GLOSS_IN_DIFFUSE_ALPHA
+    vec4 diffuseGloss = campionaMateriale(texture_diffuse1, 0, fs_in.TexCoords);
+    vec3 color = diffuseGloss.rgb;
+    float gloss = diffuseGloss.a;
+#else
+    vec3 color = campionaMateriale(texture_diffuse1, 0, fs_in.TexCoords).rgb;
+    float gloss = campionaMateriale(texture_specular1, 2, fs_in.TexCoords).r;
+#endif
+#ifdef GBUFFER
+    gAlbedoGloss = vec4(color, gloss);
+    gNormale = codificaOttaedrica(normalize(fs_in.TBN * normal));
+#else
     vec3 ambient = 0.28 * color;
-    float gloss = texture(texture_specular1, fs_in.TexCoords).r;
     float shininess = mix(8.0, 128.0, gloss);
 
     // --- Spotlight (segue la camera) ---
@@ -131,6 +247,11 @@ void main()
     float shadowLuceCentro = ShadowCalculation(fragPosLuceCentroSpace, shadowMapLuceCentro);
     vec3 luceCentroResult = luceCentroIntensity * (1.0 - shadowLuceCentro) * (luceCentroDiffuse + luceCentroSpecular);
 
-    vec3 result = ambient + spotlightResult + luceCentroResult;
+    // --- Luci pratiche (in spazio mondo) ---
+    vec3 worldViewDir = normalize(viewPos - fs_in.WorldPos);
+    vec3 praticheResult = luciPratiche(fs_in.WorldPos, normalize(fs_in.TBN * normal), worldViewDir, color, shininess);
+
+    vec3 result = ambient + spotlightResult + luceCentroResult + praticheResult;
     FragColor = vec4(result, 1.0);
+#endif
 }
@@ -9,6 +9,10 @@ layout (location = 2) in vec2 aTexCoords;  // Coordinate texture
 layout (location = 3) in vec3 aTangent;    // Tangente del vertice
 layout (location = 4) in vec3 aBitangent;  // Bitangente del vertice
 
+// Invariant: il pre-pass di profondita' (shadow_mapping.vs con PREPASS_PROFONDITA) calcola la stessa
+// posizione con la stessa espressione, e il pass principale la confronta con GL_EQUAL
+invariant gl_Position;
+
 // Output verso il fragment shader
 out VS_OUT {
     vec2 TexCoords;                // Coordinate texture
@@ -21,10 +25,15 @@ out VS_OUT {
     vec3 TangentLuceSxDir;         // Direzione della luce sx
     vec3 TangentLuceSxConeDir;     // Direzione del cono della luce sx
     vec4 FragPosLuceSxSpace;       // Posizione del frammento nello spazio della luce sx per shadow mapping
+    vec3 WorldPos;                 // Posizione in spazio mondo (luci pratiche)
+    mat3 TBN;                      // Da spazio tangente a spazio mondo (luci pratiche, normale del G-buffer)
 } vs_out;
 
 // Uniform per le trasformazioni e le posizioni delle luci
-uniform mat4 model;         // Matrice modello
+// Matrice modello: uniform block letto da un intervallo del buffer circolare (stream_buffer.h, binding 0)
+layout (std140) uniform Oggetto {
+    mat4 model;             // Matrice modello
+};
 uniform mat4 view;          // Matrice vista
 uniform mat4 projection;    // Matrice proiezione
 uniform vec3 lightPos;      // Posizione spotlight
@@ -37,19 +46,48 @@ uniform vec3 luceSxPos;     // Posizione luce sx
 uniform vec3 luceSxDir;     // Direzione luce sx
 uniform mat4 luceSxSpaceMatrix; // Matrice per shadow mapping della luce sx
 
+#ifdef DISEGNO_INDIRETTO
+// Multi-draw indirect (draw_indirect.h): con disegnoIndiretto la matrice modello arriva dalla tabella
+// dei disegni, indicizzata dall'attributo per istanza aDrawId (= baseInstance del comando)
+layout (location = 7) in uint aDrawId;
+struct Disegno {
+    mat4 model;
+    uint materiale;
+    uint primoIndice;
+    uint numeroIndici;
+    int baseVertex;
+};
+layout (std430, binding = 0) readonly buffer Disegni {
+    Disegno disegni[];
+};
+uniform bool disegnoIndiretto;
+// Materiale del disegno nella tabella dei materiali (material_table.h), 0xFFFFFFFF = texture legate
+flat out uint materialeTabella;
+#endif
+
 void main()
 {
+    mat4 modello = model;
+#ifdef DISEGNO_INDIRETTO
+    materialeTabella = 0xFFFFFFFFu;
+    if (disegnoIndiretto)
+    {
+        modello = disegni[aDrawId].model;
+        materialeTabella = disegni[aDrawId].materiale;
+    }
+#endif
+
     // Calcolo della matrice TBN (Tangente, Bitangente, Normale) per passare da world space a tangent space
-    vec3 T = normalize(mat3(model) * aTangent);   // Tangente trasformata
-    vec3 B = normalize(mat3(model) * aBitangent); // Bitangente trasformata
-    vec3 N = normalize(mat3(model) * aNormal);    // Normale trasformata
+    vec3 T = normalize(mat3(modello) * aTangent);   // Tangente trasformata
+    vec3 B = normalize(mat3(modello) * aBitangent); // Bitangente trasformata
+    vec3 N = normalize(mat3(modello) * aNormal);    // Normale trasformata
     mat3 TBN = mat3(T, B, N);
     
     // Per trasformare da world space a tangent space si usa la trasposta della TBN
     mat3 TBN_inv = transpose(TBN);
 
     // Calcolo della posizione del frammento in world space
-    vec3 fragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 fragPos = vec3(modello * vec4(aPos, 1.0));
     vs_out.TexCoords = aTexCoords;
     
     // Trasforma le direzioni delle luci e della vista nello spazio tangente
@@ -62,6 +100,9 @@ void main()
     vs_out.TangentLuceSxDir = TBN_inv * (luceSxPos - fragPos);         // Direzione luce sx
     vs_out.TangentLuceSxConeDir = TBN_inv * normalize(luceSxDir);      // Direzione del cono della luce sx
     vs_out.FragPosLuceSxSpace = luceSxSpaceMatrix * vec4(fragPos, 1.0); // Luce sx
+    // Le luci pratiche (numero variabile) si calcolano in spazio mondo: bastano posizione e TBN
+    vs_out.WorldPos = fragPos;
+    vs_out.TBN = TBN;
 
     // Calcola la posizione finale del vertice nello spazio clip
     gl_Position = projection * view * vec4(fragPos, 1.0);
@@ -2,9 +2,47 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
+// Matrice modello: uniform block letto da un intervallo del buffer circolare (stream_buffer.h, binding 0)
+layout (std140) uniform Oggetto {
+    mat4 model;
+};
+
+#ifdef DISEGNO_INDIRETTO
+// Multi-draw indirect (draw_indirect.h): con disegnoIndiretto la matrice modello arriva dalla tabella
+// dei disegni, indicizzata dall'attributo per istanza aDrawId (= baseInstance del comando)
+layout (location = 7) in uint aDrawId;
+struct Disegno {
+    mat4 model;
+    uint materiale;
+    uint primoIndice;
+    uint numeroIndici;
+    int baseVertex;
+};
+layout (std430, binding = 0) readonly buffer Disegni {
+    Disegno disegni[];
+};
+uniform bool disegnoIndiretto;
+#endif
+
+#ifdef PREPASS_PROFONDITA
+// Pre-pass di profondita' del pass principale (depth_prepass.h): stessa espressione di progetto.vs e
+// gl_Position invariant in entrambi, cosi' il pass principale ritrova le stesse profondita' con GL_EQUAL
+invariant gl_Position;
+uniform mat4 view;
+uniform mat4 projection;
+#endif
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    mat4 modello = model;
+#ifdef DISEGNO_INDIRETTO
+    if (disegnoIndiretto)
+        modello = disegni[aDrawId].model;
+#endif
+#ifdef PREPASS_PROFONDITA
+    vec3 fragPos = vec3(modello * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+#else
+    gl_Position = lightSpaceMatrix * modello * vec4(aPos, 1.0);
+#endif
 }
\ No newline at end of file
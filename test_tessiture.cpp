@@ -18,23 +18,86 @@
 #include <learnopengl/shader.h> 
 #include <learnopengl/camera.h> 
 #include <learnopengl/model.h> 
+#include <learnopengl/offscreen.h>
+#include <learnopengl/image_io.h>
+#include <learnopengl/readback.h>
+#include <learnopengl/image_diff.h>
+#include <learnopengl/dds.h>
+#include <learnopengl/material_cache.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/mip_feedback.h>
+#include <learnopengl/vfs.h>
+#include <learnopengl/mesh_lod.h>
+#include <learnopengl/draw_indirect.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/depth_prepass.h>
+#include <learnopengl/gbuffer.h>
+#include <learnopengl/practical_lights.h>
+#include <learnopengl/dynamic_resolution.h>
+#include <learnopengl/frame_jobs.h>
+#include <learnopengl/frame_pacing.h>
+#include <learnopengl/idle_redraw.h>
+#include <learnopengl/simulation.h>
 #define STB_IMAGE_IMPLEMENTATION 
 #include "stb_image.h"
 #include <iostream> 
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
 
 
  // Callback per ridimensionamento finestra: aggiorna viewport OpenGL
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-// Callback per movimento mouse: aggiorna orientamento camera
+// Callback per movimento mouse: accumula la rotazione per la simulazione
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
-// Callback per scroll del mouse: aggiorna zoom camera
+// Callback per scroll del mouse: accumula lo zoom per la simulazione
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-// Gestione input tastiera: aggiorna posizione camera
+// Callback per tasti ed esposizione della finestra: richiedono un nuovo frame (ridisegno a eventi)
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void window_refresh_callback(GLFWwindow* window);
+// Gestione input tastiera: movimento alla simulazione, comandi (materiale, luci, ambiente...)
 void processInput(GLFWwindow* window);
 // Caricamento texture da file (non usata nel main, ma utile per estensioni)
-unsigned int loadTexture(const char* path);
+unsigned int loadTexture(const char* path, const char* glossPath = nullptr);
+// Carica diffuse, normal e gloss di un materiale (con il packing la gloss finisce nell'alpha della diffuse e gloss = 0)
+void caricaMateriale(const char* diffusePath, const char* normalPath, const char* glossPath,
+                     unsigned int& diffuse, unsigned int& normal, unsigned int& gloss);
+// Collega le texture di un materiale alle unita' 0 (diffuse), 1 (normal) e 2 (gloss, se non impacchettata)
+void bindMateriale(Shader& shader, unsigned int diffuse, unsigned int normal, unsigned int gloss);
 // Renderizza la scena per shadow mapping
 void RenderScene(Shader &shader);
+// Crea FBO e texture di profondita' per una shadow map
+void createShadowMap(unsigned int& fbo, unsigned int& depthMap);
+// Esegue un frame completo: tre shadow pass + pass principale nel framebuffer indicato
+// (targetW x targetH: dimensione del framebuffer, se piu' grande della porzione width x height renderizzata)
+void RenderFrame(Shader& shader, Shader& shadowMappingShader, unsigned int targetFBO, int width, int height, int targetW = 0, int targetH = 0);
+// Feedback per lo streaming delle texture: livello di mipmap necessario a un modello / a un quad texturizzato
+void feedbackModello(Model* m, const glm::mat4& model);
+// Livello di dettaglio di un modello nel pass corrente (registra anche i triangoli disegnati)
+int lodModello(Model* m, const glm::mat4& model);
+// Disegna un modello al livello scelto, o lo accoda al multi-draw indirect del pass
+void disegnaModello(Model* m, Shader& shader, const glm::mat4& model);
+// Copia nell'arena un quad dell'ambiente (14 float per vertice) con le texture del suo materiale
+Mesh* creaQuad(const float* vertici, size_t numFloat, const unsigned int* indici, size_t numIndici,
+               unsigned int diffuse, unsigned int normal, unsigned int gloss);
+// Disegna un quad dell'ambiente con il suo VAO, o lo accoda al multi-draw indirect del pass
+void disegnaQuad(unsigned int vao, Mesh* mesh, const glm::mat4& model);
+// Scrive la matrice modello nel buffer circolare e la lega al blocco Oggetto degli shader
+void impostaModello(const glm::mat4& model);
+void feedbackQuad(const float* vertici, size_t numFloat, const unsigned int* indici, size_t numIndici, const glm::mat4& model,
+                  unsigned int diffuse, unsigned int normal, unsigned int gloss);
+// Esegue i job di rendering batch descritti nel manifest (materiale x ambiente x camera)
+int runBatch(const std::string& manifestPath, Shader& shader, Shader& shadowMappingShader);
+// Confronta gli scenari del manifest con le immagini di riferimento (test di regressione visiva)
+int runGolden(const std::string& manifestPath, const std::string& refDir, bool update, Shader& shader, Shader& shadowMappingShader, int& mancanti);
+// Misura forward e deferred al crescere di luci pratiche e risoluzione
+int runBenchDeferred(Shader& shader, Shader& shadowMappingShader);
+// Benchmark del job system: lavori per frame di una scena sintetica al crescere dei thread (solo CPU)
+int runBenchJobs(int istanze);
 
 // Impostazioni finestra (risoluzione)
 const unsigned int SCR_WIDTH = 1800;
@@ -43,16 +106,132 @@ const unsigned int SCR_HEIGHT = 1200;
 // Shadow map resolution
 const unsigned int SHADOW_WIDTH = 8096, SHADOW_HEIGHT = 8096;
 
+// Shadow map per luceDx, luceSx e luce centrale (FBO + texture di profondita')
+unsigned int depthMapFBOLuceDx, depthMapFBOLuceSx, depthMapFBOCentro;
+unsigned int depthMapLuceDx, depthMapLuceSx, depthMapLuceCentro;
+// Le luci e la geometria che proietta ombre dipendono solo da sceneState:
+// le shadow map vengono ridisegnate solo quando l'ambiente cambia
+int shadowSceneState = -1; // -1 = shadow map da ricalcolare
+int shadowPassCount = 0;   // numero di volte che le shadow map sono state ridisegnate
+
+// === Feedback dei livelli di mipmap (streaming delle texture) ===
+// Attivo solo durante il pass principale: le shadow pass non campionano texture
+bool mipFeedbackAttivo = false;
+glm::mat4 mipFeedbackViewProj;
+int mipFeedbackAltezza = SCR_HEIGHT;
+std::map<const Model*, std::vector<SuperficieMip>> superficiModelli; // per mesh, in spazio modello
+
+// === Livelli di dettaglio dei modelli (mesh_lod.h) ===
+// Ogni istanza sceglie il livello in ogni pass dall'errore proiettato in pixel; le shadow pass
+// scendono di lodBiasOmbre livelli in piu' (--shadow-lod-bias N, --no-lod per disattivare)
+meshlod::SelettoreLod selettoreLod;
+meshlod::Vista vistaLod;          // osservatore del pass in corso
+int passoLod = 0;                 // 0 = pass principale, 1..3 = shadow map luceDx, luceSx, centro
+int lodBiasOmbre = 1;
+size_t triangoliPasso[4] = { 0 }; // triangoli dei modelli nell'ultimo rendering di ogni pass
+size_t triangoliPassoPieni[4] = { 0 }; // gli stessi modelli al livello 0
+
+// === Multi-draw indirect (--mdi, draw_indirect.h) ===
+// Richiede un contesto 4.3; se non e' disponibile resta il percorso con un draw per mesh (GL 3.3 core)
+bool mdiRichiesto = false;
+DrawIndiretto drawIndiretto;
+// Con il multi-draw indirect anche soffitto, muri e pavimenti sono mesh dell'arena, e i materiali di modelli
+// e ambiente si leggono da array di texture (material_table.h): il pass principale lega le texture una volta
+// sola invece che per gruppo di mesh (--no-material-table per confrontare)
+bool tabellaRichiesta = true;
+TabellaMateriali tabellaMateriali;
+Mesh* meshSoffitto = nullptr;
+Mesh* meshMuro = nullptr;
+Mesh* meshPavimento[4] = { nullptr };   // cemento, piastrelle marble, quarzite, piastrelle
+
+// === Dati per oggetto (stream_buffer.h) ===
+// La matrice modello arriva agli shader come uniform block (Oggetto, binding 0) letto da un intervallo di un
+// buffer circolare mappato: ogni oggetto costa una memcpy e un glBindBufferRange. Un segmento per frame in volo,
+// protetto da un fence; se la GPU e' indietro di FRAME_IN_VOLO frame l'inizio del frame aspetta.
+BufferCircolare bufferOggetti;
+
+// === Pre-pass di profondita' (--depth-prepass on|off|auto, depth_prepass.h) ===
+// Disegna prima la sola profondita' con il percorso di sola posizione delle shadow map, poi il pass principale
+// con GL_EQUAL: progetto.fs gira una volta per pixel. In automatico decide l'overdraw misurato.
+PrePassProfondita prePassProfondita;
+Shader* prePassShader = nullptr;
+bool prePassInCorso = false;
+
+// === Percorso deferred (--deferred o tasto G, gbuffer.h) e luci pratiche (--practicals N o tasto P) ===
+// Il geometry pass scrive il G-buffer compatto con progetto.fs compilato con GBUFFER, poi un pass a schermo intero
+// (deferred.fs) calcola le luci una volta per pixel. Le luci pratiche (practical_lights.h) sono comuni ai due
+// percorsi; --bench-deferred li confronta al crescere del numero di luci e della risoluzione.
+bool deferred = false;
+bool benchDeferred = false;
+int numeroLuciPratiche = 0;
+GBuffer gbuffer;
+LuciPratiche luciPratiche;
+Shader* gbufferShader = nullptr;
+Shader* deferredShader = nullptr;
+
+// === Risoluzione dinamica (dynamic_resolution.h) ===
+// In modalita' interattiva la scena si renderizza a una frazione della finestra scelta dal tempo GPU del pass
+// principale (--frame-budget MS, --no-dynamic-resolution) e upscale.fs la riporta alla risoluzione della finestra;
+// ImGui si disegna dopo, alla risoluzione nativa
+RisoluzioneDinamica risoluzioneDinamica;
+Shader* upscaleShader = nullptr;
+int finestraWidth = SCR_WIDTH;      // framebuffer della finestra, aggiornato da framebuffer_size_callback
+int finestraHeight = SCR_HEIGHT;
+
+// === Frame in volo (frame_pacing.h) ===
+// Il ciclo interattivo chiude ogni frame con un fence e non ne inizia uno nuovo finche' la GPU ha piu' di
+// frameInVolo frame da completare (--frames-in-flight 1..3, tasto F): 1 = latenza minima, 3 = throughput massimo.
+// --swap-interval N imposta il V-Sync (di default decide il driver).
+CadenzaFrame cadenzaFrame;
+int swapInterval = -1;
+
+// === Ridisegno a eventi (idle_redraw.h) ===
+// Se la scena e' ferma il ciclo interattivo non disegna e dorme in glfwWaitEventsTimeout; input, resize e
+// lavoro in corso (camera in movimento, streaming, registrazione) fanno ripartire i frame.
+// --always-redraw torna al ciclo continuo.
+RidisegnoSuEventi ridisegno;
+
+// === Simulazione a passo fisso (simulation.h) ===
+// Camera (WASD, mouse, zoom) e vincolo alle mura avanzano su un thread dedicato a frequenzaSimulazione tick
+// al secondo (--sim-rate HZ); il ciclo interattivo raccoglie l'input e disegna lo stato interpolato tra gli
+// ultimi due tick. Batch, golden e headless impostano la camera direttamente e non avviano il thread.
+Simulazione simulazione;
+double frequenzaSimulazione = 120.0;
+
+// === Job system (thread_pool.h, frame_jobs.h) ===
+// Il pool condiviso fa work stealing tra code per worker; --bench-jobs [N] esegue i lavori per frame (animazione,
+// culling, binning delle luci, lista di rendering) su una scena sintetica di N istanze con 1, 2, 4... thread,
+// senza contesto OpenGL, ed esce.
+int benchJobsIstanze = 0;
+
+// === Modalita' headless (--headless) ===
+// Nessuna finestra visibile, niente ImGui ne' input: si renderizza in un FBO di dimensione arbitraria.
+bool headless = false;
+int headlessWidth = SCR_WIDTH;   // --size WxH
+int headlessHeight = SCR_HEIGHT;
+int headlessFrames = 1;          // --frames N
+std::string batchManifest;       // --batch manifest.txt (implica --headless)
+std::string headlessCapture;     // --capture prefisso: salva ogni frame headless come prefisso_NNNN.png
+
+// === Test di regressione visiva (--golden scenari.txt cartella_riferimenti [--golden-update]) ===
+std::string goldenManifest, goldenDir;
+bool goldenUpdate = false;
+int goldenSoglia = 8;                // differenza per canale oltre la quale un pixel e' considerato diverso
+double goldenMaxRmse = 2.0;          // RMSE massimo accettato (0..255)
+double goldenMaxPercentuale = 0.5;   // percentuale massima di pixel oltre soglia
+
+// === Cattura asincrona del framebuffer (PBO ring + thread di codifica) ===
+AsyncReadback* readback = nullptr;
+bool screenshotRichiesto = false;  // F12: salva uno screenshot
+bool registrazioneAttiva = false;  // F11: cattura continua di tutti i frame
+int numeroCattura = 0;
+
 // Camera globale (gestisce posizione e orientamento dell'osservatore)
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = (float)SCR_WIDTH / 2.0; // Ultima posizione X del mouse
 float lastY = (float)SCR_HEIGHT / 2.0; // Ultima posizione Y del mouse
 bool firstMouse = true; // Serve per evitare salti all'inizio
 
-// Variabili per il tempo (utile per movimenti smooth e indipendenti dal frame rate)
-float deltaTime = 0.0f; // Tempo tra un frame e l'altro
-float lastFrame = 0.0f; // Tempo dell'ultimo frame
-
 // === Floor (Pavimento) ===
 // Vertici del piano: posizione (3), normale (3), texcoord (2), tangente (3), bitangente (3)
 // Le texcoord vanno da 0 a 10 per ripetere la texture 10 volte su X e Z
@@ -142,10 +321,20 @@ Model* wall_e = nullptr;
 Model* arcade = nullptr;
 Model* cap = nullptr;
 
-struct MaterialSet {
-    std::string diffuse;
-    std::string gloss;
-    std::string normal;
+struct ModelloScena { Model** modello; const char* path; };
+const ModelloScena modelliScena[] = {
+    { &personaggio, "Progetto/x64/Debug/erika.obj" },
+    { &farettodx, "Progetto/x64/Debug/faretto_dx.obj" },
+    { &farettosx, "Progetto/x64/Debug/faretto_sx.obj" },
+    { &telo, "Progetto/x64/Debug/studio.obj" },
+    { &ventola, "Progetto/x64/Debug/ceiling_fan_(OBJ).obj" },
+    { &divanetto, "Progetto/x64/Debug/leather_chair(OBJ).obj" },
+    { &divanetto2, "Progetto/x64/Debug/leather_chair(OBJ).obj" },
+    { &tavolino, "Progetto/x64/Debug/Table.obj" },
+    { &fotocamera, "Progetto/x64/Debug/camera.obj" },
+    { &wall_e, "Progetto/x64/Debug/wall-e.obj" },
+    { &arcade, "Progetto/x64/Debug/arcade.obj" },
+    { &cap, "Progetto/x64/Debug/cap.obj" }
 };
 
 // Array di materiali disponibili
@@ -200,6 +389,9 @@ string materiali_sel[] = {
 };
 
 
+// Identificativi brevi usati nei manifest del rendering batch e nei nomi dei file
+const char* materiali_id[] = { "originale", "boucle", "leather", "redcotton", "similino", "towelcotton", "denim" };
+
 string scena_sel[] = {
     "Studio",
     "white background + cemento",
@@ -207,10 +399,33 @@ string scena_sel[] = {
     "white background + quarzite",
 	"white background + tiles"
 };
+const char* scena_id[] = { "studio", "cemento", "marmo", "quarzite", "piastrelle" };
+const int numScene = sizeof(scena_id) / sizeof(scena_id[0]);
+
+// Inquadrature predefinite per il rendering batch (foto prodotto)
+struct CameraPreset {
+    const char* nome;
+    glm::vec3 posizione;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+CameraPreset cameraPresets[] = {
+    { "fronte",    glm::vec3( 0.0f, 1.20f,  2.5f), -90.0f,  -5.0f, 45.0f },
+    { "retro",     glm::vec3( 0.0f, 1.20f, -2.5f),  90.0f,  -5.0f, 45.0f },
+    { "lato",      glm::vec3( 2.5f, 1.20f,  0.0f), 180.0f,  -5.0f, 45.0f },
+    { "dettaglio", glm::vec3( 0.0f, 1.35f,  1.2f), -90.0f, -10.0f, 30.0f }
+};
+const int numCameraPresets = sizeof(cameraPresets) / sizeof(CameraPreset);
+
+// Texture dei materiali del personaggio: caricate al primo utilizzo, con prefetch del successivo
+// e scaricamento LRU oltre il budget di memoria video (--material-budget MB)
+MaterialCache* materialCache = nullptr;
+int materialBudgetMB = 512;
 
-unsigned int personaggioDiffuse[numMateriali];
-unsigned int personaggioGloss[numMateriali];
-unsigned int personaggioNormal[numMateriali];
+// Pacchetto unico degli asset (tools/assetpack, vedi vfs.h): --pack file.pak, altrimenti assets.pak se presente.
+// Senza pacchetto gli asset si leggono dai file sciolti come prima.
+std::string assetPack;
 
 // Variabile per dimmare la luminosità delle due luci laterali
 float intensitaLuciLaterali = 0.3f;
@@ -224,30 +439,213 @@ unsigned int floorQuarziteDiffuse, floorQuarziteNormal, floorQuarzitegloss;
 unsigned int floorTilesDiffuse, floorTilesNormal, floorTilesgloss;
 unsigned int floorTilesMDiffuse, floorTilesMNormal, floorTilesMgloss;
 
-int main()
+// Materiali di soffitto, pavimenti e muri: tutti in una tabella, cosi' i file si leggono in anticipo
+// (vfs::prefetch) mentre si crea il contesto OpenGL
+struct MaterialeAmbiente {
+    const char* diffuse;
+    const char* normal;
+    const char* gloss;
+    unsigned int* d;
+    unsigned int* n;
+    unsigned int* g;
+};
+const MaterialeAmbiente materialiAmbiente[] = {
+    { // soffitto
+        "./Progetto/x64/Debug/tex/soffitto/Ceiling_Drop_Tiles_001_basecolor.jpg",
+        "./Progetto/x64/Debug/tex/soffitto/Ceiling_Drop_Tiles_001_normal.jpg",
+        "./Progetto/x64/Debug/tex/soffitto/Ceiling_Drop_Tiles_001_gloss.jpg",
+        &ceilingDiffuse, &ceilingNormal, &ceilinggloss
+    },
+    { // pavimento in cemento (Poliigon)
+        "./Progetto/x64/Debug/tex/pavimento_cemento/Poliigon_ConcreteFloorPoured_7656_BaseColor.jpg",
+        "./Progetto/x64/Debug/tex/pavimento_cemento/Poliigon_ConcreteFloorPoured_7656_Normal.png",
+        "./Progetto/x64/Debug/tex/pavimento_cemento/Poliigon_ConcreteFloorPoured_7656_gloss.jpg",
+        &floorDiffuse, &floorNormal, &floorgloss
+    },
+    { // piastrelle Marble
+        "./Progetto/x64/Debug/tex/pavimento_stelle/Patterned_Marble_Tiles_vichadav_8K_BaseColor.jpg",
+        "./Progetto/x64/Debug/tex/pavimento_stelle/Patterned_Marble_Tiles_vichadav_8K_Normal.jpg",
+        "./Progetto/x64/Debug/tex/pavimento_stelle/Patterned_Marble_Tiles_vichadav_8K_gloss.jpg",
+        &floorTilesMDiffuse, &floorTilesMNormal, &floorTilesMgloss
+    },
+    { // quarzite
+        "./Progetto/x64/Debug/tex/pavimento_quarzite/Poliigon_quarzite_5212_BaseColor.jpg",
+        "./Progetto/x64/Debug/tex/pavimento_quarzite/Poliigon_quarzite_5212_Normal.png",
+        "./Progetto/x64/Debug/tex/pavimento_quarzite/Poliigon_quarzite_5212_gloss.jpg",
+        &floorQuarziteDiffuse, &floorQuarziteNormal, &floorQuarzitegloss
+    },
+    { // piastrelle
+        "./Progetto/x64/Debug/tex/pavimento_piastrelle/Poliigon_TilesCeramicWhite_6956_BaseColor.jpg",
+        "./Progetto/x64/Debug/tex/pavimento_piastrelle/Poliigon_TilesCeramicWhite_6956_Normal.png",
+        "./Progetto/x64/Debug/tex/pavimento_piastrelle/Poliigon_TilesCeramicWhite_6956_gloss.jpg",
+        &floorTilesDiffuse, &floorTilesNormal, &floorTilesgloss
+    },
+    { // muri
+        "./Progetto/x64/Debug/tex/muri/Poliigon_PlasterPainted_7664_BaseColor.jpg",
+        "./Progetto/x64/Debug/tex/muri/Poliigon_PlasterPainted_7664_Normal.png",
+        "./Progetto/x64/Debug/tex/muri/Poliigon_PlasterPainted_7664_gloss.jpg",
+        &wallDiffuse, &wallNormal, &wallgloss
+    }
+};
+
+int main(int argc, char** argv)
 {
-    // Inizializza GLFW e imposta versione OpenGL
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    // Crea la finestra principale
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Graphics Programming Univr - Fabric Simulation", NULL, NULL);
-    if (window == NULL)
+    // Gloss impacchettata nell'alpha della diffuse (glossPacking, vedi model.h e gloss_pack.h):
+    // due texture per materiale invece di tre, disattivabile con --no-gloss-packing
+    glossPacking = true;
+
+    // Parsing degli argomenti da riga di comando
+    for (int i = 1; i < argc; ++i)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        std::string arg = argv[i];
+        if (arg == "--headless")
+            headless = true;
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight) != 2 || headlessWidth <= 0 || headlessHeight <= 0)
+            {
+                std::cout << "Dimensione non valida, atteso WxH" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+            headlessFrames = std::max(1, atoi(argv[++i]));
+        else if (arg == "--capture" && i + 1 < argc)
+            headlessCapture = argv[++i];
+        else if (arg == "--golden" && i + 2 < argc)
+        {
+            goldenManifest = argv[++i];
+            goldenDir = argv[++i];
+            headless = true;
+        }
+        else if (arg == "--golden-update")
+            goldenUpdate = true;
+        else if (arg == "--no-gloss-packing")
+            glossPacking = false;
+        else if (arg == "--material-budget" && i + 1 < argc)
+            materialBudgetMB = std::max(1, atoi(argv[++i]));
+        else if (arg == "--mdi")
+            mdiRichiesto = true;
+        else if (arg == "--no-material-table")
+            tabellaRichiesta = false;
+        else if (arg == "--depth-prepass" && i + 1 < argc)
+        {
+            std::string modo = argv[++i];
+            prePassProfondita.modo = modo == "on" ? PrePassProfondita::Acceso
+                                   : modo == "off" ? PrePassProfondita::Spento : PrePassProfondita::Automatico;
+        }
+        else if (arg == "--deferred")
+            deferred = true;
+        else if (arg == "--practicals" && i + 1 < argc)
+            numeroLuciPratiche = std::max(0, std::min(atoi(argv[++i]), (int)LuciPratiche::MAX));
+        else if (arg == "--bench-deferred")
+        {
+            benchDeferred = true;
+            headless = true;
+        }
+        else if (arg == "--frame-budget" && i + 1 < argc)
+            risoluzioneDinamica.budgetMs = std::max(1.0f, (float)atof(argv[++i]));
+        else if (arg == "--no-dynamic-resolution")
+            risoluzioneDinamica.attiva = false;
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+            cadenzaFrame.frameInVolo = std::max(1, std::min(atoi(argv[++i]), (int)CadenzaFrame::MAX_IN_VOLO));
+        else if (arg == "--swap-interval" && i + 1 < argc)
+            swapInterval = std::max(0, atoi(argv[++i]));
+        else if (arg == "--always-redraw")
+            ridisegno.attivo = false;
+        else if (arg == "--sim-rate" && i + 1 < argc)
+            frequenzaSimulazione = std::max(10.0, std::min(atof(argv[++i]), 1000.0));
+        else if (arg == "--bench-jobs")
+            benchJobsIstanze = i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]) ? std::max(1, atoi(argv[++i])) : 100000;
+        else if (arg == "--no-lod")
+            selettoreLod.attivo = false;
+        else if (arg == "--shadow-lod-bias" && i + 1 < argc)
+            lodBiasOmbre = std::max(0, atoi(argv[++i]));
+        else if (arg == "--pack" && i + 1 < argc)
+            assetPack = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc)
+        {
+            batchManifest = argv[++i];
+            headless = true;
+        }
+        else
+            std::cout << "Argomento ignorato: " << arg << std::endl;
     }
-    glfwMakeContextCurrent(window);
-    // Imposta le callback per input e resize
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
 
-    // Disabilita il cursore per un'esperienza FPS (mouse catturato)
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // Il benchmark del job system non usa asset ne' OpenGL
+    if (benchJobsIstanze > 0)
+        return runBenchJobs(benchJobsIstanze);
+
+    // Il pacchetto va montato prima di qualunque lettura di asset e prima dei thread di caricamento
+    if (!assetPack.empty())
+        vfs::mount(assetPack);
+    else if (vfs::exists("assets.pak"))
+        vfs::mount("assets.pak");
+    auto inizioCaricamento = std::chrono::high_resolution_clock::now();
+
+    // Lettura asincrona (AsyncIO: io_uring su Linux, thread altrove) di shader, modelli e texture di ambiente,
+    // tutti in un unico gruppo: i file arrivano mentre si crea il contesto e i decoder li prendono dal VFS
+    std::vector<std::string> daLeggere = { "progetto.vs", "progetto.fs", "shadow_mapping.vs", "shadow_mapping.fs", "deferred.vs", "deferred.fs", "upscale.fs" };
+    for (const ModelloScena& m : modelliScena)
+        daLeggere.push_back(meshcache::fileToLoad(m.path));
+    for (const MaterialeAmbiente& m : materialiAmbiente)
+    {
+        daLeggere.push_back(dds::fileToLoad(m.diffuse));
+        daLeggere.push_back(dds::fileToLoad(m.normal));
+        daLeggere.push_back(dds::fileToLoad(m.gloss));
+    }
+    vfs::prefetch(daLeggere);
+
+    GLFWwindow* window = NULL;
+    if (headless)
+    {
+        // Contesto offscreen (OSMesa / EGL / finestra nascosta), nessun input
+        window = mdiRichiesto ? createHeadlessContext(4, 3) : NULL;
+        if (window == NULL)
+            window = createHeadlessContext();
+        if (window == NULL)
+            return -1;
+        glfwMakeContextCurrent(window);
+    }
+    else
+    {
+        // Inizializza GLFW e imposta versione OpenGL
+        glfwInit();
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        // Crea la finestra principale (con --mdi prima si prova un contesto 4.3)
+        if (mdiRichiesto)
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Graphics Programming Univr - Fabric Simulation", NULL, NULL);
+        }
+        if (window == NULL)
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Graphics Programming Univr - Fabric Simulation", NULL, NULL);
+        }
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        // Imposta le callback per input e resize
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetWindowRefreshCallback(window, window_refresh_callback);
+        glfwGetFramebufferSize(window, &finestraWidth, &finestraHeight);
+        if (swapInterval >= 0)
+            glfwSwapInterval(swapInterval);
+
+        // Disabilita il cursore per un'esperienza FPS (mouse catturato)
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     // Inizializza GLAD per caricare le funzioni OpenGL
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -256,104 +654,82 @@ int main()
         return -1;
     }
 
-    // === IMGUI: Inizializzazione ===
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO(); (void)io;
-    ImGui::StyleColorsDark();
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330");
-
-    ImFont* font = io.Fonts->AddFontFromFileTTF("Progetto/x64/Debug/Font/Timeline.ttf", 18.0f * (SCR_HEIGHT / 1080.0f));
-    io.FontDefault = font;
-
-
+    // === IMGUI: Inizializzazione (solo in modalita' interattiva) ===
+    if (!headless)
+    {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO(); (void)io;
+        ImGui::StyleColorsDark();
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330");
+
+        ImFont* font = io.Fonts->AddFontFromFileTTF("Progetto/x64/Debug/Font/Timeline.ttf", 18.0f * (SCR_HEIGHT / 1080.0f));
+        io.FontDefault = font;
+
+        // Streaming progressivo delle texture di modelli e ambienti: il primo frame usa le mipmap piccole,
+        // la risoluzione piena arriva nei frame successivi. In headless (batch, golden) il caricamento
+        // resta sincrono, cosi' ogni immagine e' renderizzata con le texture complete.
+        textureStreamer = new TextureStreamer();
+        textureStreamer->setFeedback(true);
+    }
 
     // Carica i modelli 3D DOPO aver creato il contesto OpenGL
-    personaggio = new Model("Progetto/x64/Debug/erika.obj");
-    farettodx = new Model("Progetto/x64/Debug/faretto_dx.obj");
-    farettosx = new Model("Progetto/x64/Debug/faretto_sx.obj");
-    telo = new Model("Progetto/x64/Debug/studio.obj");
-    ventola = new Model("Progetto/x64/Debug/ceiling_fan_(OBJ).obj");
-    divanetto = new Model("Progetto/x64/Debug/leather_chair(OBJ).obj");
-    divanetto2 = new Model("Progetto/x64/Debug/leather_chair(OBJ).obj");
-    tavolino = new Model("Progetto/x64/Debug/Table.obj");
-    fotocamera = new Model("Progetto/x64/Debug/camera.obj");
-    wall_e = new Model("Progetto/x64/Debug/wall-e.obj");
-    arcade = new Model("Progetto/x64/Debug/arcade.obj");
-	cap = new Model("Progetto/x64/Debug/cap.obj");
-
-    // === Caricamento texture per tutti i materiali del personaggio ===
-
-    for (int i = 0; i < numMateriali; ++i) {
-        personaggioDiffuse[i] = loadTexture(materiali[i].diffuse.c_str());
-        personaggioGloss[i] = loadTexture(materiali[i].gloss.c_str());
-        personaggioNormal[i] = loadTexture(materiali[i].normal.c_str());
-    }
+    for (const ModelloScena& m : modelliScena)
+        *m.modello = new Model(m.path);
+    // Tutte le mesh dei modelli condividono un VAO e due buffer (mesh_arena.h)
+    MeshArena<Vertex>::Stats arena = MeshArena<Vertex>::shared().getStats();
+    std::cout << "Arena mesh: " << arena.mesh << " mesh, " << arena.vertici << " vertici, " << arena.indici
+              << " indici (" << (arena.capacitaVertici * sizeof(Vertex) + arena.capacitaIndici * 4) / 1048576.0
+              << " MB allocati, " << arena.ricrescite << " ricrescite)" << std::endl;
+    if (mdiRichiesto && drawIndiretto.init((GLADloadproc)glfwGetProcAddress))
+        std::cout << "Multi-draw indirect attivo" << std::endl;
+
+    // === Texture dei materiali del personaggio ===
+    // Il set corrente viene caricato al primo frame, il successivo (tasto M) intanto si decodifica in background
+    materialCache = new MaterialCache(materiali, numMateriali, (size_t)materialBudgetMB * 1024 * 1024, glossPacking);
+    materialCache->prefetch((materialeCorrente + 1) % numMateriali);
 
 
     // Abilita il depth test per la corretta visualizzazione 3D (gestione profondità)
     glEnable(GL_DEPTH_TEST);
 
     // Carica e compila gli shader (vertex e fragment)
-    Shader shader("progetto.vs", "progetto.fs");
-    Shader shadowMappingShader("shadow_mapping.vs", "shadow_mapping.fs");
+    // Permutazione del materiale: con il packing la gloss si legge dall'alpha della diffuse
+    // Con il multi-draw indirect gli shader passano a GLSL 4.30 per leggere la tabella dei disegni (SSBO)
+    std::string permutazione = drawIndiretto.attivo() ? "#version 430 core\n#define DISEGNO_INDIRETTO\n" : "";
+    std::string permutazioneMateriale = permutazione + (glossPacking ? "#define GLOSS_IN_DIFFUSE_ALPHA\n" : "");
+    Shader shader("progetto.vs", "progetto.fs", nullptr, permutazioneMateriale.empty() ? nullptr : permutazioneMateriale.c_str());
+    Shader shadowMappingShader("shadow_mapping.vs", "shadow_mapping.fs", nullptr, permutazione.empty() ? nullptr : permutazione.c_str());
+
+    // Matrici per oggetto dal buffer circolare: gli offset rispettano l'allineamento degli uniform buffer
+    GLint allineamentoUbo = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &allineamentoUbo);
+    bufferOggetti.init((GLADloadproc)glfwGetProcAddress, 64 * 1024, allineamentoUbo);
+    std::string permutazionePrePass = permutazione + "#define PREPASS_PROFONDITA\n";
+    Shader prePass("shadow_mapping.vs", "shadow_mapping.fs", nullptr, permutazionePrePass.c_str());
+    prePassShader = &prePass;
+    // Percorso deferred: geometry pass con la stessa permutazione del materiale, lighting pass a schermo intero
+    std::string permutazioneGBuffer = permutazioneMateriale + "#define GBUFFER\n";
+    Shader gbufferPass("progetto.vs", "progetto.fs", nullptr, permutazioneGBuffer.c_str());
+    Shader lightingPass("deferred.vs", "deferred.fs");
+    gbufferShader = &gbufferPass;
+    deferredShader = &lightingPass;
+    Shader upscale("deferred.vs", "upscale.fs");
+    upscaleShader = &upscale;
+    for (Shader* s : { &shader, &shadowMappingShader, prePassShader, gbufferShader })
+        glUniformBlockBinding(s->ID, glGetUniformBlockIndex(s->ID, "Oggetto"), 0);
+    luciPratiche.init();
+    luciPratiche.genera(numeroLuciPratiche);
+    for (Shader* s : { &shader, deferredShader })
+        LuciPratiche::collega(s->ID);
+    std::cout << "Buffer circolare: " << (bufferOggetti.getStats().persistente ? "mappato in modo persistente" : "mappato a ogni scrittura")
+              << ", " << BufferCircolare::FRAME_IN_VOLO << " frame in volo" << std::endl;
 
     // Configurazione shadow mapping per luceDx, luceSx e luce centrale
-    unsigned int depthMapFBOLuceDx, depthMapFBOLuceSx;
-    unsigned int depthMapFBOCentro, depthMapLuceCentro; // Shadow map centrale
-    glGenFramebuffers(1, &depthMapFBOLuceDx);
-    glGenFramebuffers(1, &depthMapFBOLuceSx);
-    glGenFramebuffers(1, &depthMapFBOCentro);
-    unsigned int depthMapLuceDx, depthMapLuceSx;
-    glGenTextures(1, &depthMapLuceDx);
-    glGenTextures(1, &depthMapLuceSx);
-    glGenTextures(1, &depthMapLuceCentro);
-
-    // LuceDx
-    glBindTexture(GL_TEXTURE_2D, depthMapLuceDx);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-        SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOLuceDx);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapLuceDx, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // LuceSx
-    glBindTexture(GL_TEXTURE_2D, depthMapLuceSx);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-        SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOLuceSx);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapLuceSx, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // Shadow map centrale
-    // Inizializzazione texture e FBO centrale
-    glBindTexture(GL_TEXTURE_2D, depthMapLuceCentro);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-        SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOCentro);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapLuceCentro, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    createShadowMap(depthMapFBOLuceDx, depthMapLuceDx);
+    createShadowMap(depthMapFBOLuceSx, depthMapLuceSx);
+    createShadowMap(depthMapFBOCentro, depthMapLuceCentro);
 
     // === Inizializzazione VAO/VBO/EBO per il piano ===
     glGenVertexArrays(1, &planeVAO);
@@ -410,32 +786,6 @@ int main()
     glEnableVertexAttribArray(4);
     glBindVertexArray(0);
 
-    // === Caricamento texture per il Soffitto ===
-    ceilingDiffuse = loadTexture("./Progetto/x64/Debug/tex/soffitto/Ceiling_Drop_Tiles_001_basecolor.jpg");
-    ceilingNormal = loadTexture("./Progetto/x64/Debug/tex/soffitto/Ceiling_Drop_Tiles_001_normal.jpg");
-    ceilinggloss = loadTexture("./Progetto/x64/Debug/tex/soffitto/Ceiling_Drop_Tiles_001_gloss.jpg");
-
-    // === Caricamento texture Poliigon per il pavimento ===
-    floorDiffuse = loadTexture("./Progetto/x64/Debug/tex/pavimento_cemento/Poliigon_ConcreteFloorPoured_7656_BaseColor.jpg");
-    floorNormal = loadTexture("./Progetto/x64/Debug/tex/pavimento_cemento/Poliigon_ConcreteFloorPoured_7656_Normal.png");
-    floorgloss = loadTexture("./Progetto/x64/Debug/tex/pavimento_cemento/Poliigon_ConcreteFloorPoured_7656_gloss.jpg");
-
-    // === Caricamento texture piastrelle Marble ===
-    floorTilesMDiffuse = loadTexture("./Progetto/x64/Debug/tex/pavimento_stelle/Patterned_Marble_Tiles_vichadav_8K_BaseColor.jpg");
-    floorTilesMNormal = loadTexture("./Progetto/x64/Debug/tex/pavimento_stelle/Patterned_Marble_Tiles_vichadav_8K_Normal.jpg");
-    floorTilesMgloss = loadTexture("./Progetto/x64/Debug/tex/pavimento_stelle/Patterned_Marble_Tiles_vichadav_8K_gloss.jpg");
-
-
-    // === Caricamento texture quarzite ===
-    floorQuarziteDiffuse = loadTexture("./Progetto/x64/Debug/tex/pavimento_quarzite/Poliigon_quarzite_5212_BaseColor.jpg");
-    floorQuarziteNormal = loadTexture("./Progetto/x64/Debug/tex/pavimento_quarzite/Poliigon_quarzite_5212_Normal.png");
-    floorQuarzitegloss = loadTexture("./Progetto/x64/Debug/tex/pavimento_quarzite/Poliigon_quarzite_5212_gloss.jpg");
-
-    // === Caricamento texture piastrelle ===
-    floorTilesDiffuse = loadTexture("./Progetto/x64/Debug/tex/pavimento_piastrelle/Poliigon_TilesCeramicWhite_6956_BaseColor.jpg");
-    floorTilesNormal = loadTexture("./Progetto/x64/Debug/tex/pavimento_piastrelle/Poliigon_TilesCeramicWhite_6956_Normal.png");
-    floorTilesgloss = loadTexture("./Progetto/x64/Debug/tex/pavimento_piastrelle/Poliigon_TilesCeramicWhite_6956_gloss.jpg");
-
     // === Inizializzazione VAO/VBO/EBO per il muro ===
     glGenVertexArrays(1, &wallVAO);
     glGenBuffers(1, &wallVBO);
@@ -463,144 +813,243 @@ int main()
     glEnableVertexAttribArray(4);
     glBindVertexArray(0);
 
-    // === Caricamento texture per i muri ===
-    wallDiffuse = loadTexture("./Progetto/x64/Debug/tex/muri/Poliigon_PlasterPainted_7664_BaseColor.jpg");
-    wallNormal = loadTexture("./Progetto/x64/Debug/tex/muri/Poliigon_PlasterPainted_7664_Normal.png");
-    wallgloss = loadTexture("./Progetto/x64/Debug/tex/muri/Poliigon_PlasterPainted_7664_gloss.jpg");
+    // === Caricamento texture di soffitto, pavimenti e muri ===
+    for (const MaterialeAmbiente& m : materialiAmbiente)
+        caricaMateriale(m.diffuse, m.normal, m.gloss, *m.d, *m.n, *m.g);
 
-    // Ciclo di rendering principale
-    while (!glfwWindowShouldClose(window))
+    if (drawIndiretto.attivo())
     {
-        // Calcola il tempo trascorso tra un frame e l'altro (per movimenti smooth)
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // Gestione input tastiera/mouse
-        processInput(window);
-
-
-
-        // Rendering shadow map per luceDx
-        glm::vec3 luceDxPos(1.25f, 1.9f, 1.6f);
-        glm::vec3 luceDxTarget(0.5f, 1.4f, 0.5f);
-        glm::vec3 luceDxDir = glm::normalize(luceDxTarget - luceDxPos);
-        float near_plane = 0.1f, far_plane = 20.0f;
-        float ortho_size = 10.0f;
-        glm::mat4 luceDxProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size, near_plane, far_plane);
-        glm::mat4 luceDxView = glm::lookAt(luceDxPos, luceDxTarget, glm::vec3(0, 1, 0));
-        glm::mat4 luceDxSpaceMatrix = luceDxProjection * luceDxView;
-        shadowMappingShader.use();
-        shadowMappingShader.setMat4("lightSpaceMatrix", luceDxSpaceMatrix);
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOLuceDx);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        RenderScene(shadowMappingShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // Rendering shadow map per luceSx
-        glm::vec3 luceSxPos(-1.25f, 1.9f, 1.6f);
-        glm::vec3 luceSxTarget(-0.4f, 1.4f, 0.4f);
-        glm::vec3 luceSxDir = glm::normalize(luceSxTarget - luceSxPos);
-        glm::mat4 luceSxProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size, near_plane, far_plane);
-        glm::mat4 luceSxView = glm::lookAt(luceSxPos, luceSxTarget, glm::vec3(0, 1, 0));
-        glm::mat4 luceSxSpaceMatrix = luceSxProjection * luceSxView;
-        shadowMappingShader.use();
-        shadowMappingShader.setMat4("lightSpaceMatrix", luceSxSpaceMatrix);
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOLuceSx);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        RenderScene(shadowMappingShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // Rendering shadow map per luce centrale
-        glm::vec3 luceCentroPos = 0.5f * (luceDxPos + luceSxPos) + glm::vec3(0.0f, 0.5f, 0.7f); // più alta
-        glm::vec3 luceCentroTarget = 0.5f * (luceDxTarget + luceSxTarget) + glm::vec3(0.0f, 0.5f, 0.0f); // punta più in basso
-        glm::mat4 luceCentroProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size, near_plane, far_plane);
-        glm::mat4 luceCentroView = glm::lookAt(luceCentroPos, luceCentroTarget, glm::vec3(0, 1, 0));
-        glm::mat4 luceCentroSpaceMatrix = luceCentroProjection * luceCentroView;
-        shadowMappingShader.use();
-        shadowMappingShader.setMat4("lightSpaceMatrix", luceCentroSpaceMatrix);
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOCentro);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        RenderScene(shadowMappingShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        const size_t nPiano = sizeof(planeVertices) / sizeof(float);
+        meshSoffitto = creaQuad(ceilingVertices, sizeof(ceilingVertices) / sizeof(float), ceilingIndices, 6, ceilingDiffuse, ceilingNormal, ceilinggloss);
+        meshMuro = creaQuad(wallVertices, sizeof(wallVertices) / sizeof(float), wallIndices, 6, wallDiffuse, wallNormal, wallgloss);
+        meshPavimento[0] = creaQuad(planeVertices, nPiano, planeIndices, 6, floorDiffuse, floorNormal, floorgloss);
+        meshPavimento[1] = creaQuad(planeVertices, nPiano, planeIndices, 6, floorTilesMDiffuse, floorTilesMNormal, floorTilesMgloss);
+        meshPavimento[2] = creaQuad(planeVertices, nPiano, planeIndices, 6, floorQuarziteDiffuse, floorQuarziteNormal, floorQuarzitegloss);
+        meshPavimento[3] = creaQuad(planeVertices, nPiano, planeIndices, 6, floorTilesDiffuse, floorTilesNormal, floorTilesgloss);
+        if (tabellaRichiesta && tabellaMateriali.init((GLADloadproc)glfwGetProcAddress))
+        {
+            for (const ModelloScena& m : modelliScena)
+                for (const Mesh& mesh : (*m.modello)->meshes)
+                    tabellaMateriali.registra(TabellaMateriali::terna(mesh));
+            for (Mesh* q : { meshSoffitto, meshMuro, meshPavimento[0], meshPavimento[1], meshPavimento[2], meshPavimento[3] })
+                tabellaMateriali.registra(TabellaMateriali::terna(*q));
+            tabellaMateriali.costruisci(textureStreamer);
+            drawIndiretto.setTabella(&tabellaMateriali);
+            TabellaMateriali::Stats ts = tabellaMateriali.getStats();
+            std::cout << "Tabella dei materiali: " << ts.materiali << " materiali in " << ts.array << " array (" << ts.strati
+                      << " strati, " << ts.bytes / 1048576.0 << " MB), " << ts.esclusi << " esclusi" << std::endl;
+        }
+    }
 
-        //Rendering normale della scena con shadow mapping
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f); //sfondo bianco
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    vfs::Stats vfsStats = vfs::getStats();
+    std::cout << "Asset caricati in " << std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizioCaricamento).count()
+              << " s: " << vfsStats.dalPacchetto << " file dal pacchetto (" << vfsStats.entries << " voci), "
+              << vfsStats.inAnticipo << " letti in anticipo, " << vfsStats.dalDisco << " dal disco" << std::endl;
+    AsyncIO::Stats ioStats = AsyncIO::shared().getStats();
+    if (ioStats.file > 0)
+        std::cout << "I/O asincrono (" << ioStats.backend << "): " << ioStats.file << " file, " << ioStats.bytes / (1024 * 1024) << " MB, "
+                  << (ioStats.secondi > 0.0 ? ioStats.bytes / (1024.0 * 1024.0) / ioStats.secondi : 0.0) << " MB/s, profondita' media "
+                  << ioStats.profonditaMedia << " (max " << ioStats.profonditaMax << ")" << std::endl;
+
+    // Un thread di codifica per ogni due core: la compressione PNG non deve rubare CPU al rendering
+    int encoderThreads = std::max(1, (int)std::thread::hardware_concurrency() / 2);
+    readback = new AsyncReadback(3, encoderThreads);
+
+    int exitCode = 0;
+    if (!goldenManifest.empty())
+    {
+        // il codice di uscita diverso da zero fa fallire la pipeline di CI: 1 regressioni, 2 solo riferimenti
+        // mancanti (checkout senza immagini: vanno generate, non e' una regressione)
+        int mancanti = 0;
+        int falliti = runGolden(goldenManifest, goldenDir, goldenUpdate, shader, shadowMappingShader, mancanti);
+        exitCode = falliti != 0 ? 1 : (mancanti != 0 ? 2 : 0);
+    }
+    else if (!batchManifest.empty())
+    {
+        int errori = runBatch(batchManifest, shader, shadowMappingShader);
+        if (errori != 0)
+            std::cout << "Batch terminato con " << errori << " errori" << std::endl;
+        exitCode = errori != 0 ? 1 : 0;
+    }
+    else if (benchDeferred)
+        exitCode = runBenchDeferred(shader, shadowMappingShader) != 0 ? 1 : 0;
+    else if (headless)
+    {
+        // Rendering offscreen: stessi pass della modalita' interattiva, ma dentro un FBO
+        OffscreenTarget target;
+        if (!target.create(headlessWidth, headlessHeight))
+            return -1;
+
+        auto inizio = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < headlessFrames; ++frame)
+        {
+            RenderFrame(shader, shadowMappingShader, target.FBO, target.width, target.height);
+            if (!headlessCapture.empty())
+            {
+                char nome[32];
+                snprintf(nome, sizeof(nome), "_%04d.png", frame);
+                readback->capture(target.FBO, target.width, target.height, headlessCapture + nome, true);
+                readback->poll();
+            }
+        }
+        glFinish();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inizio).count();
+        std::cout << "Headless " << target.width << "x" << target.height << ": " << headlessFrames
+                  << " frame, " << ms / headlessFrames << " ms/frame" << std::endl;
+        std::cout << "Triangoli per pass (LOD / pieni): scena " << triangoliPasso[0] << " / " << triangoliPassoPieni[0];
+        for (int p = 1; p < 4; ++p)
+            std::cout << ", ombra " << p << " " << triangoliPasso[p] << " / " << triangoliPassoPieni[p];
+        std::cout << std::endl;
+        BufferCircolare::Stats bs = bufferOggetti.getStats();
+        std::cout << "Buffer circolare: " << bs.bytesFrame << " byte per frame, " << bs.attese << " attese sui fence ("
+                  << bs.msAttesa << " ms), " << bs.ricrescite << " ricrescite" << std::endl;
+        std::cout << "Percorso " << (deferred ? "deferred" : "forward") << ", " << luciPratiche.numero() << " luci pratiche" << std::endl;
+        PrePassProfondita::Stats pp = prePassProfondita.getStats();
+        std::cout << "Pre-pass di profondita': " << (pp.attivo ? "attivo" : "spento") << " nell'ultimo frame, frammenti calcolati "
+                  << pp.frammentiSenza << " senza / " << pp.frammentiCon << " con (overdraw " << pp.overdraw << ")" << std::endl;
+        if (!headlessCapture.empty())
+        {
+            readback->flush();
+            double s = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizio).count();
+            AsyncReadback::Stats st = readback->getStats();
+            std::cout << "Cattura: " << st.scritti << " frame scritti, " << st.scritti / s << " frame/s catturati, "
+                      << st.attese << " attese sul ring PBO, " << st.falliti << " scritture fallite" << std::endl;
+            if (st.falliti > 0)
+                exitCode = 1;
+        }
 
-        shader.use();
-        // Calcola le matrici di proiezione e vista (telecamera)
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
+        target.destroy();
+    }
 
-        shader.setMat4("projection", projection); // Passa la matrice di proiezione allo shader
-        shader.setMat4("view", view); // Passa la matrice di vista allo shader
+    // Il thread di simulazione parte dalla camera iniziale; la stanza e' quella di processInput prima del thread
+    if (!headless)
+        simulazione.avvia(camera, glm::vec3(room_min_x, room_min_y + 0.2f, room_min_z),
+                          glm::vec3(room_max_x, room_max_y - 0.2f, room_max_z), frequenzaSimulazione);
 
-        // Matrice modello identità 
-        glm::mat4 model = glm::mat4(1.0f);
-        // Riduci la scala del modello
-        model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model); // Passa la matrice modello allo shader
+    // Ciclo di rendering principale
+    while (!headless && !glfwWindowShouldClose(window))
+    {
+        // Niente da disegnare: la finestra resta sull'ultimo frame e il ciclo dorme fino al prossimo evento.
+        // La camera si muove solo con WASD premuti; streaming e registrazione cambiano l'immagine a ogni frame
+        bool movimento = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS ||
+                         glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+        bool inCorso = movimento || simulazione.inMovimento() || textureStreamer->getStats().inStreaming > 0 || registrazioneAttiva || screenshotRichiesto;
+        if (!ridisegno.serve(inCorso))
+        {
+            readback->poll();
+            ridisegno.attendi();
+            continue;
+        }
 
-        // Passa la posizione della camera sia come viewPos che come lightPos (spotlight)
-        shader.setVec3("viewPos", camera.Position); // Posizione osservatore
-        shader.setVec3("lightPos", camera.Position); // La luce segue la camera
-        // Passa anche la direzione della camera come spotlightDir
-        shader.setVec3("spotlightDir", camera.Front); // Direzione della spotlight
-
-
-        shader.setVec3("luceDxPos", luceDxPos);
-        shader.setVec3("luceDxDir", luceDxDir);
-        shader.setFloat("luceDxAngle", 191.0f);
-        shader.setMat4("luceDxSpaceMatrix", luceDxSpaceMatrix);
-        shader.setVec3("luceSxPos", luceSxPos);
-        shader.setVec3("luceSxDir", luceSxDir);
-        shader.setFloat("luceSxAngle", 191.0f);
-        shader.setMat4("luceSxSpaceMatrix", luceSxSpaceMatrix);
-        shader.setFloat("intensitaLuciLaterali", intensitaLuciLaterali);
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, depthMapLuceDx);
-        shader.setInt("shadowMapLuceDx", 5);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_2D, depthMapLuceSx);
-        shader.setInt("shadowMapLuceSx", 6);
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, depthMapLuceCentro);
-        shader.setInt("shadowMapLuceCentro", 7);
-        shader.setMat4("luceCentroSpaceMatrix", luceCentroSpaceMatrix);
-
-        // Renderizza la scena
-        RenderScene(shader);
+        // Aspetta la GPU se ha gia' frameInVolo frame da completare, poi legge l'input: l'attesa viene prima
+        // degli eventi, cosi' non si aggiunge alla latenza tra input e immagine
+        cadenzaFrame.iniziaFrame();
+        glfwPollEvents();
 
+        // Gestione input tastiera/mouse: il movimento va alla simulazione, i comandi restano su questo thread
+        processInput(window);
+        // Camera interpolata tra gli ultimi due tick della simulazione
+        Simulazione::Istantanea stato = simulazione.interpola();
+        camera = Camera(stato.posizione, glm::vec3(0.0f, 1.0f, 0.0f), stato.yaw, stato.pitch);
+        camera.Zoom = stato.zoom;
+        materialCache->update();
+        textureStreamer->update();
+        tabellaMateriali.aggiorna();
+
+        // Shadow pass + pass principale alla risoluzione scelta dal tempo GPU, poi upscaling nel default framebuffer
+        int nativaW = std::max(1, finestraWidth), nativaH = std::max(1, finestraHeight);
+        risoluzioneDinamica.iniziaFrame(nativaW, nativaH);
+        risoluzioneDinamica.iniziaMisura();
+        RenderFrame(shader, shadowMappingShader, risoluzioneDinamica.fbo(), risoluzioneDinamica.width(), risoluzioneDinamica.height(),
+                    nativaW, nativaH);
+        risoluzioneDinamica.fineMisura();
+        risoluzioneDinamica.presenta(*upscaleShader, 0, nativaW, nativaH);
 
         // Inizio frame ImGui
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         // Finestra custom
-        ImGui::SetNextWindowSize(ImVec2(SCR_WIDTH * 0.215f, SCR_HEIGHT * 0.12f), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(SCR_WIDTH * 0.215f, SCR_HEIGHT * 0.36f), ImGuiCond_Always);
         ImGui::Begin("Info");
         ImGui::Text("Materiale corrente: %s", materiali_sel[materialeCorrente].c_str());
         ImGui::Text("Intensita luci laterali: %s", intensitaLabels[livelloIntensitaLuci]);
         ImGui::Text("Ambiente: %s", scena_sel[sceneState].c_str());
+        if (registrazioneAttiva)
+        {
+            AsyncReadback::Stats st = readback->getStats();
+            ImGui::Text("REC: %llu scritti, %llu scartati, %llu falliti", st.scritti, st.scartati, st.falliti);
+        }
+        MaterialCache::Stats ms = materialCache->getStats();
+        ImGui::Text("Materiali: %d residenti, %.0f / %.0f MB", ms.residenti, ms.bytesResidenti / 1048576.0, ms.budget / 1048576.0);
+        ImGui::Text("Hit %llu  Miss %llu  Prefetch %llu  Evict %llu", ms.hit, ms.miss, ms.prefetch, ms.evizioni);
+        TextureStreamer::Stats ts = textureStreamer->getStats();
+        ImGui::Text("Texture: %.0f MB residenti, %d in streaming", ts.bytesResidenti / 1048576.0, ts.inStreaming);
+        ImGui::Text("Triangoli: scena %zu / %zu, ombre %zu / %zu", triangoliPasso[0], triangoliPassoPieni[0],
+                    triangoliPasso[1] + triangoliPasso[2] + triangoliPasso[3],
+                    triangoliPassoPieni[1] + triangoliPassoPieni[2] + triangoliPassoPieni[3]);
+        if (drawIndiretto.attivo())
+        {
+            DrawIndiretto::Stats ds = drawIndiretto.getStats();
+            ImGui::Text("MDI: %d chiamate per %d mesh, %llu ricostruzioni", ds.chiamate, ds.comandi, ds.ricostruzioni);
+        }
+        BufferCircolare::Stats bs = bufferOggetti.getStats();
+        ImGui::Text("Buffer circolare: %zu byte/frame, %llu attese (%.1f ms)", bs.bytesFrame, bs.attese, bs.msAttesa);
+        PrePassProfondita::Stats pp = prePassProfondita.getStats();
+        ImGui::Text("Pre-pass: %s, overdraw %.2f", pp.attivo ? "attivo" : "spento", pp.overdraw);
+        ImGui::Text("Percorso: %s, %d luci pratiche", deferred ? "deferred" : "forward", luciPratiche.numero());
+        RisoluzioneDinamica::Stats rd = risoluzioneDinamica.getStats();
+        ImGui::Text("Risoluzione: %dx%d (%.0f%%), GPU %.1f / %.1f ms", rd.width, rd.height, rd.scala * 100.0f, rd.msGpu, risoluzioneDinamica.budgetMs);
+        CadenzaFrame::Stats cf = cadenzaFrame.getStats();
+        ImGui::Text("Frame in volo: %d / %d, %.1f ms (+-%.1f), latenza %.1f ms", cf.inVolo, cadenzaFrame.frameInVolo,
+                    cf.msIntervallo, cf.msJitter, cf.msLatenza);
+        ImGui::Text("CPU %.1f ms, attesa GPU %.1f ms", cf.msCpu, cf.msAttesa);
+        RidisegnoSuEventi::Stats re = ridisegno.getStats();
+        ImGui::Text("Ridisegno: %s, %.0f fps, CPU %.0f%%, GPU %.0f%%", ridisegno.attivo ? "a eventi" : "continuo",
+                    re.fps, re.percentualeCpu, re.percentualeGpu);
+        ImGui::Text("Inattivo: %.0f s, CPU %.1f%%", re.secondiInattivo, re.percentualeCpuInattivo);
+        Simulazione::Stats si = simulazione.getStats();
+        ImGui::Text("Simulazione: %.0f Hz, tick %.3f ms, %llu saltati, %llu pause%s", si.hz, si.msTick, si.saltati, si.pause,
+                    si.inPausa ? " (in pausa)" : "");
+        ThreadPool::Stats js = ThreadPool::shared().getStats();
+        ImGui::Text("Job: %d thread, %llu lavori, %llu furti, inattivo %.0f%%", js.thread, js.lavori, js.furti, js.percentualeInattivo);
+        if (tabellaMateriali.attiva())
+        {
+            TabellaMateriali::Stats tm = tabellaMateriali.getStats();
+            ImGui::Text("Tabella: %d materiali, %d array, %.0f MB, %llu copie", tm.materiali, tm.array, tm.bytes / 1048576.0, tm.copie);
+        }
         ImGui::End();
 
         // Rendering ImGui
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+        // Cattura asincrona del back buffer (screenshot F12 / registrazione F11)
+        if (screenshotRichiesto || registrazioneAttiva)
+        {
+            char nome[64];
+            snprintf(nome, sizeof(nome), registrazioneAttiva ? "cattura_%05d.png" : "screenshot_%03d.png", numeroCattura);
+            // senza attesa: se l'anello e' pieno il frame si scarta, lo screenshot si riprova al frame successivo
+            if (readback->capture(0, nativaW, nativaH, nome))
+            {
+                numeroCattura++;
+                screenshotRichiesto = false;
+            }
+        }
+        readback->poll();
 
-        // Scambia i buffer e gestisce gli eventi di input
+        // Fence e timestamp del frame, poi scambia i buffer
+        cadenzaFrame.fineFrame();
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        ridisegno.frameDisegnato(risoluzioneDinamica.getStats().msGpu);
     }
 
-    // Libera le risorse e termina l'applicazione
+    simulazione.ferma();
+
+    // Libera le risorse e termina l'applicazione (attende la scrittura delle catture in coda)
+    delete readback;
+    delete materialCache;
+    delete textureStreamer;
     delete personaggio;
     delete farettodx;
     delete farettosx;
@@ -614,31 +1063,646 @@ int main()
     delete arcade;
     delete cap;
 
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (!headless)
+    {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
     glfwTerminate();
-    return 0;
+    return exitCode;
+}
+
+// Crea FBO e texture di profondita' per una shadow map (bordo bianco = fuori dalla luce non in ombra)
+void createShadowMap(unsigned int& fbo, unsigned int& depthMap)
+{
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &depthMap);
+    glBindTexture(GL_TEXTURE_2D, depthMap);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
+        SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Imposta il pass corrente per la scelta dei livelli di dettaglio e ne azzera il conteggio dei triangoli
+static void iniziaPassoLod(int passo, const meshlod::Vista& vista)
+{
+    passoLod = passo;
+    vistaLod = vista;
+    triangoliPasso[passo] = 0;
+    triangoliPassoPieni[passo] = 0;
 }
 
-// Gestione input tastiera: aggiorna la posizione della camera in base ai tasti premuti
+// Esegue un frame completo: shadow map per luceDx, luceSx e luce centrale,
+// poi il rendering della scena con shadow mapping nel framebuffer targetFBO (0 = finestra).
+// Con la risoluzione dinamica si renderizza nella porzione width x height di un target targetW x targetH:
+// il G-buffer segue il target, cosi' non viene riallocato a ogni passo di scala
+void RenderFrame(Shader& shader, Shader& shadowMappingShader, unsigned int targetFBO, int width, int height, int targetW, int targetH)
+{
+    bufferOggetti.iniziaFrame();
+
+    // Rendering shadow map per luceDx
+    glm::vec3 luceDxPos(1.25f, 1.9f, 1.6f);
+    glm::vec3 luceDxTarget(0.5f, 1.4f, 0.5f);
+    glm::vec3 luceDxDir = glm::normalize(luceDxTarget - luceDxPos);
+    float near_plane = 0.1f, far_plane = 20.0f;
+    float ortho_size = 10.0f;
+    glm::mat4 luceDxProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size, near_plane, far_plane);
+    glm::mat4 luceDxView = glm::lookAt(luceDxPos, luceDxTarget, glm::vec3(0, 1, 0));
+    glm::mat4 luceDxSpaceMatrix = luceDxProjection * luceDxView;
+
+    // Rendering shadow map per luceSx
+    glm::vec3 luceSxPos(-1.25f, 1.9f, 1.6f);
+    glm::vec3 luceSxTarget(-0.4f, 1.4f, 0.4f);
+    glm::vec3 luceSxDir = glm::normalize(luceSxTarget - luceSxPos);
+    glm::mat4 luceSxProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size, near_plane, far_plane);
+    glm::mat4 luceSxView = glm::lookAt(luceSxPos, luceSxTarget, glm::vec3(0, 1, 0));
+    glm::mat4 luceSxSpaceMatrix = luceSxProjection * luceSxView;
+
+    // Rendering shadow map per luce centrale
+    glm::vec3 luceCentroPos = 0.5f * (luceDxPos + luceSxPos) + glm::vec3(0.0f, 0.5f, 0.7f); // più alta
+    glm::vec3 luceCentroTarget = 0.5f * (luceDxTarget + luceSxTarget) + glm::vec3(0.0f, 0.5f, 0.0f); // punta più in basso
+    glm::mat4 luceCentroProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size, near_plane, far_plane);
+    glm::mat4 luceCentroView = glm::lookAt(luceCentroPos, luceCentroTarget, glm::vec3(0, 1, 0));
+    glm::mat4 luceCentroSpaceMatrix = luceCentroProjection * luceCentroView;
+
+    // Le luci sono fisse: le shadow map cambiano solo con l'ambiente (sceneState)
+    if (shadowSceneState != sceneState)
+    {
+        shadowMappingShader.use();
+        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+        // proiezione ortografica: i pixel per unita' non dipendono dalla distanza dalla luce
+        meshlod::Vista vistaOmbra;
+        vistaOmbra.pixelPerUnita = SHADOW_HEIGHT / (2.0f * ortho_size);
+        vistaOmbra.ortografica = true;
+        vistaOmbra.bias = lodBiasOmbre;
+
+        shadowMappingShader.setMat4("lightSpaceMatrix", luceDxSpaceMatrix);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOLuceDx);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        iniziaPassoLod(1, vistaOmbra);
+        RenderScene(shadowMappingShader);
+
+        shadowMappingShader.setMat4("lightSpaceMatrix", luceSxSpaceMatrix);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOLuceSx);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        iniziaPassoLod(2, vistaOmbra);
+        RenderScene(shadowMappingShader);
+
+        shadowMappingShader.setMat4("lightSpaceMatrix", luceCentroSpaceMatrix);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOCentro);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        iniziaPassoLod(3, vistaOmbra);
+        RenderScene(shadowMappingShader);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        shadowSceneState = sceneState;
+        shadowPassCount++;
+    }
+
+    //Rendering normale della scena con shadow mapping
+    // (con il percorso deferred la scena va nel G-buffer e il target riceve il lighting pass)
+    bool percorsoDeferred = deferred && gbufferShader && gbuffer.assicura(std::max(width, targetW), std::max(height, targetH));
+    glBindFramebuffer(GL_FRAMEBUFFER, percorsoDeferred ? gbuffer.FBO : targetFBO);
+    glViewport(0, 0, width, height);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f); //sfondo bianco
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    shader.use();
+    // Calcola le matrici di proiezione e vista (telecamera)
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+    glm::mat4 view = camera.GetViewMatrix();
+
+    shader.setMat4("projection", projection); // Passa la matrice di proiezione allo shader
+    shader.setMat4("view", view); // Passa la matrice di vista allo shader
+
+    // Matrice modello identità 
+    glm::mat4 model = glm::mat4(1.0f);
+    // Riduci la scala del modello
+    model = glm::scale(model, glm::vec3(1.0f));
+    impostaModello(model); // Passa la matrice modello allo shader
+
+    // Shadow map sulle unita' 5, 6, 7
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, depthMapLuceDx);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, depthMapLuceSx);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, depthMapLuceCentro);
+
+    // Luci e shadow map: uniform comuni al pass forward e al lighting pass deferred
+    auto impostaLuci = [&](Shader& s) {
+        // Passa la posizione della camera sia come viewPos che come lightPos (spotlight)
+        s.setVec3("viewPos", camera.Position); // Posizione osservatore
+        s.setVec3("lightPos", camera.Position); // La luce segue la camera
+        // Passa anche la direzione della camera come spotlightDir
+        s.setVec3("spotlightDir", camera.Front); // Direzione della spotlight
+
+        s.setVec3("luceDxPos", luceDxPos);
+        s.setVec3("luceDxDir", luceDxDir);
+        s.setFloat("luceDxAngle", 191.0f);
+        s.setMat4("luceDxSpaceMatrix", luceDxSpaceMatrix);
+        s.setVec3("luceSxPos", luceSxPos);
+        s.setVec3("luceSxDir", luceSxDir);
+        s.setFloat("luceSxAngle", 191.0f);
+        s.setMat4("luceSxSpaceMatrix", luceSxSpaceMatrix);
+        s.setFloat("intensitaLuciLaterali", intensitaLuciLaterali);
+        s.setInt("shadowMapLuceDx", 5);
+        s.setInt("shadowMapLuceSx", 6);
+        s.setInt("shadowMapLuceCentro", 7);
+        s.setMat4("luceCentroSpaceMatrix", luceCentroSpaceMatrix);
+    };
+    impostaLuci(shader);
+
+    // Geometry pass del percorso deferred: solo le matrici della camera
+    Shader& scena = percorsoDeferred ? *gbufferShader : shader;
+    if (percorsoDeferred)
+    {
+        scena.use();
+        scena.setMat4("projection", projection);
+        scena.setMat4("view", view);
+    }
+
+    // Livelli di dettaglio dalla camera: pixel per unita' a distanza 1 con la proiezione corrente
+    meshlod::Vista vista;
+    vista.occhio = camera.Position;
+    vista.pixelPerUnita = height / (2.0f * tanf(glm::radians(camera.Zoom) * 0.5f));
+    iniziaPassoLod(0, vista);
+
+    // Pre-pass di profondita': stessi livelli di dettaglio del pass principale (la selezione del passo 0 non
+    // cambia se ripetuta con la stessa vista), altrimenti GL_EQUAL scarterebbe la geometria diversa
+    bool prePass = prePassShader && prePassProfondita.inizia();
+    if (prePass)
+    {
+        prePassShader->use();
+        prePassShader->setMat4("projection", projection);
+        prePassShader->setMat4("view", view);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        prePassInCorso = true;
+        RenderScene(*prePassShader);
+        prePassInCorso = false;
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        scena.use();
+        iniziaPassoLod(0, vista);
+    }
+
+    // Renderizza la scena (raccogliendo il feedback dei livelli di mipmap per lo streaming)
+    mipFeedbackAttivo = textureStreamer != nullptr;
+    mipFeedbackViewProj = projection * view;
+    mipFeedbackAltezza = height;
+    if (prePassShader)
+        prePassProfondita.iniziaMisura(prePass);
+    RenderScene(scena);
+    if (prePassShader)
+        prePassProfondita.fineMisura();
+    mipFeedbackAttivo = false;
+    if (prePass)
+    {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    // Lighting pass del percorso deferred: un triangolo a schermo intero dal G-buffer al target
+    if (percorsoDeferred)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glViewport(0, 0, width, height);
+        glDisable(GL_DEPTH_TEST);
+        deferredShader->use();
+        impostaLuci(*deferredShader);
+        deferredShader->setMat4("inversaViewProj", glm::inverse(projection * view));
+        deferredShader->setVec2("scala", (float)width / gbuffer.width, (float)height / gbuffer.height);
+        gbuffer.bindTexture(0);
+        deferredShader->setInt("gAlbedoGloss", 0);
+        deferredShader->setInt("gNormale", 1);
+        deferredShader->setInt("gProfondita", 2);
+        gbuffer.disegnaSchermoIntero();
+        glEnable(GL_DEPTH_TEST);
+        shader.use();
+    }
+    bufferOggetti.fineFrame();
+}
+
+// Un job del rendering batch: una combinazione materiale x ambiente x camera
+struct BatchJob {
+    int materiale;
+    int scena;
+    int camera;
+    int width;
+    int height;
+    std::string output;
+};
+
+// Risolve un campo del manifest: "*" = tutti, un indice numerico oppure un identificativo
+static std::vector<int> parseBatchField(const std::string& campo, const char* const* ids, int count)
+{
+    std::vector<int> valori;
+    for (int i = 0; i < count; ++i)
+        if (campo == "*" || campo == ids[i] || campo == std::to_string(i))
+            valori.push_back(i);
+    return valori;
+}
+
+static void replaceAll(std::string& s, const std::string& da, const std::string& a)
+{
+    for (size_t pos = s.find(da); pos != std::string::npos; pos = s.find(da, pos + a.size()))
+        s.replace(pos, da.size(), a);
+}
+
+// Legge un manifest di job. Formato, una riga per gruppo di job ('#' = commento):
+//     <materiale> <ambiente> <camera> <WxH> <output>
+// materiale/ambiente/camera accettano un identificativo, un indice o "*" (tutti);
+// nell'output {materiale}, {ambiente} e {camera} vengono sostituiti.
+// I job vengono ordinati per ambiente, risoluzione e materiale: le shadow map (che dipendono solo
+// dall'ambiente) e il render target vengono riusati tra job consecutivi. Ritorna il numero di righe non valide.
+static int loadBatchManifest(const std::string& manifestPath, std::vector<BatchJob>& jobs)
+{
+    std::ifstream manifest(manifestPath);
+    if (!manifest)
+    {
+        std::cout << "ERROR::BATCH:: manifest non trovato: " << manifestPath << std::endl;
+        return 1;
+    }
+
+    std::vector<const char*> cameraIds;
+    for (int i = 0; i < numCameraPresets; ++i)
+        cameraIds.push_back(cameraPresets[i].nome);
+
+    int errori = 0;
+    std::string riga;
+    int numeroRiga = 0;
+    while (std::getline(manifest, riga))
+    {
+        numeroRiga++;
+        size_t commento = riga.find('#');
+        if (commento != std::string::npos)
+            riga = riga.substr(0, commento);
+        std::istringstream iss(riga);
+        std::string mat, scena, cam, size, output;
+        if (!(iss >> mat))
+            continue;
+        int w = 0, h = 0;
+        if (!(iss >> scena >> cam >> size >> output) || sscanf(size.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+        {
+            std::cout << "ERROR::BATCH:: riga " << numeroRiga << " non valida" << std::endl;
+            errori++;
+            continue;
+        }
+        std::vector<int> mats = parseBatchField(mat, materiali_id, numMateriali);
+        std::vector<int> scene = parseBatchField(scena, scena_id, numScene);
+        std::vector<int> cams = parseBatchField(cam, cameraIds.data(), numCameraPresets);
+        if (mats.empty() || scene.empty() || cams.empty())
+        {
+            std::cout << "ERROR::BATCH:: riga " << numeroRiga << ": materiale, ambiente o camera sconosciuti" << std::endl;
+            errori++;
+            continue;
+        }
+        for (int m : mats)
+            for (int sc : scene)
+                for (int c : cams)
+                {
+                    BatchJob job = { m, sc, c, w, h, output };
+                    replaceAll(job.output, "{materiale}", materiali_id[m]);
+                    replaceAll(job.output, "{ambiente}", scena_id[sc]);
+                    replaceAll(job.output, "{camera}", cameraPresets[c].nome);
+                    jobs.push_back(job);
+                }
+    }
+
+    // Ordina i job per minimizzare i cambi costosi: ambiente (3 shadow map + texture del pavimento),
+    // poi risoluzione (ricreazione del render target), poi materiale (texture del personaggio)
+    std::stable_sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) {
+        if (a.scena != b.scena) return a.scena < b.scena;
+        if (a.width != b.width) return a.width < b.width;
+        if (a.height != b.height) return a.height < b.height;
+        if (a.materiale != b.materiale) return a.materiale < b.materiale;
+        return a.camera < b.camera;
+    });
+    return errori;
+}
+
+// Imposta materiale, ambiente e inquadratura di un job
+static void applyBatchJob(const BatchJob& job)
+{
+    sceneState = job.scena;
+    materialeCorrente = job.materiale;
+    // i job sono ordinati per materiale: il prossimo set si decodifica mentre si renderizza questo
+    materialCache->prefetch((materialeCorrente + 1) % numMateriali);
+    const CameraPreset& preset = cameraPresets[job.camera];
+    camera = Camera(preset.posizione, glm::vec3(0.0f, 1.0f, 0.0f), preset.yaw, preset.pitch);
+    camera.Zoom = preset.zoom;
+    // salto di camera: i livelli di dettaglio si scelgono da capo, senza isteresi
+    selettoreLod.reset();
+}
+
+// Esegue i job del manifest (vedi loadBatchManifest). Estensione .exr = OpenEXR, altrimenti PNG.
+// Tutte le texture sono gia' residenti; le immagini vengono lette e codificate in modo asincrono.
+int runBatch(const std::string& manifestPath, Shader& shader, Shader& shadowMappingShader)
+{
+    std::vector<BatchJob> jobs;
+    int errori = loadBatchManifest(manifestPath, jobs);
+
+    std::cout << "Batch: " << jobs.size() << " immagini da " << manifestPath << std::endl;
+
+    OffscreenTarget target;
+    int shadowPassIniziali = shadowPassCount;
+    int targetCreati = 0;
+    double msRender = 0.0;
+    unsigned long long fallitiIniziali = readback->getStats().falliti;
+    auto inizio = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const BatchJob& job = jobs[i];
+        if (job.width != target.width || job.height != target.height)
+        {
+            // le letture ancora in volo puntano al target corrente
+            readback->flush();
+            if (!target.create(job.width, job.height))
+            {
+                errori++;
+                continue;
+            }
+            targetCreati++;
+        }
+
+        applyBatchJob(job);
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        RenderFrame(shader, shadowMappingShader, target.FBO, target.width, target.height);
+
+        // Lettura asincrona: la codifica avviene sui worker mentre si renderizza il job successivo
+        readback->capture(target.FBO, target.width, target.height, job.output, true);
+        readback->poll();
+        msRender += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        std::cout << "[" << (i + 1) << "/" << jobs.size() << "] " << job.output << std::endl;
+    }
+    readback->flush();
+    target.destroy();
+    // le scritture fallite sui worker contano come errori del batch
+    errori += (int)(readback->getStats().falliti - fallitiIniziali);
+
+    double secondi = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizio).count();
+    std::cout << "Batch completato: " << jobs.size() << " immagini in " << secondi << " s ("
+              << (secondi > 0.0 ? jobs.size() / secondi : 0.0) << " immagini/s)" << std::endl;
+    std::cout << "  render+readback " << msRender << " ms, "
+              << (shadowPassCount - shadowPassIniziali) << " aggiornamenti shadow map, "
+              << targetCreati << " render target creati" << std::endl;
+    return errori;
+}
+
+// Test di regressione visiva: renderizza gli scenari del manifest (stesso formato del batch, l'output e'
+// il nome dell'immagine di riferimento dentro refDir) e li confronta con le immagini salvate.
+// Uno scenario fallisce se l'RMSE supera goldenMaxRmse o se piu' di goldenMaxPercentuale% dei pixel
+// differisce oltre goldenSoglia; in quel caso viene scritta la heatmap <nome>.diff.png accanto al riferimento.
+// Con update=true le immagini di riferimento vengono (ri)generate. Ritorna il numero di scenari falliti;
+// gli scenari senza immagine di riferimento non falliscono ma vengono saltati e contati in mancanti.
+int runGolden(const std::string& manifestPath, const std::string& refDir, bool update, Shader& shader, Shader& shadowMappingShader, int& mancanti)
+{
+    mancanti = 0;
+    std::vector<BatchJob> jobs;
+    int falliti = loadBatchManifest(manifestPath, jobs);
+
+    OffscreenTarget target;
+    std::vector<unsigned char> pixels, immagine;
+    auto inizio = std::chrono::high_resolution_clock::now();
+    double msConfronto = 0.0;
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const BatchJob& job = jobs[i];
+        std::string refPath = refDir + "/" + job.output;
+        if (job.width != target.width || job.height != target.height)
+        {
+            if (!target.create(job.width, job.height))
+            {
+                falliti++;
+                continue;
+            }
+        }
+        applyBatchJob(job);
+        RenderFrame(shader, shadowMappingShader, target.FBO, target.width, target.height);
+
+        // lettura sincrona RGBA, ribaltata top-down come le immagini su disco
+        size_t stride = (size_t)job.width * 4;
+        pixels.resize(stride * job.height);
+        immagine.resize(pixels.size());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target.FBO);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        for (int y = 0; y < job.height; ++y)
+            memcpy(&immagine[y * stride], &pixels[(job.height - 1 - y) * stride], stride);
+
+        if (update)
+        {
+            std::vector<unsigned char> rgb((size_t)job.width * job.height * 3);
+            for (size_t p = 0; p < (size_t)job.width * job.height; ++p)
+                memcpy(&rgb[p * 3], &immagine[p * 4], 3);
+            if (!imageio::writePNG(refPath, job.width, job.height, 3, rgb.data()))
+                falliti++;
+            std::cout << "[GOLDEN] aggiornato " << refPath << std::endl;
+            continue;
+        }
+
+        FILE* esiste = fopen(refPath.c_str(), "rb");
+        if (!esiste)
+        {
+            std::cout << "[GOLDEN] SKIP " << job.output << ": riferimento mancante" << std::endl;
+            mancanti++;
+            continue;
+        }
+        fclose(esiste);
+
+        int w, h, n;
+        unsigned char* ref = stbi_load(refPath.c_str(), &w, &h, &n, 4);
+        if (!ref || w != job.width || h != job.height)
+        {
+            std::cout << "[GOLDEN] FAIL " << job.output << ": riferimento illeggibile o di dimensione diversa" << std::endl;
+            stbi_image_free(ref);
+            falliti++;
+            continue;
+        }
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        ImageDiffResult diff = diffImagesRGBA(immagine.data(), ref, (size_t)w * h, goldenSoglia);
+        msConfronto += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+        bool ok = diff.rmse <= goldenMaxRmse && diff.percentualeOltreSoglia <= goldenMaxPercentuale;
+        std::cout << "[GOLDEN] " << (ok ? "ok   " : "FAIL ") << job.output << "  rmse " << diff.rmse
+                  << "  max " << diff.maxError << "  oltre soglia " << diff.percentualeOltreSoglia << "%" << std::endl;
+        if (!ok)
+        {
+            std::vector<unsigned char> heat = diffHeatmapRGB(immagine.data(), ref, (size_t)w * h);
+            imageio::writePNG(refPath + ".diff.png", w, h, 3, heat.data());
+            falliti++;
+        }
+        stbi_image_free(ref);
+    }
+    target.destroy();
+
+    double secondi = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizio).count();
+    std::cout << "[GOLDEN] " << jobs.size() << " scenari, " << falliti << " falliti, " << mancanti << " senza riferimento, "
+              << (secondi > 0.0 ? 60.0 * jobs.size() / secondi : 0.0) << " confronti/min (diff " << msConfronto << " ms)" << std::endl;
+    if (mancanti > 0)
+        std::cout << "[GOLDEN] riferimenti da generare (dopo averli verificati a occhio) con:" << std::endl
+                  << "[GOLDEN]   Progetto.exe --golden " << manifestPath << " " << refDir << " --golden-update" << std::endl;
+    return falliti;
+}
+
+// Confronto forward / deferred (--bench-deferred): per ogni risoluzione e numero di luci pratiche qualche frame
+// di riscaldamento (G-buffer, shader), poi la media su frameBench frame chiusi da glFinish, come la modalita'
+// headless. La scena e la camera sono quelle iniziali. Ritorna il numero di target non creati.
+int runBenchDeferred(Shader& shader, Shader& shadowMappingShader)
+{
+    const int risoluzioni[][2] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    const int numeriLuci[] = { 0, 16, 64, 256 };
+    const int frameBench = std::max(headlessFrames, 20);
+    bool deferredIniziale = deferred;
+    int luciIniziali = luciPratiche.numero();
+    int errori = 0;
+
+    std::cout << "[BENCH] forward / deferred, ms per frame (media di " << frameBench << " frame)" << std::endl;
+    OffscreenTarget target;
+    for (const auto& r : risoluzioni)
+    {
+        if (!target.create(r[0], r[1]))
+        {
+            errori++;
+            continue;
+        }
+        for (int luci : numeriLuci)
+        {
+            luciPratiche.genera(luci);
+            double ms[2];
+            for (int d = 0; d < 2; ++d)
+            {
+                deferred = d == 1;
+                for (int frame = 0; frame < 3; ++frame)
+                    RenderFrame(shader, shadowMappingShader, target.FBO, target.width, target.height);
+                glFinish();
+                auto inizio = std::chrono::high_resolution_clock::now();
+                for (int frame = 0; frame < frameBench; ++frame)
+                    RenderFrame(shader, shadowMappingShader, target.FBO, target.width, target.height);
+                glFinish();
+                ms[d] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - inizio).count() / frameBench;
+            }
+            char riga[128];
+            snprintf(riga, sizeof(riga), "[BENCH] %4dx%-4d %3d luci  forward %7.2f  deferred %7.2f  (%.2fx)",
+                     r[0], r[1], luci, ms[0], ms[1], ms[1] > 0.0 ? ms[0] / ms[1] : 0.0);
+            std::cout << riga << std::endl;
+        }
+    }
+    target.destroy();
+    std::cout << "[BENCH] G-buffer " << gbuffer.width << "x" << gbuffer.height << ": " << gbuffer.bytes() / 1048576.0 << " MB" << std::endl;
+
+    deferred = deferredIniziale;
+    luciPratiche.genera(luciIniziali);
+    return errori;
+}
+
+// Benchmark del job system (--bench-jobs [N]): per 1, 2, 4... thread fino ai core disponibili un pool dedicato
+// esegue il grafo dei lavori per frame (frame_jobs.h) su N istanze e 1024 luci, con la camera che ruota sulla
+// scena; qualche frame di riscaldamento, poi la media su frameBench frame. Le liste di rendering devono essere
+// identiche con ogni numero di thread. Ritorna 1 se non lo sono.
+int runBenchJobs(int istanze)
+{
+    const int frameBench = std::max(headlessFrames, 60);
+    const int luci = 1024;
+    int core = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> configurazioni;
+    for (int t = 1; t < core; t *= 2)
+        configurazioni.push_back(t);
+    configurazioni.push_back(core);
+
+    std::cout << "[BENCH] job system: " << istanze << " istanze, " << luci << " luci, " << core << " core, ms per frame (media di "
+              << frameBench << " frame)" << std::endl;
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 300.0f);
+    double msUnThread = 0.0;
+    std::vector<uint64_t> firmaRiferimento;
+    int errori = 0;
+    for (int thread : configurazioni)
+    {
+        ThreadPool pool(thread - 1);
+        LavoriFrame lavori(pool);
+        lavori.generaScenaSintetica(istanze, luci);
+        std::vector<uint64_t> firma;
+        double ms = 0.0;
+        for (int frame = -3; frame < frameBench; ++frame)
+        {
+            if (frame == 0)
+                pool.azzeraStats();
+            float yaw = glm::radians(6.0f * frame);
+            glm::vec3 occhio(0.0f, 20.0f, 0.0f);
+            glm::mat4 view = glm::lookAt(occhio, occhio + glm::vec3(cosf(yaw), -0.3f, sinf(yaw)), glm::vec3(0.0f, 1.0f, 0.0f));
+            lavori.esegui(frame / 60.0f, projection * view);
+            if (frame < 0)
+                continue;
+            ms += lavori.getStats().ms;
+            // firma FNV-1a della lista: chiavi e luci di ogni voce
+            uint64_t h = 1469598103934665603ull;
+            for (const LavoriFrame::Voce& v : lavori.listaRender())
+            {
+                h = (h ^ v.chiave) * 1099511628211ull;
+                for (int k = 0; k < v.numeroLuci; ++k)
+                    h = (h ^ (uint64_t)v.luci[k]) * 1099511628211ull;
+            }
+            firma.push_back(h);
+        }
+        ms /= frameBench;
+        if (thread == 1)
+        {
+            msUnThread = ms;
+            firmaRiferimento = firma;
+        }
+        bool uguali = firma == firmaRiferimento;
+        if (!uguali)
+        {
+            std::cout << "ERROR::BENCH_JOBS:: con " << thread << " thread la lista di rendering differisce da quella con 1 thread" << std::endl;
+            errori++;
+        }
+        LavoriFrame::Stats ls = lavori.getStats();
+        ThreadPool::Stats ps = pool.getStats();
+        char riga[160];
+        snprintf(riga, sizeof(riga), "[BENCH] %2d thread  %7.2f ms  (%.2fx)  visibili %d  furti %llu  inattivo %.0f%%",
+                 thread, ms, ms > 0.0 ? msUnThread / ms : 0.0, ls.visibili, ps.furti, ps.percentualeInattivo);
+        std::cout << riga << std::endl;
+    }
+    return errori > 0 ? 1 : 0;
+}
+
+// Gestione input tastiera: lo stato di WASD va alla simulazione; i comandi a pressione restano qui perche'
+// caricano risorse (cache dei materiali, luci pratiche) e richiedono il contesto OpenGL
 void processInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    // WASD: lo stato dei tasti va alla simulazione, che muove la camera a passo fisso
+    Simulazione::Input input;
+    input.avanti = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    input.indietro = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    input.sinistra = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    input.destra = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    simulazione.impostaInput(input);
 
     static bool mPressed = false;
     if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !mPressed) {
         materialeCorrente = (materialeCorrente + 1) % numMateriali;
+        materialCache->prefetch((materialeCorrente + 1) % numMateriali);
         mPressed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) {
@@ -672,19 +1736,68 @@ void processInput(GLFWwindow* window)
     }
 
 
-    // Vincola la posizione della camera all'interno delle mura
-    camera.Position.x = glm::clamp(camera.Position.x, room_min_x, room_max_x);
-    camera.Position.y = glm::clamp(camera.Position.y, room_min_y+0.2f, room_max_y-0.2f);
-    camera.Position.z = glm::clamp(camera.Position.z, room_min_z, room_max_z);
+    // --- G: percorso forward / deferred, P: numero di luci pratiche (0, 16, 64, 256) ---
+    static bool gPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !gPressed) {
+        deferred = !deferred;
+        gPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) {
+        gPressed = false;
+    }
+
+    static bool pPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !pPressed) {
+        int n = luciPratiche.numero();
+        luciPratiche.genera(n == 0 ? 16 : n < 64 ? 64 : n < LuciPratiche::MAX ? LuciPratiche::MAX : 0);
+        pPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+        pPressed = false;
+    }
+
+    // --- F: frame in volo (1, 2, 3) ---
+    static bool fPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS && !fPressed) {
+        cadenzaFrame.frameInVolo = cadenzaFrame.frameInVolo % CadenzaFrame::MAX_IN_VOLO + 1;
+        fPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE) {
+        fPressed = false;
+    }
+
+    // --- F12: screenshot, F11: avvia/ferma la registrazione continua ---
+    static bool f12Pressed = false;
+    if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS && !f12Pressed) {
+        screenshotRichiesto = true;
+        f12Pressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_RELEASE) {
+        f12Pressed = false;
+    }
+
+    static bool f11Pressed = false;
+    if (glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS && !f11Pressed) {
+        registrazioneAttiva = !registrazioneAttiva;
+        f11Pressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F11) == GLFW_RELEASE) {
+        f11Pressed = false;
+    }
+    // Il vincolo della camera all'interno delle mura e' applicato dalla simulazione a ogni tick
 }
 
 // Callback per il ridimensionamento della finestra: aggiorna la viewport OpenGL
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    ridisegno.invalida();
+    // dimensione nativa per il target della risoluzione dinamica e per l'aspect ratio della proiezione
+    finestraWidth = width;
+    finestraHeight = height;
 }
 
-// Callback per il movimento del mouse: aggiorna l'orientamento della camera
+// Callback per il movimento del mouse: la rotazione si applica al prossimo tick della simulazione
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
     float xpos = static_cast<float>(xposIn);
@@ -702,109 +1815,118 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    simulazione.aggiungiMouse(xoffset, yoffset);
+    ridisegno.invalida();
 }
 
-// Callback per lo scroll del mouse: aggiorna lo zoom della camera
+// Callback per lo scroll del mouse: lo zoom si applica al prossimo tick della simulazione
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    simulazione.aggiungiScroll(static_cast<float>(yoffset));
+    ridisegno.invalida();
+}
+
+// Callback per i tasti: ogni pressione o rilascio puo' cambiare la scena (materiale, luci, ambiente...),
+// gli effetti veri e propri restano in processInput
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    ridisegno.invalida();
+}
+
+// Callback per l'esposizione della finestra: il contenuto va ridisegnato (es. dopo essere stata coperta)
+void window_refresh_callback(GLFWwindow* window)
+{
+    ridisegno.invalida();
 }
 
 // Carica una texture da file e restituisce l'ID OpenGL della texture
 // (Non usata direttamente nel main, ma utile per estensioni future)
-unsigned int loadTexture(char const* path)
+unsigned int loadTexture(char const* path, const char* glossPath)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    std::string gloss = glossPath ? glossPath : "";
+    if (textureStreamer)
+        return textureStreamer->request(path, true, gloss);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Imposta i parametri di wrapping e filtering
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    // Se esiste la versione cotta da tools/texcook (DDS BCn con mipmap) la si usa al posto dell'immagine sorgente
+    size_t bytes;
+    return uploadTexture(decodeTexture(path, gloss), bytes);
+}
 
-    return textureID;
+void caricaMateriale(const char* diffusePath, const char* normalPath, const char* glossPath,
+                     unsigned int& diffuse, unsigned int& normal, unsigned int& gloss)
+{
+    diffuse = loadTexture(diffusePath, glossPacking ? glossPath : nullptr);
+    normal = loadTexture(normalPath);
+    gloss = glossPacking ? 0 : loadTexture(glossPath);
 }
 
-// Renderizza la scena per shadow mapping
-void RenderScene(Shader &shader)
+void bindMateriale(Shader& shader, unsigned int diffuse, unsigned int normal, unsigned int gloss)
 {
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, personaggioDiffuse[materialeCorrente]);
+    glBindTexture(GL_TEXTURE_2D, diffuse);
     shader.setInt("texture_diffuse1", 0);
-
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, personaggioNormal[materialeCorrente]);
+    glBindTexture(GL_TEXTURE_2D, normal);
     shader.setInt("texture_normal1", 1);
+    if (gloss)
+    {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, gloss);
+        shader.setInt("texture_specular1", 2);
+    }
+}
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, personaggioGloss[materialeCorrente]);
-    shader.setInt("texture_specular1", 2);
+// Renderizza la scena per shadow mapping
+void RenderScene(Shader &shader)
+{
+    const MaterialCache::Textures& materiale = materialCache->acquire(materialeCorrente);
+    bindMateriale(shader, materiale.diffuse, materiale.normal, materiale.gloss);
 
     // Modello del personaggio
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(1.0f));
-    shader.setMat4("model", model);
-    if (personaggio) personaggio->Draw(shader);
+    impostaModello(model);
+    disegnaModello(personaggio, shader, model);
+    feedbackModello(personaggio, model);
 
     // Modello della cappello
     model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(1.0f));
-    shader.setMat4("model", model);
-    if (cap) cap->Draw(shader);
+    impostaModello(model);
+    disegnaModello(cap, shader, model);
+    feedbackModello(cap, model);
 
     if (sceneState == 0) {
         // Tutti gli oggetti visibili
         // Modello del faretto dx
         model = glm::mat4(1.0f);
         model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model);
-        if(farettodx) farettodx->Draw(shader);
+        impostaModello(model);
+        disegnaModello(farettodx, shader, model);
+        feedbackModello(farettodx, model);
 
         // Modello del faretto sx
         model = glm::mat4(1.0f);
         model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model);
-        if(farettosx) farettosx->Draw(shader);
+        impostaModello(model);
+        disegnaModello(farettosx, shader, model);
+        feedbackModello(farettosx, model);
 
         // Modello del telo/rampa
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.01f, 0.0f));
         model = glm::scale(model, glm::vec3(0.6f));
-        shader.setMat4("model", model);
-        if(telo) telo->Draw(shader);
+        impostaModello(model);
+        disegnaModello(telo, shader, model);
+        feedbackModello(telo, model);
 
         // Modello della ventola
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 2.7f, 0.0f));
         model = glm::scale(model, glm::vec3(0.6f));
-        shader.setMat4("model", model);
-        if(ventola) ventola->Draw(shader);
+        impostaModello(model);
+        disegnaModello(ventola, shader, model);
+        feedbackModello(ventola, model);
 
         // Modello del divanetto
         model = glm::mat4(1.0f);
@@ -812,77 +1934,69 @@ void RenderScene(Shader &shader)
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0, 1, 0));
         model = glm::rotate(model, glm::radians(20.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model);
-        if(divanetto) divanetto->Draw(shader);
+        impostaModello(model);
+        disegnaModello(divanetto, shader, model);
+        feedbackModello(divanetto, model);
 
         // Modello del divanetto 2
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-2.0f, 0.01f, 5.5f));
         model = glm::rotate(model, glm::radians(160.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model);
-        if(divanetto2) divanetto2->Draw(shader);
+        impostaModello(model);
+        disegnaModello(divanetto2, shader, model);
+        feedbackModello(divanetto2, model);
 
         // Modello del tavolino
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.01f, 5.2f));
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, glm::vec3(0.03f));
-        shader.setMat4("model", model);
-        if(tavolino) tavolino->Draw(shader);
+        impostaModello(model);
+        disegnaModello(tavolino, shader, model);
+        feedbackModello(tavolino, model);
 
         // Modello della fotocamera
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.78f, 5.2f));
         model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model);
-        if(fotocamera) fotocamera->Draw(shader);
+        impostaModello(model);
+        disegnaModello(fotocamera, shader, model);
+        feedbackModello(fotocamera, model);
 
         // Modello della wall_e
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(8.5f, 0.01f, 6.2f));
         model = glm::rotate(model, glm::radians(50.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, glm::vec3(0.008f));
-        shader.setMat4("model", model);
-        if (wall_e) wall_e->Draw(shader);
+        impostaModello(model);
+        disegnaModello(wall_e, shader, model);
+        feedbackModello(wall_e, model);
 
         // Modello della macchina arcade
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-8.2f, 0.01f, 6.2f));
         model = glm::rotate(model, glm::radians(120.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, glm::vec3(1.0f));
-        shader.setMat4("model", model);
-        if (arcade) arcade->Draw(shader);
+        impostaModello(model);
+        disegnaModello(arcade, shader, model);
+        feedbackModello(arcade, model);
 
         // === Soffitto ===
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ceilingDiffuse);
-        shader.setInt("texture_diffuse1", 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, ceilingNormal);
-        shader.setInt("texture_normal1", 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, ceilinggloss);
-        shader.setInt("texture_specular1", 2);
+        if (!drawIndiretto.attivo())
+            bindMateriale(shader, ceilingDiffuse, ceilingNormal, ceilinggloss);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(-0.0029815f, 3.0f, 1.5337835f));
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(1, 0, 0));
         model = glm::scale(model, glm::vec3(9.288005f, 1.0f, 5.676001f));
-        shader.setMat4("model", model);
-        glBindVertexArray(ceilingVAO);        
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        impostaModello(model);
+        disegnaQuad(ceilingVAO, meshSoffitto, model);
+        feedbackQuad(ceilingVertices, sizeof(ceilingVertices) / sizeof(float), ceilingIndices, 6, model, ceilingDiffuse, ceilingNormal, ceilinggloss);
 
         // === Muri ===
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, wallDiffuse);
-        shader.setInt("texture_diffuse1", 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, wallNormal);
-        shader.setInt("texture_normal1", 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, wallgloss);
-        shader.setInt("texture_specular1", 2);
+        if (!drawIndiretto.attivo())
+            bindMateriale(shader, wallDiffuse, wallNormal, wallgloss);
 
         float wall_height = 3.0f;
         float wall_thickness = 1.0f;
@@ -893,87 +2007,179 @@ void RenderScene(Shader &shader)
         model = glm::mat4(1.0f);
         model = glm::translate(model, floor_center_position + glm::vec3(0.0f, 0.0f, -floor_size_z/2.0f - wall_thickness/2.0f - 2.34f));
         model = glm::scale(model, glm::vec3(floor_size_x, wall_height, wall_thickness));
-        shader.setMat4("model", model);
-        glBindVertexArray(wallVAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        impostaModello(model);
+        disegnaQuad(wallVAO, meshMuro, model);
+        feedbackQuad(wallVertices, sizeof(wallVertices) / sizeof(float), wallIndices, 6, model, wallDiffuse, wallNormal, wallgloss);
         // Front wall
         model = glm::mat4(1.0f);
         model = glm::translate(model, floor_center_position + glm::vec3(0.0f, 0.0f, floor_size_z/2.0f + wall_thickness/2.0f + 2.34f));
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, glm::vec3(floor_size_x, wall_height, wall_thickness));
-        shader.setMat4("model", model);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        impostaModello(model);
+        disegnaQuad(wallVAO, meshMuro, model);
+        feedbackQuad(wallVertices, sizeof(wallVertices) / sizeof(float), wallIndices, 6, model, wallDiffuse, wallNormal, wallgloss);
         // Left wall
         model = glm::mat4(1.0f);
         model = glm::translate(model, floor_center_position + glm::vec3(-floor_size_x/2.0f - wall_thickness/2.0f - 4.14f, 0.0f, 0.0f));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0,1,0));
         model = glm::scale(model, glm::vec3(floor_size_z, wall_height, wall_thickness));
-        shader.setMat4("model", model);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        impostaModello(model);
+        disegnaQuad(wallVAO, meshMuro, model);
+        feedbackQuad(wallVertices, sizeof(wallVertices) / sizeof(float), wallIndices, 6, model, wallDiffuse, wallNormal, wallgloss);
         // Right wall
         model = glm::mat4(1.0f);
         model = glm::translate(model, floor_center_position + glm::vec3(floor_size_x/2.0f + wall_thickness/2.0f + 4.14f, 0.0f, 0.0f));
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0, 1, 0));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0,1,0));
         model = glm::scale(model, glm::vec3(floor_size_z, wall_height, wall_thickness));
-        shader.setMat4("model", model);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        impostaModello(model);
+        disegnaQuad(wallVAO, meshMuro, model);
+        feedbackQuad(wallVertices, sizeof(wallVertices) / sizeof(float), wallIndices, 6, model, wallDiffuse, wallNormal, wallgloss);
     }
 
     // === Pavimento: scegli texture in base allo stato ===
+    unsigned int pavimentoDiffuse, pavimentoNormal, pavimentoGloss;
+    int pavimento;   // indice in meshPavimento
     if (sceneState == 3) {
         // Pavimento quarzite
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorQuarziteDiffuse);
-        shader.setInt("texture_diffuse1", 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, floorQuarziteNormal);
-        shader.setInt("texture_normal1", 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, floorQuarzitegloss);
-        shader.setInt("texture_specular1", 2);
+        pavimento = 2;
+        pavimentoDiffuse = floorQuarziteDiffuse;
+        pavimentoNormal = floorQuarziteNormal;
+        pavimentoGloss = floorQuarzitegloss;
     } else if (sceneState == 4) {
         // Pavimento piastrelle
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorTilesDiffuse);
-        shader.setInt("texture_diffuse1", 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, floorTilesNormal);
-        shader.setInt("texture_normal1", 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, floorTilesgloss);
-        shader.setInt("texture_specular1", 2);
-	}
-    else if (sceneState == 2) {
+        pavimento = 3;
+        pavimentoDiffuse = floorTilesDiffuse;
+        pavimentoNormal = floorTilesNormal;
+        pavimentoGloss = floorTilesgloss;
+    } else if (sceneState == 2) {
         // Pavimento piastrelle Marble
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorTilesMDiffuse);
-        shader.setInt("texture_diffuse1", 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, floorTilesMNormal);
-        shader.setInt("texture_normal1", 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, floorTilesMgloss);
-        shader.setInt("texture_specular1", 2);
+        pavimento = 1;
+        pavimentoDiffuse = floorTilesMDiffuse;
+        pavimentoNormal = floorTilesMNormal;
+        pavimentoGloss = floorTilesMgloss;
     } else {
         // Pavimento cemento
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorDiffuse);
-        shader.setInt("texture_diffuse1", 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, floorNormal);
-        shader.setInt("texture_normal1", 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, floorgloss);
-        shader.setInt("texture_specular1", 2);
+        pavimento = 0;
+        pavimentoDiffuse = floorDiffuse;
+        pavimentoNormal = floorNormal;
+        pavimentoGloss = floorgloss;
     }
+    if (!drawIndiretto.attivo())
+        bindMateriale(shader, pavimentoDiffuse, pavimentoNormal, pavimentoGloss);
 
     glm::vec3 floor_center_position = glm::vec3(-0.0029815f, 0.0f, 1.5337835f);
     model = glm::mat4(1.0f);
     model = glm::translate(model, floor_center_position);
     model = glm::scale(model, glm::vec3(100.0f, 1.0f, 100.0f));
-    shader.setMat4("model", model);
+    impostaModello(model);
+    disegnaQuad(planeVAO, meshPavimento[pavimento], model);
+    feedbackQuad(planeVertices, sizeof(planeVertices) / sizeof(float), planeIndices, 6, model, pavimentoDiffuse, pavimentoNormal, pavimentoGloss);
 
-    glBindVertexArray(planeVAO);
+    // Modelli e quad accodati: una chiamata per pass (per materiale nel pass principale, una sola con la tabella
+    // dei materiali). Le mesh senza texture proprie usano il materiale del personaggio, come nel percorso per mesh.
+    if (drawIndiretto.attivo())
+    {
+        if (prePassInCorso)
+            drawIndiretto.esegui(DrawIndiretto::PASSO_PREPASS, shader);
+        else if (passoLod == 0)
+            drawIndiretto.esegui(passoLod, shader, [&]() { bindMateriale(shader, materiale.diffuse, materiale.normal, materiale.gloss); });
+        else
+            drawIndiretto.esegui(passoLod, shader);
+    }
+}
+
+int lodModello(Model* m, const glm::mat4& model)
+{
+    if (!m)
+        return 0;
+    float pixelPerUnita = meshlod::pixelPerUnitaModello(m->boundsMin, m->boundsMax, model, vistaLod);
+    int lod = selettoreLod.seleziona(m, passoLod, m->lodErrors, pixelPerUnita, vistaLod.bias);
+    triangoliPasso[passoLod] += m->triangles(lod);
+    triangoliPassoPieni[passoLod] += m->triangles(0);
+    return lod;
+}
+
+void disegnaModello(Model* m, Shader& shader, const glm::mat4& model)
+{
+    if (!m)
+        return;
+    int lod = lodModello(m, model);
+    if (!drawIndiretto.attivo())
+        m->Draw(shader, lod);
+    else
+        for (const Mesh& mesh : m->meshes)
+            drawIndiretto.registra(mesh, model, lod);
+}
+
+Mesh* creaQuad(const float* vertici, size_t numFloat, const unsigned int* indici, size_t numIndici,
+               unsigned int diffuse, unsigned int normal, unsigned int gloss)
+{
+    std::vector<Vertex> v(numFloat / 14);
+    memset(v.data(), 0, v.size() * sizeof(Vertex));
+    for (size_t i = 0; i < v.size(); ++i)
+    {
+        const float* f = vertici + i * 14;
+        v[i].Position = glm::vec3(f[0], f[1], f[2]);
+        v[i].Normal = glm::vec3(f[3], f[4], f[5]);
+        v[i].TexCoords = glm::vec2(f[6], f[7]);
+        v[i].Tangent = glm::vec3(f[8], f[9], f[10]);
+        v[i].Bitangent = glm::vec3(f[11], f[12], f[13]);
+    }
+    std::vector<Texture> textures = { { diffuse, "texture_diffuse", "" }, { normal, "texture_normal", "" } };
+    if (gloss)
+        textures.push_back({ gloss, "texture_specular", "" });
+    return new Mesh(v, std::vector<unsigned int>(indici, indici + numIndici), textures);
+}
+
+void impostaModello(const glm::mat4& model)
+{
+    size_t offset = bufferOggetti.scrivi(glm::value_ptr(model), sizeof(glm::mat4));
+    glBindBufferRange(GL_UNIFORM_BUFFER, 0, bufferOggetti.buffer(), offset, sizeof(glm::mat4));
+}
+
+void disegnaQuad(unsigned int vao, Mesh* mesh, const glm::mat4& model)
+{
+    if (drawIndiretto.attivo() && mesh)
+    {
+        drawIndiretto.registra(*mesh, model, 0);
+        return;
+    }
+    glBindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
+
+// Richiede allo streamer, per ogni texture delle mesh visibili del modello, il livello di mipmap
+// necessario alla distanza corrente (vedi mip_feedback.h)
+void feedbackModello(Model* m, const glm::mat4& model)
+{
+    if (!mipFeedbackAttivo || !m)
+        return;
+    std::vector<SuperficieMip>& superfici = superficiModelli[m];
+    if (superfici.empty())
+        for (const Mesh& mesh : m->meshes)
+            superfici.push_back(misuraMesh(mesh));
+    for (size_t i = 0; i < m->meshes.size(); ++i)
+    {
+        SuperficieMip s = trasforma(superfici[i], model);
+        if (!visibile(s, mipFeedbackViewProj))
+            continue;
+        float uv = uvPerPixel(s, camera.Position, camera.Zoom, mipFeedbackAltezza);
+        for (const Texture& t : m->meshes[i].textures)
+            textureStreamer->richiedi(t.id, uv);
+    }
+}
+
+void feedbackQuad(const float* vertici, size_t numFloat, const unsigned int* indici, size_t numIndici, const glm::mat4& model,
+                  unsigned int diffuse, unsigned int normal, unsigned int gloss)
+{
+    if (!mipFeedbackAttivo)
+        return;
+    SuperficieMip s = misuraQuad(vertici, numFloat / 14, 14, indici, numIndici, model);
+    if (!visibile(s, mipFeedbackViewProj))
+        return;
+    float uv = uvPerPixel(s, camera.Position, camera.Zoom, mipFeedbackAltezza);
+    textureStreamer->richiedi(diffuse, uv);
+    textureStreamer->richiedi(normal, uv);
+    textureStreamer->richiedi(gloss, uv);
+}
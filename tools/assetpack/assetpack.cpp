@@ -0,0 +1,267 @@
+/******************************************************************************
+ * File:        assetpack.cpp
+ * Description: Crea il pacchetto unico degli asset letto da vfs.h: indice ordinato
+                per hash del percorso, blob allineati a 4 KB, compressione LZ4 per
+                voce quando conviene (i JPG/PNG sono gia' compressi e restano intatti).
+                I percorsi sono salvati relativi alla cartella corrente: va lanciato
+                dalla cartella da cui parte il programma.
+                Uso: assetpack <output.pak> <file|cartella>... [--no-compress]
+ *****************************************************************************/
+
+#include <learnopengl/vfs.h>
+// dopo vfs.h, che include gia' stb_image.h senza implementazione
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Compressore LZ4 a blocchi (greedy, tabella hash da 64K voci): l'output e' decodificabile da vfs::lz4Decompress
+// e da qualunque decoder LZ4 standard. Regole del formato: gli ultimi 5 byte sono sempre letterali
+// e nessun match inizia negli ultimi 12 byte.
+static std::vector<unsigned char> lz4Compress(const unsigned char* src, size_t n)
+{
+    const size_t MFLIMIT = 12, LASTLITERALS = 5, MAXOFFSET = 65535;
+    std::vector<unsigned char> out;
+    out.reserve(n + n / 255 + 16);
+    std::vector<unsigned int> tabella(1 << 16, 0xFFFFFFFFu);
+    auto hash4 = [&](size_t i) {
+        unsigned int v;
+        memcpy(&v, src + i, 4);
+        return (v * 2654435761u) >> 16;
+    };
+    auto lunghezza = [&](size_t l) {
+        for (; l >= 255; l -= 255)
+            out.push_back(255);
+        out.push_back((unsigned char)l);
+    };
+    auto sequenza = [&](size_t inizioLett, size_t nLett, size_t offset, size_t nMatch, bool ultima) {
+        size_t m = ultima ? 0 : nMatch - 4;
+        out.push_back((unsigned char)((std::min<size_t>(nLett, 15) << 4) | std::min<size_t>(m, 15)));
+        if (nLett >= 15)
+            lunghezza(nLett - 15);
+        out.insert(out.end(), src + inizioLett, src + inizioLett + nLett);
+        if (ultima)
+            return;
+        out.push_back((unsigned char)(offset & 0xFF));
+        out.push_back((unsigned char)(offset >> 8));
+        if (m >= 15)
+            lunghezza(m - 15);
+    };
+
+    size_t ancora = 0, i = 0;
+    if (n > MFLIMIT)
+    {
+        size_t limite = n - MFLIMIT;
+        while (i < limite)
+        {
+            unsigned int h = hash4(i);
+            size_t candidato = tabella[h];
+            tabella[h] = (unsigned int)i;
+            if (candidato == 0xFFFFFFFFu || i - candidato > MAXOFFSET || memcmp(src + candidato, src + i, 4) != 0)
+            {
+                ++i;
+                continue;
+            }
+            size_t fine = i + 4, limiteMatch = n - LASTLITERALS;
+            while (fine < limiteMatch && src[fine] == src[candidato + (fine - i)])
+                ++fine;
+            sequenza(ancora, i - ancora, i - candidato, fine - i, false);
+            i = ancora = fine;
+        }
+    }
+    sequenza(ancora, n - ancora, 0, 0, true);
+    return out;
+}
+
+struct Voce {
+    fs::path sorgente;
+    std::string nome;            // percorso normalizzato
+    std::vector<unsigned char> dati;
+    vfs::PackEntry entry = {};
+};
+
+static bool giaCompresso(const fs::path& p)
+{
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png";
+}
+
+static bool leggi(const fs::path& p, std::vector<unsigned char>& dati)
+{
+    std::ifstream f(p, std::ios::binary);
+    if (!f)
+        return false;
+    dati.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Uso: assetpack <output.pak> <file|cartella>... [--no-compress]" << std::endl;
+        return 1;
+    }
+    fs::path output = argv[1];
+    bool comprimi = true;
+    std::vector<Voce> voci;
+    for (int a = 2; a < argc; ++a)
+    {
+        std::string arg = argv[a];
+        if (arg == "--no-compress")
+        {
+            comprimi = false;
+            continue;
+        }
+        auto aggiungi = [&](const fs::path& p) {
+            fs::path relativo = p.is_absolute() ? fs::relative(p) : p;
+            voci.push_back({ p, vfs::normalizza(relativo.generic_string()) });
+        };
+        if (fs::is_directory(arg))
+        {
+            for (const fs::directory_entry& e : fs::recursive_directory_iterator(arg))
+                if (e.is_regular_file() && vfs::normalizza(e.path().generic_string()) != vfs::normalizza(output.generic_string()))
+                    aggiungi(e.path());
+        }
+        else if (fs::is_regular_file(arg))
+            aggiungi(arg);
+        else
+        {
+            std::cout << "ERRORE: " << arg << " non trovato" << std::endl;
+            return 1;
+        }
+    }
+
+    // ordine dei blob = ordine dei percorsi: i file della stessa cartella (un modello e le sue texture)
+    // finiscono vicini e vengono letti in sequenza
+    std::sort(voci.begin(), voci.end(), [](const Voce& a, const Voce& b) { return a.nome < b.nome; });
+    voci.erase(std::unique(voci.begin(), voci.end(), [](const Voce& a, const Voce& b) { return a.nome == b.nome; }), voci.end());
+
+    std::unordered_map<unsigned long long, const std::string*> hashVisti;
+    for (Voce& v : voci)
+    {
+        v.entry.hash = vfs::hash(v.nome);
+        auto r = hashVisti.emplace(v.entry.hash, &v.nome);
+        if (!r.second)
+        {
+            // il formato ammette hash uguali (confronto dei nomi), ma con 64 bit e' quasi certamente un errore
+            std::cout << "ATTENZIONE: collisione di hash tra " << *r.first->second << " e " << v.nome << std::endl;
+        }
+    }
+
+    unsigned int nThread = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "assetpack: " << voci.size() << " file su " << nThread << " thread" << std::endl;
+    auto inizio = std::chrono::high_resolution_clock::now();
+    std::atomic<size_t> prossimo(0);
+    std::atomic<int> errori(0);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < nThread; ++t)
+        threads.emplace_back([&]() {
+            for (size_t i = prossimo++; i < voci.size(); i = prossimo++)
+            {
+                Voce& v = voci[i];
+                if (!leggi(v.sorgente, v.dati))
+                {
+                    errori++;
+                    continue;
+                }
+                v.entry.originalSize = v.dati.size();
+                v.entry.codec = vfs::Nessuno;
+                if (comprimi && !giaCompresso(v.sorgente) && !v.dati.empty())
+                {
+                    std::vector<unsigned char> c = lz4Compress(v.dati.data(), v.dati.size());
+                    // si tiene la versione compressa solo se risparmia almeno il 10%
+                    if (c.size() < v.dati.size() / 10 * 9)
+                    {
+                        v.dati.swap(c);
+                        v.entry.codec = vfs::LZ4;
+                    }
+                }
+                v.entry.size = v.dati.size();
+            }
+        });
+    for (std::thread& t : threads)
+        t.join();
+    if (errori > 0)
+    {
+        std::cout << "ERRORE: " << errori << " file non leggibili" << std::endl;
+        return 1;
+    }
+
+    std::ofstream f(output, std::ios::binary);
+    if (!f)
+    {
+        std::cout << "ERRORE: impossibile scrivere " << output.string() << std::endl;
+        return 1;
+    }
+    unsigned long long pos = 0;
+    auto scrivi = [&](const void* p, size_t n) {
+        f.write((const char*)p, n);
+        pos += n;
+    };
+    auto allinea = [&](unsigned long long a) {
+        static const char zeri[vfs::PACK_ALIGN] = {};
+        scrivi(zeri, (size_t)((a - pos % a) % a));
+    };
+
+    vfs::PackHeader header = {};
+    memcpy(header.magic, "TPAK", 4);
+    header.version = vfs::PACK_VERSION;
+    header.count = (unsigned int)voci.size();
+    scrivi(&header, sizeof(header));
+
+    // blob, ciascuno allineato a PACK_ALIGN (pagine intere: nessuna pagina condivisa tra due file)
+    unsigned long long originali = 0;
+    std::string nomi;
+    for (Voce& v : voci)
+    {
+        allinea(vfs::PACK_ALIGN);
+        v.entry.offset = pos;
+        scrivi(v.dati.data(), v.dati.size());
+        v.entry.nameOffset = (unsigned int)nomi.size();
+        nomi += v.nome;
+        nomi += '\0';
+        originali += v.entry.originalSize;
+        std::vector<unsigned char>().swap(v.dati);
+    }
+
+    // indice ordinato per hash, poi i nomi: il pacchetto termina sempre con '\0'
+    allinea(alignof(vfs::PackEntry));
+    header.tocOffset = pos;
+    std::vector<vfs::PackEntry> toc;
+    for (const Voce& v : voci)
+        toc.push_back(v.entry);
+    std::sort(toc.begin(), toc.end(), [](const vfs::PackEntry& a, const vfs::PackEntry& b) { return a.hash < b.hash; });
+    if (!toc.empty())
+        scrivi(toc.data(), toc.size() * sizeof(vfs::PackEntry));
+    header.namesOffset = pos;
+    nomi += '\0';
+    scrivi(nomi.data(), nomi.size());
+
+    f.seekp(0);
+    f.write((const char*)&header, sizeof(header));
+    f.close();
+    if (!f)
+    {
+        std::cout << "ERRORE: scrittura di " << output.string() << " non riuscita" << std::endl;
+        return 1;
+    }
+
+    double secondi = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizio).count();
+    std::cout << "assetpack: " << output.string() << " " << pos / (1024 * 1024) << " MB (" << originali / (1024 * 1024)
+              << " MB originali) in " << secondi << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,326 @@
+/******************************************************************************
+ * File:        texcook.cpp
+ * Description: Cooker offline delle texture: converte JPG/PNG in DDS compressi
+                BCn con catena di mipmap precalcolata, in parallelo su tutti i core.
+                BC1/BC3 per il colore, BC4 per le gloss map, BC5 per le normal map.
+                Uso: texcook <cartella> [--force]
+ *****************************************************************************/
+
+#define DDS_NO_GL
+#include <learnopengl/dds.h>
+#include <learnopengl/mipmap.h>
+// dopo dds.h, che include gia' stb_image.h (tramite vfs.h) senza implementazione
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Tipo di texture dedotto dal nome del file (convenzioni Poliigon / Renderpeople usate nel progetto)
+enum class TipoTexture { Colore, Gloss, Normale };
+
+static TipoTexture classifica(const std::string& nome)
+{
+    std::string n = nome;
+    std::transform(n.begin(), n.end(), n.begin(), ::tolower);
+    if (n.find("_norm") != std::string::npos || n.find("normal") != std::string::npos)
+        return TipoTexture::Normale;
+    if (n.find("gloss") != std::string::npos || n.find("roughness") != std::string::npos)
+        return TipoTexture::Gloss;
+    return TipoTexture::Colore;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder dei blocchi 4x4
+// ---------------------------------------------------------------------------
+
+static unsigned short to565(const float c[3])
+{
+    int r = (int)std::lround(std::min(std::max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void from565(unsigned short v, int out[3])
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Blocco colore BC1 (sempre in modalita' 4 colori): estremi lungo l'asse principale dei 16 pixel
+static void encodeColorBlock(const unsigned char block[16][4], unsigned char out[8])
+{
+    float media[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            media[c] += block[i][c] / 16.0f;
+
+    // covarianza e asse principale (power iteration)
+    float cov[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = block[i][0] - media[0], g = block[i][1] - media[1], b = block[i][2] - media[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+    float asse[3] = { 1.0f, 1.0f, 1.0f };
+    for (int it = 0; it < 4; ++it)
+    {
+        float x = cov[0] * asse[0] + cov[1] * asse[1] + cov[2] * asse[2];
+        float y = cov[1] * asse[0] + cov[3] * asse[1] + cov[4] * asse[2];
+        float z = cov[2] * asse[0] + cov[4] * asse[1] + cov[5] * asse[2];
+        float len = std::sqrt(x * x + y * y + z * z);
+        if (len < 1e-6f)
+            break;
+        asse[0] = x / len; asse[1] = y / len; asse[2] = z / len;
+    }
+
+    float minP = 1e9f, maxP = -1e9f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float p = (block[i][0] - media[0]) * asse[0] + (block[i][1] - media[1]) * asse[1] + (block[i][2] - media[2]) * asse[2];
+        minP = std::min(minP, p);
+        maxP = std::max(maxP, p);
+    }
+    // leggero inset degli estremi per ridurre l'errore medio
+    float inset = (maxP - minP) / 16.0f;
+    minP += inset;
+    maxP -= inset;
+    float cMax[3], cMin[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        cMax[c] = media[c] + asse[c] * maxP;
+        cMin[c] = media[c] + asse[c] * minP;
+    }
+
+    unsigned short c0 = to565(cMax), c1 = to565(cMin);
+    if (c0 < c1)
+        std::swap(c0, c1);
+    unsigned int indici = 0;
+    if (c0 != c1)
+    {
+        int p0[3], p1[3], palette[4][3];
+        from565(c0, p0);
+        from565(c1, p1);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[0][c] = p0[c];
+            palette[1][c] = p1[c];
+            palette[2][c] = (2 * p0[c] + p1[c]) / 3;
+            palette[3][c] = (p0[c] + 2 * p1[c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int k = 0; k < 4; ++k)
+            {
+                int dr = block[i][0] - palette[k][0], dg = block[i][1] - palette[k][1], db = block[i][2] - palette[k][2];
+                int d = dr * dr + dg * dg + db * db;
+                if (d < bestDist) { bestDist = d; best = k; }
+            }
+            indici |= (unsigned int)best << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    out[4] = indici & 0xFF; out[5] = (indici >> 8) & 0xFF;
+    out[6] = (indici >> 16) & 0xFF; out[7] = (indici >> 24) & 0xFF;
+}
+
+// Blocco a un canale BC4 (usato anche per l'alpha di BC3 e per i due canali di BC5), modalita' a 8 valori
+static void encodeChannelBlock(const unsigned char v[16], unsigned char out[8])
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        a0 = std::max(a0, (int)v[i]);
+        a1 = std::min(a1, (int)v[i]);
+    }
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    unsigned long long indici = 0;
+    if (a0 != a1)
+    {
+        int palette[8] = { a0, a1 };
+        for (int k = 1; k <= 6; ++k)
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int k = 0; k < 8; ++k)
+            {
+                int d = std::abs(v[i] - palette[k]);
+                if (d < bestDist) { bestDist = d; best = k; }
+            }
+            indici |= (unsigned long long)best << (3 * i);
+        }
+    }
+    for (int b = 0; b < 6; ++b)
+        out[2 + b] = (unsigned char)((indici >> (8 * b)) & 0xFF);
+}
+
+// Comprime un livello RGBA8 nel formato richiesto (i bordi non multipli di 4 vengono replicati)
+static std::vector<unsigned char> compressLevel(const std::vector<unsigned char>& rgba, int w, int h, dds::Format fmt)
+{
+    int bx = std::max(1, (w + 3) / 4), by = std::max(1, (h + 3) / 4);
+    int bb = dds::blockBytes(fmt);
+    std::vector<unsigned char> out((size_t)bx * by * bb);
+    for (int y = 0; y < by; ++y)
+        for (int x = 0; x < bx; ++x)
+        {
+            unsigned char block[16][4];
+            for (int j = 0; j < 4; ++j)
+                for (int i = 0; i < 4; ++i)
+                {
+                    int px = std::min(x * 4 + i, w - 1), py = std::min(y * 4 + j, h - 1);
+                    memcpy(block[j * 4 + i], &rgba[((size_t)py * w + px) * 4], 4);
+                }
+            unsigned char* dst = &out[((size_t)y * bx + x) * bb];
+            unsigned char canale[16];
+            switch (fmt)
+            {
+            case dds::BC1:
+                encodeColorBlock(block, dst);
+                break;
+            case dds::BC3:
+                for (int k = 0; k < 16; ++k) canale[k] = block[k][3];
+                encodeChannelBlock(canale, dst);
+                encodeColorBlock(block, dst + 8);
+                break;
+            case dds::BC4:
+                for (int k = 0; k < 16; ++k) canale[k] = block[k][0];
+                encodeChannelBlock(canale, dst);
+                break;
+            case dds::BC5:
+                for (int k = 0; k < 16; ++k) canale[k] = block[k][0];
+                encodeChannelBlock(canale, dst);
+                for (int k = 0; k < 16; ++k) canale[k] = block[k][1];
+                encodeChannelBlock(canale, dst + 8);
+                break;
+            }
+        }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+
+static bool cook(const fs::path& sorgente, const fs::path& destinazione, std::string& log)
+{
+    int w, h, n;
+    unsigned char* data = stbi_load(sorgente.string().c_str(), &w, &h, &n, 4);
+    if (!data)
+    {
+        log = "impossibile decodificare";
+        return false;
+    }
+    std::vector<unsigned char> livello(data, data + (size_t)w * h * 4);
+    stbi_image_free(data);
+
+    TipoTexture tipo = classifica(sorgente.filename().string());
+    dds::Format fmt = dds::BC1;
+    if (tipo == TipoTexture::Normale)
+        fmt = dds::BC5;
+    else if (tipo == TipoTexture::Gloss)
+        fmt = dds::BC4;
+    else if (n == 4)
+    {
+        for (size_t i = 3; i < livello.size(); i += 4)
+            if (livello[i] != 255) { fmt = dds::BC3; break; }
+    }
+
+    dds::Image img;
+    img.format = fmt;
+    img.width = w;
+    img.height = h;
+    // stesso filtro del caricamento a runtime: sRGB per il colore, rinormalizzazione per le normal map
+    mipmap::Tipo filtro = tipo == TipoTexture::Normale ? mipmap::Normale : (tipo == TipoTexture::Gloss ? mipmap::Lineare : mipmap::Colore);
+    int lw = w, lh = h;
+    for (;;)
+    {
+        img.levels.push_back(compressLevel(livello, lw, lh, fmt));
+        if (lw == 1 && lh == 1)
+            break;
+        livello = mipmap::halve(livello.data(), lw, lh, 4, filtro);
+        lw = std::max(1, lw / 2);
+        lh = std::max(1, lh / 2);
+    }
+
+    if (!dds::write(destinazione.string(), img))
+    {
+        log = "impossibile scrivere il DDS";
+        return false;
+    }
+    const char* nomi[] = { "BC1", "BC3", "BC4", "BC5" };
+    log = std::string(nomi[fmt]) + " " + std::to_string(w) + "x" + std::to_string(h) + ", " + std::to_string(img.levels.size()) + " mip";
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Uso: texcook <cartella> [--force]" << std::endl;
+        return 1;
+    }
+    fs::path radice = argv[1];
+    bool force = argc > 2 && std::string(argv[2]) == "--force";
+
+    // raccoglie le texture da cuocere (solo quelle piu' recenti del DDS, salvo --force)
+    struct Lavoro { fs::path sorgente, destinazione; uintmax_t bytes; };
+    std::vector<Lavoro> lavori;
+    for (const fs::directory_entry& e : fs::recursive_directory_iterator(radice))
+    {
+        if (!e.is_regular_file())
+            continue;
+        std::string ext = e.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext != ".jpg" && ext != ".jpeg" && ext != ".png")
+            continue;
+        fs::path dst = dds::cookedPath(e.path().string());
+        if (!force && fs::exists(dst) && fs::last_write_time(dst) >= e.last_write_time())
+            continue;
+        lavori.push_back({ e.path(), dst, e.file_size() });
+    }
+    // le texture piu' grandi (8K) per prime: bilancia meglio il carico tra i thread
+    std::sort(lavori.begin(), lavori.end(), [](const Lavoro& a, const Lavoro& b) { return a.bytes > b.bytes; });
+
+    unsigned int nThread = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "texcook: " << lavori.size() << " texture da cuocere su " << nThread << " thread" << std::endl;
+
+    std::atomic<size_t> prossimo(0);
+    std::atomic<int> errori(0);
+    std::mutex logMutex;
+    auto inizio = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < nThread; ++t)
+        threads.emplace_back([&]() {
+            for (size_t i = prossimo++; i < lavori.size(); i = prossimo++)
+            {
+                std::string log;
+                bool ok = cook(lavori[i].sorgente, lavori[i].destinazione, log);
+                if (!ok)
+                    errori++;
+                std::lock_guard<std::mutex> lock(logMutex);
+                std::cout << (ok ? "  " : "  ERRORE ") << lavori[i].sorgente.string() << ": " << log << std::endl;
+            }
+        });
+    for (std::thread& t : threads)
+        t.join();
+
+    double secondi = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - inizio).count();
+    std::cout << "texcook: completato in " << secondi << " s, " << errori << " errori" << std::endl;
+    return errori == 0 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#version 330 core
+// Upscaling del pass principale con risoluzione dinamica (dynamic_resolution.h): campionamento bilineare
+// della porzione renderizzata del target, poi una maschera di contrasto adattiva sulle quattro vicine
+// (come AMD CAS): la nitidezza cala dove il contrasto locale e' gia' alto, cosi' i bordi netti non fanno aloni
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+uniform sampler2D scena;
+uniform vec2 scala;         // porzione renderizzata / dimensione del target
+uniform float nitidezza;    // 0..1
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(scena, 0));
+    // le vicine non devono uscire dalla porzione renderizzata
+    vec2 minimo = 0.5 * texel;
+    vec2 massimo = scala - 0.5 * texel;
+    vec2 uv = clamp(TexCoords * scala, minimo, massimo);
+
+    vec3 c = texture(scena, uv).rgb;
+    vec3 n = texture(scena, clamp(uv + vec2(0.0, texel.y), minimo, massimo)).rgb;
+    vec3 s = texture(scena, clamp(uv - vec2(0.0, texel.y), minimo, massimo)).rgb;
+    vec3 e = texture(scena, clamp(uv + vec2(texel.x, 0.0), minimo, massimo)).rgb;
+    vec3 o = texture(scena, clamp(uv - vec2(texel.x, 0.0), minimo, massimo)).rgb;
+
+    vec3 mn = min(c, min(min(n, s), min(e, o)));
+    vec3 mx = max(c, max(max(n, s), max(e, o)));
+    vec3 ampiezza = sqrt(clamp(min(mn, 1.0 - mx) / max(mx, vec3(1e-4)), 0.0, 1.0));
+    vec3 peso = -ampiezza * mix(0.125, 0.2, nitidezza);
+    FragColor = vec4(clamp((c + (n + s + e + o) * peso) / (1.0 + 4.0 * peso), 0.0, 1.0), 1.0);
+}